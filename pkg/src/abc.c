@@ -0,0 +1,803 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions implement Approximate Bayesian Computation (ABC) on the
+  discrete-time model.
+*/
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "common.h"
+#include "auxiliary.h"
+#include "param.h"
+#include "pathogens.h"
+#include "populations.h"
+#include "sampling.h"
+#include "dispersal.h"
+#include "sumstat.h"
+#include "philox.h"
+#include "rng.h"
+#include "simulation.h"
+#include "abc.h"
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+struct abc * create_abc(double *prmin, double *prmax, double *obs, double *scale, double tol, int maxacc){
+	int i;
+	struct abc *out = (struct abc *) malloc(sizeof(struct abc));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: abc.c->create_abc]\nNo memory left for creating ABC. Exiting.\n");
+		exit(1);
+	}
+
+	for(i=0;i<ABC_NPAR;i++){
+		out->prmin[i] = prmin[i];
+		out->prmax[i] = prmax[i] > prmin[i] ? prmax[i] : prmin[i];
+	}
+	if(out->prmax[3] <= out->prmin[2]){
+		fprintf(stderr, "\n[in: abc.c->create_abc]\nPriors of t1 and t2 do not allow t2 > t1. Exiting.\n");
+		exit(1);
+	}
+	for(i=0;i<SUMSTAT_NSTAT;i++){
+		out->obs[i] = obs[i];
+		out->scale[i] = scale[i];
+	}
+	out->tol = tol;
+	out->maxacc = maxacc > 0 ? maxacc : 1;
+
+	out->theta = (double *) malloc(out->maxacc * ABC_NPAR * sizeof(double));
+	out->dist = (double *) malloc(out->maxacc * sizeof(double));
+	if(out->theta == NULL || out->dist == NULL){
+		fprintf(stderr, "\n[in: abc.c->create_abc]\nNo memory left for storing accepted values. Exiting.\n");
+		exit(1);
+	}
+	out->nacc = 0;
+	out->nsim = 0;
+
+	/* no time series by default */
+	out->obsts = NULL;
+	for(i=0;i<ABC_NTS;i++) out->scalets[i] = 0.0;
+	out->nts = 0;
+	out->nobsts = 0;
+	out->early = FALSE;
+	out->nstep = 0.0;
+	out->nskip = 0.0;
+	out->nabort = 0;
+
+	return out;
+}
+
+
+
+struct abc_smc * create_abc_smc(double *prmin, double *prmax, double *obs, double *scale, int npart, int ngen, double alpha, double mintol, double minacc, int maxsim){
+	struct abc_smc *out = (struct abc_smc *) malloc(sizeof(struct abc_smc));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: abc.c->create_abc_smc]\nNo memory left for creating ABC-SMC. Exiting.\n");
+		exit(1);
+	}
+
+	out->npart = npart > 1 ? npart : 2;
+	out->ngen = ngen > 0 ? ngen : 1;
+	out->abc = create_abc(prmin, prmax, obs, scale, INFINITY, out->npart);
+	out->alpha = alpha > 0.0 && alpha < 1.0 ? alpha : 0.5;
+	out->mintol = mintol;
+	out->minacc = minacc;
+	out->maxsim = maxsim;
+	out->gen = 0;
+
+	out->weights = (double *) malloc(out->npart * sizeof(double));
+	out->gentol = (double *) malloc(out->ngen * sizeof(double));
+	out->gentime = (double *) malloc(out->ngen * sizeof(double));
+	out->gensim = (int *) malloc(out->ngen * sizeof(int));
+	if(out->weights == NULL || out->gentol == NULL || out->gentime == NULL || out->gensim == NULL){
+		fprintf(stderr, "\n[in: abc.c->create_abc_smc]\nNo memory left for creating ABC-SMC. Exiting.\n");
+		exit(1);
+	}
+
+	return out;
+}
+
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_abc(struct abc *in){
+	if(in != NULL){
+		free(in->theta);
+		free(in->dist);
+		free(in->obsts);
+		free(in);
+	}
+}
+
+
+
+void free_abc_smc(struct abc_smc *in){
+	if(in != NULL){
+		free_abc(in->abc);
+		free(in->weights);
+		free(in->gentol);
+		free(in->gentime);
+		free(in->gensim);
+		free(in);
+	}
+}
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+/* Draw parameters from the uniform priors */
+/* t1 and t2 are uniform integers within their bounds, redrawn until t2 > t1 */
+void draw_abc_prior(struct abc *in, gsl_rng *rng, double *theta){
+	int i;
+	for(i=0;i<2;i++){
+		theta[i] = in->prmin[i] + (in->prmax[i] - in->prmin[i]) * rng_uniform(rng);
+	}
+	do{
+		for(i=2;i<ABC_NPAR;i++){
+			theta[i] = in->prmin[i] + rng_uniform_int(rng, (unsigned int) (in->prmax[i] - in->prmin[i]) + 1);
+		}
+	} while(theta[3] <= theta[2]);
+}
+
+
+
+/* Observed group sizes; a series without observed values is ignored */
+void set_abc_timeseries(struct abc *in, double *obsts, double *scalets, int nts, bool early){
+	int i;
+
+	free(in->obsts);
+	in->obsts = NULL;
+	in->nts = 0;
+	in->nobsts = 0;
+	for(i=0;i<nts*ABC_NTS;i++) if(!isnan(obsts[i])) in->nobsts++;
+	if(in->nobsts > 0){
+		in->nts = nts;
+		in->obsts = (double *) malloc(nts * ABC_NTS * sizeof(double));
+		if(in->obsts == NULL){
+			fprintf(stderr, "\n[in: abc.c->set_abc_timeseries]\nNo memory left for storing time series. Exiting.\n");
+			exit(1);
+		}
+		for(i=0;i<nts*ABC_NTS;i++) in->obsts[i] = obsts[i];
+	}
+	for(i=0;i<ABC_NTS;i++) in->scalets[i] = scalets[i];
+	in->early = early && in->nobsts > 0;
+}
+
+
+
+void set_abc_param(struct param *par, double *theta){
+	par->beta = theta[0];
+	par->mu = theta[1];
+	par->muL = par->mu * par->L;
+	par->t1 = (int) theta[2];
+	par->t2 = (int) theta[3];
+}
+
+
+
+double abc_ts_term(struct abc *in, double *grp, int step){
+	int k;
+	double *obs = in->obsts + (step-1)*ABC_NTS, out = 0.0, d;
+	if(step > in->nts) return 0.0;
+	for(k=0;k<ABC_NTS;k++){
+		if(isnan(obs[k])) continue;
+		d = (grp[k] - obs[k]) / in->scalets[k];
+		out += d*d;
+	}
+	return out;
+}
+
+
+
+/* Only monotonic group sizes give a bound; */
+/* the other ones may still match the observed values */
+double abc_ts_bound(struct abc *in, double *grp, int step){
+	int t, k;
+	double *obs, out = 0.0, d;
+	for(t=step;t<in->nts;t++){
+		obs = in->obsts + t*ABC_NTS;
+		for(k=0;k<ABC_NTS;k++){
+			if(isnan(obs[k])) continue;
+			if(k == 0) d = obs[k] - grp[k];
+			else if(k >= 3) d = grp[k] - obs[k];
+			else continue;
+			if(d > 0.0){
+				d /= in->scalets[k];
+				out += d*d;
+			}
+		}
+	}
+	return out;
+}
+
+
+
+/* Euclidean distance between scaled statistics; missing observed values */
+/* are ignored, and non-finite simulated values give an infinite distance */
+double abc_distance(struct abc *in, double *stats, double *ts){
+	int i;
+	double out = 0.0, d;
+	for(i=0;i<SUMSTAT_NSTAT;i++){
+		if(isnan(in->obs[i])) continue;
+		if(!isfinite(stats[i])) return INFINITY;
+		d = (stats[i] - in->obs[i]) / in->scale[i];
+		out += d*d;
+	}
+	if(ts != NULL && in->nobsts > 0){
+		d = 0.0;
+		for(i=0;i<in->nts;i++) d += abc_ts_term(in, ts + i*ABC_NTS, i+1);
+		out += d / in->nobsts;
+	}
+	return sqrt(out);
+}
+
+
+
+static int compare_double(const void *a, const void *b){
+	double x = *((const double *) a), y = *((const double *) b);
+	return (x > y) - (x < y);
+}
+
+
+
+static double median_double(double *x, int n){
+	qsort(x, n, sizeof(double), compare_double);
+	return n % 2 ? x[n/2] : 0.5 * (x[n/2-1] + x[n/2]);
+}
+
+
+
+/* Scales are estimated by the median absolute deviation (normal */
+/* consistency constant); 1 is used for constant statistics. The scale of */
+/* a group size is its median absolute deviation averaged over observed steps. */
+void estimate_abc_scale(struct abc *in, double *stats, double *ts, bool *ok, int n){
+	int i, j, k, t, nt, len = in->nts * ABC_NTS;
+	double *x = (double *) malloc((n > 0 ? n : 1) * sizeof(double)), med, sum;
+	if(x == NULL){
+		fprintf(stderr, "\n[in: abc.c->estimate_abc_scale]\nNo memory left for estimating scales. Exiting.\n");
+		exit(1);
+	}
+
+	for(j=0;j<SUMSTAT_NSTAT;j++){
+		if(in->scale[j] > 0.0) continue;
+		k = 0;
+		for(i=0;i<n;i++){
+			if(ok[i] && isfinite(stats[i*SUMSTAT_NSTAT + j])) x[k++] = stats[i*SUMSTAT_NSTAT + j];
+		}
+		in->scale[j] = 1.0;
+		if(k < 2) continue;
+		med = median_double(x, k);
+		for(i=0;i<k;i++) x[i] = fabs(x[i] - med);
+		med = 1.4826 * median_double(x, k);
+		if(med > NEARZERO) in->scale[j] = med;
+	}
+
+	for(j=0;j<ABC_NTS;j++){
+		if(in->scalets[j] > 0.0) continue;
+		in->scalets[j] = 1.0;
+		if(ts == NULL || in->nobsts < 1) continue;
+		sum = 0.0;
+		nt = 0;
+		for(t=0;t<in->nts;t++){
+			if(isnan(in->obsts[t*ABC_NTS + j])) continue;
+			k = 0;
+			for(i=0;i<n;i++){
+				if(ok[i]) x[k++] = ts[i*len + t*ABC_NTS + j];
+			}
+			if(k < 2) continue;
+			med = median_double(x, k);
+			for(i=0;i<k;i++) x[i] = fabs(x[i] - med);
+			sum += 1.4826 * median_double(x, k);
+			nt++;
+		}
+		if(nt > 0 && sum / nt > NEARZERO) in->scalets[j] = sum / nt;
+	}
+
+	free(x);
+}
+
+
+
+/* TRUE if 'theta' lies within the support of the priors */
+/* as in draw_abc_prior, t2 must exceed t1 */
+static bool in_abc_prior(struct abc *in, double *theta){
+	int k;
+	for(k=0;k<ABC_NPAR;k++){
+		if(theta[k] < in->prmin[k] || theta[k] > in->prmax[k]) return FALSE;
+	}
+	return theta[3] > theta[2];
+}
+
+
+
+static double quantile_double(double *x, int n, double alpha){
+	double *y = (double *) malloc((n > 0 ? n : 1) * sizeof(double)), out;
+	int i;
+	if(y == NULL){
+		fprintf(stderr, "\n[in: abc.c->quantile_double]\nNo memory left for computing quantile. Exiting.\n");
+		exit(1);
+	}
+	for(i=0;i<n;i++) y[i] = x[i];
+	qsort(y, n, sizeof(double), compare_double);
+	out = y[(int) (alpha * (n-1))];
+	free(y);
+	return out;
+}
+
+
+
+static double get_wall_time(){
+#ifdef _OPENMP
+	return omp_get_wtime();
+#else
+	return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+
+
+/* Normal perturbation kernel: Cholesky factor of twice the weighted */
+/* covariance of the particles (Beaumont et al. 2009). Variances are bounded */
+/* below, so that integer parameters can still move after rounding. */
+static void get_abc_kernel(struct abc_smc *in, bool *isfree, double *chol){
+	int i, j, k, n = in->abc->nacc;
+	double *theta = in->abc->theta, mean[ABC_NPAR], cov[ABC_NPAR*ABC_NPAR], wsum = 0.0, minvar, x;
+
+	for(k=0;k<ABC_NPAR;k++) mean[k] = 0.0;
+	for(k=0;k<ABC_NPAR*ABC_NPAR;k++) cov[k] = 0.0;
+	for(i=0;i<n;i++){
+		wsum += in->weights[i];
+		for(k=0;k<ABC_NPAR;k++) mean[k] += in->weights[i] * theta[i*ABC_NPAR + k];
+	}
+	for(k=0;k<ABC_NPAR;k++) mean[k] /= wsum;
+	for(i=0;i<n;i++){
+		for(j=0;j<ABC_NPAR;j++){
+			for(k=0;k<=j;k++){
+				cov[j*ABC_NPAR + k] += in->weights[i] * (theta[i*ABC_NPAR + j] - mean[j]) * (theta[i*ABC_NPAR + k] - mean[k]);
+			}
+		}
+	}
+
+	/* fixed parameters are left out */
+	for(j=0;j<ABC_NPAR;j++){
+		for(k=0;k<=j;k++){
+			cov[j*ABC_NPAR + k] = isfree[j] && isfree[k] ? 2.0 * cov[j*ABC_NPAR + k] / wsum : 0.0;
+		}
+		minvar = j < 2 ? 1e-6 * (in->abc->prmax[j] - in->abc->prmin[j]) : 0.25;
+		minvar = minvar * (j < 2 ? minvar : 1.0);
+		if(!isfree[j]) cov[j*ABC_NPAR + j] = 1.0;
+		else if(cov[j*ABC_NPAR + j] < minvar) cov[j*ABC_NPAR + j] = minvar;
+	}
+
+	/* Cholesky decomposition (lower triangle) */
+	for(j=0;j<ABC_NPAR*ABC_NPAR;j++) chol[j] = 0.0;
+	for(j=0;j<ABC_NPAR;j++){
+		for(k=0;k<=j;k++){
+			x = cov[j*ABC_NPAR + k];
+			for(i=0;i<k;i++) x -= chol[j*ABC_NPAR + i] * chol[k*ABC_NPAR + i];
+			if(j == k){
+				chol[j*ABC_NPAR + j] = sqrt(x > NEARZERO ? x : NEARZERO);
+			} else {
+				chol[j*ABC_NPAR + k] = x / chol[k*ABC_NPAR + k];
+			}
+		}
+	}
+}
+
+
+
+/* log-density of the kernel, up to a constant */
+static double abc_kernel_logdens(double *a, double *b, double *chol){
+	int j, k;
+	double y[ABC_NPAR], out = 0.0;
+	for(j=0;j<ABC_NPAR;j++){
+		y[j] = a[j] - b[j];
+		for(k=0;k<j;k++) y[j] -= chol[j*ABC_NPAR + k] * y[k];
+		y[j] /= chol[j*ABC_NPAR + j];
+		out += y[j] * y[j];
+	}
+	return -0.5 * out;
+}
+
+
+
+/* Importance weights: uniform priors give w_i = 1 / sum_j w'_j K(theta_i | theta'_j) */
+static void update_abc_weights(struct abc_smc *in, double *prev, double *prevw, int nprev, double *chol){
+	int i, j, n = in->abc->nacc;
+	double *logw = in->weights, *x, m, sum;
+
+	x = (double *) malloc(nprev * sizeof(double));
+	if(x == NULL){
+		fprintf(stderr, "\n[in: abc.c->update_abc_weights]\nNo memory left for computing weights. Exiting.\n");
+		exit(1);
+	}
+
+	for(i=0;i<n;i++){
+		m = -INFINITY;
+		for(j=0;j<nprev;j++){
+			x[j] = log(prevw[j]) + abc_kernel_logdens(in->abc->theta + i*ABC_NPAR, prev + j*ABC_NPAR, chol);
+			if(x[j] > m) m = x[j];
+		}
+		sum = 0.0;
+		for(j=0;j<nprev;j++) sum += exp(x[j] - m);
+		logw[i] = -(m + log(sum));
+	}
+
+	/* normalise */
+	m = -INFINITY;
+	for(i=0;i<n;i++) if(logw[i] > m) m = logw[i];
+	sum = 0.0;
+	for(i=0;i<n;i++){
+		logw[i] = exp(logw[i] - m);
+		sum += logw[i];
+	}
+	for(i=0;i<n;i++) logw[i] /= sum;
+
+	free(x);
+}
+
+
+
+/* Draw an ancestor and perturb it, until the result lies within the priors */
+void perturb_abc_particle(struct abc_smc *in, double *prev, double *cumw, double *chol, bool *isfree, gsl_rng *rng, double *theta){
+	int j, k, lo, hi, mid, n = in->abc->nacc;
+	double z[ABC_NPAR], u;
+
+	do{
+		u = rng_uniform(rng) * cumw[n-1];
+		lo = 0;
+		hi = n-1;
+		while(lo < hi){
+			mid = (lo + hi) / 2;
+			if(cumw[mid] > u) hi = mid; else lo = mid + 1;
+		}
+
+		for(k=0;k<ABC_NPAR;k++) z[k] = gsl_ran_ugaussian(rng);
+		for(k=0;k<ABC_NPAR;k++){
+			theta[k] = prev[lo*ABC_NPAR + k];
+			if(!isfree[k]) continue;
+			for(j=0;j<=k;j++) theta[k] += chol[k*ABC_NPAR + j] * z[j];
+		}
+		theta[2] = floor(theta[2] + 0.5);
+		theta[3] = floor(theta[3] + 0.5);
+	} while(!in_abc_prior(in->abc, theta));
+}
+
+
+
+void print_abc(struct abc *in){
+	int i;
+	printf("\n-- ABC --");
+	printf("\nprior bounds (beta, mu, t1, t2):");
+	for(i=0;i<ABC_NPAR;i++) printf(" [%g, %g]", in->prmin[i], in->prmax[i]);
+	printf("\nobserved statistics:");
+	for(i=0;i<SUMSTAT_NSTAT;i++) printf(" %g", in->obs[i]);
+	printf("\nscales:");
+	for(i=0;i<SUMSTAT_NSTAT;i++) printf(" %g", in->scale[i]);
+	if(in->nobsts > 0){
+		printf("\ntime series: %d steps, %d observed values; scales:", in->nts, in->nobsts);
+		for(i=0;i<ABC_NTS;i++) printf(" %g", in->scalets[i]);
+	}
+	printf("\ntolerance: %g", in->tol);
+	printf("\naccepted: %d / %d simulations\n", in->nacc, in->nsim);
+	if(in->early){
+		printf("stopped early: %d simulations, %.1f%% of time steps saved\n", in->nabort, in->nskip > 0.0 ? 100.0 * in->nskip / (in->nstep + in->nskip) : 0.0);
+	}
+}
+
+
+
+void print_abc_smc(struct abc_smc *in){
+	int g;
+	print_abc(in->abc);
+	printf("\n-- ABC-SMC: %d particles --", in->npart);
+	for(g=0;g<in->gen;g++){
+		printf("\ngeneration %d: tolerance %g, %d simulations, %.2f s", g+1, in->gentol[g], in->gensim[g], in->gentime[g]);
+	}
+	printf("\n");
+}
+
+
+
+
+/*
+   ===============================
+   === MAIN EXTERNAL FUNCTIONS ===
+   ===============================
+*/
+
+/* Run one simulation and summarise its sample */
+/* Squared deviations of the group sizes are summed as steps are performed; */
+/* with the bound on the remaining steps, they give a lower bound of the */
+/* distance, as the other terms are positive. The replicate is stopped once */
+/* this bound exceeds 'tol', as it could not be accepted. */
+int simulate_abc_stats(struct abc *in, struct param *tpl, struct network *cn, double *theta, unsigned long seed, int rep, double tol, double *stats, double *ts, int *nstep){
+	struct param par = *tpl;
+	struct simulation *sim;
+	struct sample *samp;
+	struct ts_groupsizes *grpsizes;
+	double grp[ABC_NTS], sum = 0.0, maxsum = tol * tol * in->nobsts;
+	int t;
+	bool early = in->early && isfinite(tol);
+
+	set_abc_param(&par, theta);
+	sim = create_simulation(&par, cn, seed, rep);
+	grpsizes = sim->grpsizes;
+	while(step_simulation(sim)){
+		t = sim->nstep;
+		if(t > in->nts) continue;
+		grp[0] = grpsizes->nsus[t-1];
+		grp[1] = grpsizes->nexp[t-1];
+		grp[2] = grpsizes->ninf[t-1];
+		grp[3] = grpsizes->nrec[t-1];
+		grp[4] = grpsizes->nexpcum[t-1];
+		if(ts != NULL) memcpy(ts + (t-1)*ABC_NTS, grp, ABC_NTS * sizeof(double));
+		if(!early) continue;
+		sum += abc_ts_term(in, grp, t);
+		if(sum + abc_ts_bound(in, grp, t) > maxsum){
+			*nstep = t;
+			free_simulation(sim);
+			return ABC_SIM_ABORTED;
+		}
+	}
+	*nstep = sim->nstep;
+	samp = get_simulation_sample(sim);
+	free_simulation(sim);
+	if(samp == NULL) return ABC_SIM_ENDED;
+
+	get_sumstat_vector(samp, &par, stats);
+	free_sample(samp);
+	return ABC_SIM_DONE;
+}
+
+
+
+/* Keep track of the time steps run, and saved by stopping replicates early */
+static void count_abc_steps(struct abc *in, int status, int nstep, int duration){
+	in->nstep += nstep;
+	if(status == ABC_SIM_ABORTED){
+		in->nabort++;
+		in->nskip += duration - nstep;
+	}
+}
+
+
+
+/* Rejection ABC */
+/* Simulations are run by batches of ABC_BATCH over 'nthreads' threads; */
+/* simulation i draws its parameters from substream (i, 0, 0, RNG_PRIOR), */
+/* and accepted values are appended in the order of the simulations. */
+/* No simulation is stopped early before the scales are known. */
+void run_abc_rejection(struct abc *in, struct param *tpl, struct network *cn, unsigned long seed, int nsim, int nthreads){
+	int i, k, first, nb, *status, *nstep, len = in->nts * ABC_NTS;
+	double *theta, *stats, *ts = NULL, d, tol;
+	bool *ok, scaled = TRUE;
+
+	theta = (double *) malloc(ABC_BATCH * ABC_NPAR * sizeof(double));
+	stats = (double *) malloc(ABC_BATCH * SUMSTAT_NSTAT * sizeof(double));
+	ok = (bool *) malloc(ABC_BATCH * sizeof(bool));
+	status = (int *) malloc(ABC_BATCH * sizeof(int));
+	nstep = (int *) malloc(ABC_BATCH * sizeof(int));
+	if(len > 0) ts = (double *) malloc(ABC_BATCH * len * sizeof(double));
+	if(theta == NULL || stats == NULL || ok == NULL || status == NULL || nstep == NULL || (len > 0 && ts == NULL)){
+		fprintf(stderr, "\n[in: abc.c->run_abc_rejection]\nNo memory left for running simulations. Exiting.\n");
+		exit(1);
+	}
+
+	for(k=0;k<SUMSTAT_NSTAT;k++) if(!(in->scale[k] > 0.0)) scaled = FALSE;
+	for(k=0;k<ABC_NTS;k++) if(len > 0 && !(in->scalets[k] > 0.0)) scaled = FALSE;
+	in->nacc = 0;
+	in->nsim = 0;
+	in->nstep = 0.0;
+	in->nskip = 0.0;
+	in->nabort = 0;
+
+	for(first=0; first<nsim && in->nacc<in->maxacc; first+=ABC_BATCH){
+		nb = nsim-first < ABC_BATCH ? nsim-first : ABC_BATCH;
+		tol = scaled ? in->tol : INFINITY;
+
+#ifdef _OPENMP
+		if(nthreads < 1) nthreads = omp_get_num_procs();
+		#pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+		for(i=0;i<nb;i++){
+			gsl_rng *rng = create_rng(seed);
+			rng_set_stream(rng, first+i, 0, 0, RNG_PRIOR);
+			draw_abc_prior(in, rng, theta + i*ABC_NPAR);
+			gsl_rng_free(rng);
+			status[i] = simulate_abc_stats(in, tpl, cn, theta + i*ABC_NPAR, seed, first+i, tol, stats + i*SUMSTAT_NSTAT, ts == NULL ? NULL : ts + i*len, nstep + i);
+			ok[i] = status[i] == ABC_SIM_DONE;
+		}
+
+		/* scales estimated from the first batch */
+		if(!scaled){
+			estimate_abc_scale(in, stats, ts, ok, nb);
+			scaled = TRUE;
+		}
+
+		/* keep accepted values */
+		for(i=0;i<nb && in->nacc<in->maxacc;i++){
+			in->nsim++;
+			count_abc_steps(in, status[i], nstep[i], tpl->duration);
+			if(!ok[i]) continue;
+			d = abc_distance(in, stats + i*SUMSTAT_NSTAT, ts == NULL ? NULL : ts + i*len);
+			if(d <= in->tol){
+				for(k=0;k<ABC_NPAR;k++) in->theta[in->nacc*ABC_NPAR + k] = theta[i*ABC_NPAR + k];
+				in->dist[in->nacc++] = d;
+			}
+		}
+	}
+
+	free(theta);
+	free(stats);
+	free(ts);
+	free(ok);
+	free(status);
+	free(nstep);
+}
+
+
+
+
+/* ABC-SMC */
+/* As in run_abc_rejection, proposals are simulated by batches of ABC_BATCH */
+/* and accepted in order; proposals are indexed over all generations, */
+/* which gives their substreams. A generation left incomplete because */
+/* 'maxsim' was reached is discarded, except for the first one. */
+void run_abc_smc(struct abc_smc *in, struct param *tpl, struct network *cn, unsigned long seed, int nthreads){
+	struct abc *abc = in->abc;
+	int i, k, g, nb, nacc, nprev = 0, gsim, base = 0, *status, *nstep, len = abc->nts * ABC_NTS;
+	double *prev, *prevw, *prevdist, *cumw, *theta, *stats, *ts = NULL, chol[ABC_NPAR*ABC_NPAR], eps = INFINITY, d, t0, tol;
+	bool *ok, isfree[ABC_NPAR], scaled = TRUE;
+
+	prev = (double *) malloc(in->npart * ABC_NPAR * sizeof(double));
+	prevw = (double *) malloc(in->npart * sizeof(double));
+	prevdist = (double *) malloc(in->npart * sizeof(double));
+	cumw = (double *) malloc(in->npart * sizeof(double));
+	theta = (double *) malloc(ABC_BATCH * ABC_NPAR * sizeof(double));
+	stats = (double *) malloc(ABC_BATCH * SUMSTAT_NSTAT * sizeof(double));
+	ok = (bool *) malloc(ABC_BATCH * sizeof(bool));
+	status = (int *) malloc(ABC_BATCH * sizeof(int));
+	nstep = (int *) malloc(ABC_BATCH * sizeof(int));
+	if(len > 0) ts = (double *) malloc(ABC_BATCH * len * sizeof(double));
+	if(prev == NULL || prevw == NULL || prevdist == NULL || cumw == NULL || theta == NULL || stats == NULL || ok == NULL || status == NULL || nstep == NULL || (len > 0 && ts == NULL)){
+		fprintf(stderr, "\n[in: abc.c->run_abc_smc]\nNo memory left for running simulations. Exiting.\n");
+		exit(1);
+	}
+
+	for(k=0;k<ABC_NPAR;k++) isfree[k] = abc->prmax[k] > abc->prmin[k];
+	for(k=0;k<SUMSTAT_NSTAT;k++) if(!(abc->scale[k] > 0.0)) scaled = FALSE;
+	for(k=0;k<ABC_NTS;k++) if(len > 0 && !(abc->scalets[k] > 0.0)) scaled = FALSE;
+#ifdef _OPENMP
+	if(nthreads < 1) nthreads = omp_get_num_procs();
+#endif
+	abc->nsim = 0;
+	abc->nacc = 0;
+	abc->nstep = 0.0;
+	abc->nskip = 0.0;
+	abc->nabort = 0;
+	in->gen = 0;
+
+	for(g=0;g<in->ngen;g++){
+		t0 = get_wall_time();
+
+		/* previous population and kernel */
+		if(g > 0){
+			nprev = abc->nacc;
+			for(i=0;i<nprev*ABC_NPAR;i++) prev[i] = abc->theta[i];
+			for(i=0;i<nprev;i++){
+				prevw[i] = in->weights[i];
+				prevdist[i] = abc->dist[i];
+				cumw[i] = (i > 0 ? cumw[i-1] : 0.0) + prevw[i];
+			}
+			get_abc_kernel(in, isfree, chol);
+		}
+
+		/* new population */
+		nacc = 0;
+		gsim = 0;
+		while(nacc < in->npart && abc->nsim < in->maxsim){
+			nb = in->maxsim - abc->nsim < ABC_BATCH ? in->maxsim - abc->nsim : ABC_BATCH;
+			tol = scaled ? eps : INFINITY;
+
+#ifdef _OPENMP
+			#pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+			for(i=0;i<nb;i++){
+				gsl_rng *rng = create_rng(seed);
+				rng_set_stream(rng, base+i, 0, 0, RNG_PRIOR);
+				if(g == 0){
+					draw_abc_prior(abc, rng, theta + i*ABC_NPAR);
+				} else {
+					/* nacc of the previous population is still in abc->nacc */
+					perturb_abc_particle(in, prev, cumw, chol, isfree, rng, theta + i*ABC_NPAR);
+				}
+				gsl_rng_free(rng);
+				status[i] = simulate_abc_stats(abc, tpl, cn, theta + i*ABC_NPAR, seed, base+i, tol, stats + i*SUMSTAT_NSTAT, ts == NULL ? NULL : ts + i*len, nstep + i);
+				ok[i] = status[i] == ABC_SIM_DONE;
+			}
+			base += nb;
+
+			if(!scaled){
+				estimate_abc_scale(abc, stats, ts, ok, nb);
+				scaled = TRUE;
+			}
+
+			for(i=0;i<nb && nacc<in->npart;i++){
+				gsim++;
+				abc->nsim++;
+				count_abc_steps(abc, status[i], nstep[i], tpl->duration);
+				if(!ok[i]) continue;
+				d = abc_distance(abc, stats + i*SUMSTAT_NSTAT, ts == NULL ? NULL : ts + i*len);
+				if(isfinite(d) && d <= eps){
+					for(k=0;k<ABC_NPAR;k++) abc->theta[nacc*ABC_NPAR + k] = theta[i*ABC_NPAR + k];
+					abc->dist[nacc++] = d;
+				}
+			}
+		}
+
+		/* incomplete generation: keep the previous one */
+		if(nacc < in->npart && g > 0){
+			for(i=0;i<nprev*ABC_NPAR;i++) abc->theta[i] = prev[i];
+			for(i=0;i<nprev;i++){
+				in->weights[i] = prevw[i];
+				abc->dist[i] = prevdist[i];
+			}
+			break;
+		}
+
+		/* weights */
+		if(g == 0){
+			abc->nacc = nacc;
+			for(i=0;i<nacc;i++) in->weights[i] = 1.0 / nacc;
+		} else {
+			abc->nacc = nacc;
+			update_abc_weights(in, prev, prevw, nprev, chol);
+		}
+
+		in->gentol[g] = eps;
+		in->gensim[g] = gsim;
+		in->gentime[g] = get_wall_time() - t0;
+		in->gen = g+1;
+		abc->tol = eps;
+
+		/* stopping rules, and next tolerance */
+		if(nacc < 2 || eps <= in->mintol || (double) nacc / gsim < in->minacc) break;
+		eps = quantile_double(abc->dist, nacc, in->alpha);
+		if(eps < in->mintol) eps = in->mintol;
+	}
+
+	free(prev);
+	free(prevw);
+	free(prevdist);
+	free(cumw);
+	free(theta);
+	free(stats);
+	free(ts);
+	free(ok);
+	free(status);
+	free(nstep);
+}
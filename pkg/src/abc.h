@@ -0,0 +1,164 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions implement Approximate Bayesian Computation (ABC) on the
+  discrete-time model. Requires populations.h and sumstat.h to be included first.
+*/
+
+
+/*
+   ==================
+   === STRUCTURES ===
+   ==================
+*/
+
+/* estimated parameters: beta, mu, t1, t2 */
+#define ABC_NPAR 4
+
+/* number of simulations run between two updates of the accepted values; */
+/* the accepted values therefore do not depend on the number of threads */
+#define ABC_BATCH 256
+
+/* group sizes compared to an observed time series, in the order of */
+/* out-popsize.txt: nsus, nexp, ninf, nrec, nexpcum */
+#define ABC_NTS 5
+
+/* outcomes of simulate_abc_stats */
+#define ABC_SIM_DONE 0
+#define ABC_SIM_ENDED 1
+#define ABC_SIM_ABORTED 2
+
+
+/* Rejection ABC */
+/* - 'prmin', 'prmax': bounds of the uniform priors; equal bounds fix the */
+/* parameter; t1 and t2 are drawn as integers, and pairs where t2 <= t1 */
+/* are rejected, so that prmax[3] must exceed prmin[2] */
+/* - 'obs': observed statistics (see get_sumstat_vector); NaN values are ignored */
+/* - 'scale': scales of the statistics; values <= 0 are estimated by the */
+/* median absolute deviation of the first batch of simulations */
+/* - 'tol': tolerance on the normalised distance */
+/* - 'theta': accepted parameters (ABC_NPAR per row), 'dist': their distances */
+/* - 'maxacc': size of the result buffer, 'nacc': number of accepted values */
+/* - 'nsim': number of simulations used */
+/* - 'obsts': optional observed group sizes (nts steps x ABC_NTS, row-major, */
+/* NaN for missing values), 'scalets' their scales (estimated as 'scale'), */
+/* 'nobsts' the number of observed values; the mean squared scaled deviation */
+/* of the series counts as one more statistic in the distance */
+/* - 'early': if TRUE, replicates are stopped as soon as the part of the */
+/* distance given by the series exceeds the tolerance */
+/* - 'nstep', 'nskip': time steps run, and time steps saved by stopping */
+/* replicates early; 'nabort': number of replicates stopped early */
+struct abc{
+	double prmin[ABC_NPAR], prmax[ABC_NPAR], obs[SUMSTAT_NSTAT], scale[SUMSTAT_NSTAT], tol;
+	double *theta, *dist;
+	int maxacc, nacc, nsim;
+	double *obsts, scalets[ABC_NTS], nstep, nskip;
+	int nts, nobsts, nabort;
+	bool early;
+};
+
+
+/* ABC-SMC (population Monte Carlo) */
+/* - 'abc': priors, statistics and scales; its buffer holds the current particles */
+/* - 'weights': importance weights of the current particles */
+/* - 'npart': number of particles, 'ngen': maximum number of generations */
+/* - 'alpha': quantile of the distances giving the next tolerance */
+/* - 'mintol', 'minacc': stop when the tolerance or the acceptance rate falls below these */
+/* - 'maxsim': maximum total number of simulations */
+/* - 'gen': number of generations performed; 'gentol', 'gensim', 'gentime': */
+/* tolerance, number of simulations and time (in seconds) of each generation */
+struct abc_smc{
+	struct abc *abc;
+	double *weights, alpha, mintol, minacc, *gentol, *gentime;
+	int npart, ngen, gen, maxsim, *gensim;
+};
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+struct abc * create_abc(double *prmin, double *prmax, double *obs, double *scale, double tol, int maxacc);
+
+struct abc_smc * create_abc_smc(double *prmin, double *prmax, double *obs, double *scale, int npart, int ngen, double alpha, double mintol, double minacc, int maxsim);
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_abc(struct abc *in);
+
+void free_abc_smc(struct abc_smc *in);
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+/* draw parameters from the priors */
+void draw_abc_prior(struct abc *in, gsl_rng *rng, double *theta);
+
+/* set the observed time series of group sizes; 'obsts' is copied */
+void set_abc_timeseries(struct abc *in, double *obsts, double *scalets, int nts, bool early);
+
+/* copy parameters into a param structure */
+void set_abc_param(struct param *par, double *theta);
+
+/* squared scaled deviations of the group sizes of step 'step' (from 1) */
+double abc_ts_term(struct abc *in, double *grp, int step);
+
+/* lower bound of the squared deviations of steps after 'step', given the */
+/* group sizes 'grp' of 'step': nsus cannot increase, nrec and nexpcum cannot decrease */
+double abc_ts_bound(struct abc *in, double *grp, int step);
+
+/* normalised Euclidean distance between simulated and observed statistics; */
+/* 'ts' holds the simulated group sizes (in->nts x ABC_NTS), or is NULL */
+double abc_distance(struct abc *in, double *stats, double *ts);
+
+/* estimate missing scales from 'n' vectors of statistics and series; */
+/* ok[i] is FALSE for failed simulations */
+void estimate_abc_scale(struct abc *in, double *stats, double *ts, bool *ok, int n);
+
+/* draw a particle from a weighted population, perturbed by a normal kernel */
+/* of Cholesky factor 'chol'; isfree[k] is FALSE for fixed parameters */
+void perturb_abc_particle(struct abc_smc *in, double *prev, double *cumw, double *chol, bool *isfree, gsl_rng *rng, double *theta);
+
+void print_abc(struct abc *in);
+
+void print_abc_smc(struct abc_smc *in);
+
+
+
+/*
+   ==========================
+   === EXTERNAL FUNCTIONS ===
+   ==========================
+*/
+
+/* run simulation 'rep' with parameters 'theta', and compute the statistics */
+/* of its sample; group sizes are copied into 'ts' if it is not NULL, and */
+/* 'nstep' receives the number of steps run. Returns ABC_SIM_ENDED if the */
+/* epidemic ended before 'duration', and ABC_SIM_ABORTED if in->early is TRUE */
+/* and the series alone puts the distance above 'tol'. */
+int simulate_abc_stats(struct abc *in, struct param *tpl, struct network *cn, double *theta, unsigned long seed, int rep, double tol, double *stats, double *ts, int *nstep);
+
+/* draw up to 'nsim' parameter values from the priors, keeping those within */
+/* 'tol' of the observed statistics, until the result buffer is full */
+void run_abc_rejection(struct abc *in, struct param *tpl, struct network *cn, unsigned long seed, int nsim, int nthreads);
+
+/* ABC-SMC: the first generation samples the priors; each following one uses */
+/* as tolerance the 'alpha' quantile of the distances of the previous one */
+void run_abc_smc(struct abc_smc *in, struct param *tpl, struct network *cn, unsigned long seed, int nthreads);
@@ -7,6 +7,8 @@
 */
 
 #include "common.h"
+#include "philox.h"
+#include "rng.h"
 #include "auxiliary.h"
 
 
@@ -93,6 +95,72 @@ struct vec_int * create_vec_int_zero(int n){
 
 
 
+/* create a hash table of pointers able to store n keys without resizing */
+struct hash_ptr * create_hash_ptr(int n){
+	int size=16;
+	struct hash_ptr *out = (struct hash_ptr *) malloc(sizeof(struct hash_ptr));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: auxiliary.c->create_hash_ptr]\nNo memory left for creating hash table. Exiting.\n");
+		exit(1);
+	}
+
+	/* keep load factor below 1/2 */
+	while(size < 2*n) size *= 2;
+
+	out->keys = (void **) calloc(size, sizeof(void *)); /* calloc needed: NULL = empty slot */
+	out->values = (int *) malloc(size * sizeof(int));
+	if(out->keys == NULL || out->values == NULL){
+		fprintf(stderr, "\n[in: auxiliary.c->create_hash_ptr]\nNo memory left for creating hash table. Exiting.\n");
+		exit(1);
+	}
+
+	out->size = size;
+	out->n = 0;
+	return out;
+}
+
+
+
+
+
+/* forward declaration - heap maintenance of indexed priority queues */
+static void ipq_sift_down(struct ipq *in, int i);
+
+
+/* create an indexed priority queue of n items with initial keys */
+struct ipq * create_ipq(int n, double *keys){
+	int i;
+	struct ipq *out = (struct ipq *) malloc(sizeof(struct ipq));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: auxiliary.c->create_ipq]\nNo memory left for creating priority queue. Exiting.\n");
+		exit(1);
+	}
+
+	out->heap = (int *) malloc(n * sizeof(int));
+	out->pos = (int *) malloc(n * sizeof(int));
+	out->keys = (double *) malloc(n * sizeof(double));
+	if(n>0 && (out->heap == NULL || out->pos == NULL || out->keys == NULL)){
+		fprintf(stderr, "\n[in: auxiliary.c->create_ipq]\nNo memory left for creating priority queue. Exiting.\n");
+		exit(1);
+	}
+
+	out->n = n;
+	for(i=0;i<n;i++){
+		out->heap[i] = i;
+		out->pos[i] = i;
+		out->keys[i] = keys[i];
+	}
+
+	/* heapify */
+	for(i=n/2-1;i>=0;i--) ipq_sift_down(out, i);
+
+	return out;
+}
+
+
+
+
+
 /*
    ===================
    === DESTRUCTORS ===
@@ -116,6 +184,23 @@ void free_vec_int(struct vec_int *in){
 	free(in);
 }
 
+void free_hash_ptr(struct hash_ptr *in){
+	if(in != NULL){
+		free(in->keys);
+		free(in->values);
+		free(in);
+	}
+}
+
+void free_ipq(struct ipq *in){
+	if(in != NULL){
+		free(in->heap);
+		free(in->pos);
+		free(in->keys);
+		free(in);
+	}
+}
+
 
 
 
@@ -149,6 +234,111 @@ int min_int(int *vec, int length){
 }
 
 
+/* slot of a key in a hash table of pointers (Fibonacci hashing, linear probing) */
+static int hash_ptr_slot(struct hash_ptr *in, void *key){
+	unsigned long long h = (unsigned long long) (size_t) key;
+	int i = (int) (((h >> 3) * 11400714819323198485ULL) >> 40) & (in->size - 1);
+	while(in->keys[i] != NULL && in->keys[i] != key) i = (i+1) & (in->size - 1);
+	return i;
+}
+
+
+/* get the value associated to a pointer; returns -1 if the key is absent */
+int hash_ptr_get(struct hash_ptr *in, void *key){
+	int i = hash_ptr_slot(in, key);
+	if(in->keys[i] == NULL) return -1;
+	return in->values[i];
+}
+
+
+/* associate a value to a pointer; the table grows when half full */
+void hash_ptr_set(struct hash_ptr *in, void *key, int value){
+	int i, j, oldsize;
+	void **oldkeys;
+	int *oldvalues;
+
+	/* resize table if needed */
+	if(2*(in->n+1) > in->size){
+		oldsize = in->size;
+		oldkeys = in->keys;
+		oldvalues = in->values;
+		in->size = 2*oldsize;
+		in->keys = (void **) calloc(in->size, sizeof(void *));
+		in->values = (int *) malloc(in->size * sizeof(int));
+		if(in->keys == NULL || in->values == NULL){
+			fprintf(stderr, "\n[in: auxiliary.c->hash_ptr_set]\nNo memory left for resizing hash table. Exiting.\n");
+			exit(1);
+		}
+		for(i=0;i<oldsize;i++){
+			if(oldkeys[i] != NULL){
+				j = hash_ptr_slot(in, oldkeys[i]);
+				in->keys[j] = oldkeys[i];
+				in->values[j] = oldvalues[i];
+			}
+		}
+		free(oldkeys);
+		free(oldvalues);
+	}
+
+	i = hash_ptr_slot(in, key);
+	if(in->keys[i] == NULL){
+		in->keys[i] = key;
+		in->n++;
+	}
+	in->values[i] = value;
+}
+
+
+
+
+
+/* swap two positions of the heap of a priority queue */
+static void ipq_swap(struct ipq *in, int i, int j){
+	int temp = in->heap[i];
+	in->heap[i] = in->heap[j];
+	in->heap[j] = temp;
+	in->pos[in->heap[i]] = i;
+	in->pos[in->heap[j]] = j;
+}
+
+
+static void ipq_sift_up(struct ipq *in, int i){
+	while(i > 0 && in->keys[in->heap[(i-1)/2]] > in->keys[in->heap[i]]){
+		ipq_swap(in, i, (i-1)/2);
+		i = (i-1)/2;
+	}
+}
+
+
+static void ipq_sift_down(struct ipq *in, int i){
+	int child;
+	while((child = 2*i+1) < in->n){
+		if(child+1 < in->n && in->keys[in->heap[child+1]] < in->keys[in->heap[child]]) child++;
+		if(in->keys[in->heap[i]] <= in->keys[in->heap[child]]) break;
+		ipq_swap(in, i, child);
+		i = child;
+	}
+}
+
+
+/* item with the smallest key */
+int ipq_top(struct ipq *in){
+	return in->heap[0];
+}
+
+
+/* change the key of an item and restore heap order, in O(log n) */
+void ipq_update(struct ipq *in, int item, double key){
+	double old = in->keys[item];
+	in->keys[item] = key;
+	if(key < old) {
+		ipq_sift_up(in, in->pos[item]);
+	} else {
+		ipq_sift_down(in, in->pos[item]);
+	}
+}
+
+
 
 
 
@@ -223,7 +413,7 @@ struct vec_int * sample_int_unif(int N, int I, gsl_rng * rng){
 
 	/* draw values */
 	for(i=0;i<N;i++){
-		temp=gsl_rng_uniform_int(rng, I);
+		temp=rng_uniform_int(rng, I);
 		out->values[temp] = out->values[temp] + 1;
 	}
 
@@ -240,7 +430,7 @@ struct vec_int * sample_int_unif(int N, int I, gsl_rng * rng){
 struct vec_int * sample_int_multinom(int N, int I, double * proba, gsl_rng * rng){
 	struct vec_int * out = create_vec_int(I);
 
-	gsl_ran_multinomial (rng, I, N, proba, (unsigned int *) out->values);
+	rng_multinomial(rng, I, N, proba, (unsigned int *) out->values);
 
 	/* free local pointers and return result */
 	return out;
@@ -29,6 +29,24 @@ struct distmat_int{
 };
 
 
+/* open-addressing hash table mapping pointers to non-negative integers */
+/* - 'keys' and 'values' have 'size' slots (a power of 2) */
+/* - 'n' is the number of keys stored */
+struct hash_ptr{
+	void **keys;
+	int *values, size, n;
+};
+
+
+/* indexed priority queue (binary min-heap) of items 0..n-1 keyed by doubles */
+/* - 'heap' lists items in heap order, 'pos' gives the heap position of each item */
+/* - 'keys' gives the key of each item */
+struct ipq{
+	int n, *heap, *pos;
+	double *keys;
+};
+
+
 
 /*
    ====================
@@ -44,6 +62,10 @@ struct vec_int * create_vec_int(int n);
 
 struct vec_int * create_vec_int_zero(int n);
 
+struct hash_ptr * create_hash_ptr(int n);
+
+struct ipq * create_ipq(int n, double *keys);
+
 
 
 /*
@@ -59,6 +81,10 @@ void free_table_int(struct table_int *in);
 
 void free_vec_int(struct vec_int *in);
 
+void free_hash_ptr(struct hash_ptr *in);
+
+void free_ipq(struct ipq *in);
+
 
 
 
@@ -73,6 +99,14 @@ int max_int(int *vec, int length);
 
 int min_int(int *vec, int length);
 
+int hash_ptr_get(struct hash_ptr *in, void *key);
+
+void hash_ptr_set(struct hash_ptr *in, void *key, int value);
+
+int ipq_top(struct ipq *in);
+
+void ipq_update(struct ipq *in, int item, double key);
+
 
 /*
    ==========================
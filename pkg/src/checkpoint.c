@@ -0,0 +1,518 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions save the state of a simulation to a binary file and
+  restore it, so that runs can be resumed or branched.
+*/
+
+#include "common.h"
+#include "auxiliary.h"
+#include "param.h"
+#include "pathogens.h"
+#include "populations.h"
+#include "sampling.h"
+#include "dispersal.h"
+#include "sumstat.h"
+#include "philox.h"
+#include "rng.h"
+#include "simulation.h"
+#include "checkpoint.h"
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+/* Write 'size' bytes of 'x' as section 'sect', padded to 8 bytes */
+static void write_section(FILE *f, struct ckpt_header *h, int sect, void *x, long long size, long long *pos){
+	static const char zeros[8] = {0};
+	int pad = (int) ((8 - size % 8) % 8);
+
+	h->offset[sect] = *pos;
+	h->size[sect] = size;
+	if((size > 0 && fwrite(x, 1, (size_t) size, f) != (size_t) size) || (pad > 0 && fwrite(zeros, 1, pad, f) != (size_t) pad)){
+		fprintf(stderr, "\n[in: checkpoint.c->write_section]\nUnable to write checkpoint. Exiting.\n");
+		exit(1);
+	}
+	*pos += size + pad;
+}
+
+
+
+/* Write a table of 'n' pathogens as sections base..base+3 */
+/* Ancestors are translated into their index in 'index' (-1 for none). */
+static long long write_pathogen_table(FILE *f, struct ckpt_header *h, int base, struct pathogen **pat, long long n, struct hash_ptr *index, long long *pos){
+	long long i, nsnps=0;
+	int j, *age, *ances, *snps;
+	long long *snpoff;
+
+	for(i=0;i<n;i++) nsnps += get_nb_snps(pat[i]);
+
+	age = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+	ances = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+	snpoff = (long long *) malloc((n+1) * sizeof(long long));
+	snps = (int *) malloc((nsnps > 0 ? nsnps : 1) * sizeof(int));
+	if(age == NULL || ances == NULL || snpoff == NULL || snps == NULL){
+		fprintf(stderr, "\n[in: checkpoint.c->write_pathogen_table]\nNo memory left for storing pathogens. Exiting.\n");
+		exit(1);
+	}
+
+	snpoff[0] = 0;
+	for(i=0;i<n;i++){
+		age[i] = get_age(pat[i]);
+		ances[i] = -1;
+		if(get_ances(pat[i]) != NULL && (ances[i] = hash_ptr_get(index, get_ances(pat[i]))) < 0){
+			fprintf(stderr, "\n[in: checkpoint.c->write_pathogen_table]\nAncestor not found in the metapopulation. Exiting.\n");
+			exit(1);
+		}
+		for(j=0;j<get_nb_snps(pat[i]);j++) snps[snpoff[i]+j] = get_snps(pat[i])[j];
+		snpoff[i+1] = snpoff[i] + get_nb_snps(pat[i]);
+	}
+
+	write_section(f, h, base, age, n * sizeof(int), pos);
+	write_section(f, h, base+1, ances, n * sizeof(int), pos);
+	write_section(f, h, base+2, snpoff, (n+1) * sizeof(long long), pos);
+	write_section(f, h, base+3, snps, nsnps * sizeof(int), pos);
+
+	free(age);
+	free(ances);
+	free(snpoff);
+	free(snps);
+	return nsnps;
+}
+
+
+
+/* Return section 'sect' of a checkpoint, checking that it spans 'size' bytes */
+static void * get_section(char *buf, long long bufsize, struct ckpt_header *h, int sect, long long size, const char *file){
+	if(h->size[sect] != size || h->offset[sect] < (long long) sizeof(struct ckpt_header) || h->offset[sect] % 8 != 0 || h->offset[sect] + size > bufsize){
+		fprintf(stderr, "\n[in: checkpoint.c->get_section]\nCheckpoint %s is corrupted (section %d). Exiting.\n", file, sect);
+		exit(1);
+	}
+	return buf + h->offset[sect];
+}
+
+
+
+/* Read a table of 'n' pathogens from sections base..base+3 */
+/* Ancestors are taken from 'ref', which holds 'nref' pathogens; if 'ref' */
+/* is NULL, they are taken from the table itself. */
+static struct pathogen ** read_pathogen_table(char *buf, long long bufsize, struct ckpt_header *h, int base, long long n, long long nsnps, struct pathogen **ref, long long nref, const char *file){
+	long long i;
+	int j, *age, *ances, *snps;
+	long long *snpoff;
+	struct pathogen **out = (struct pathogen **) malloc((n > 0 ? n : 1) * sizeof(struct pathogen *));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: checkpoint.c->read_pathogen_table]\nNo memory left for restoring pathogens. Exiting.\n");
+		exit(1);
+	}
+
+	age = (int *) get_section(buf, bufsize, h, base, n * sizeof(int), file);
+	ances = (int *) get_section(buf, bufsize, h, base+1, n * sizeof(int), file);
+	snpoff = (long long *) get_section(buf, bufsize, h, base+2, (n+1) * sizeof(long long), file);
+	snps = (int *) get_section(buf, bufsize, h, base+3, nsnps * sizeof(int), file);
+	if(ref == NULL){
+		ref = out;
+		nref = n;
+	}
+
+	for(i=0;i<n;i++){
+		if(snpoff[i] < 0 || snpoff[i+1] < snpoff[i] || snpoff[i+1] > nsnps || ances[i] < -1 || ances[i] >= nref){
+			fprintf(stderr, "\n[in: checkpoint.c->read_pathogen_table]\nCheckpoint %s is corrupted (pathogen %lld). Exiting.\n", file, i);
+			exit(1);
+		}
+		out[i] = create_pathogen();
+		free_vec_int(out[i]->snps);
+		out[i]->snps = create_vec_int((int) (snpoff[i+1] - snpoff[i]));
+		for(j=0;j<get_nb_snps(out[i]);j++) out[i]->snps->values[j] = snps[snpoff[i]+j];
+		out[i]->age = age[i];
+	}
+
+	/* ancestors, once all pathogens exist */
+	for(i=0;i<n;i++) out[i]->ances = ances[i] < 0 ? NULL : ref[ances[i]];
+
+	return out;
+}
+
+
+
+
+/*
+   ===============================
+   === MAIN EXTERNAL FUNCTIONS ===
+   ===============================
+*/
+
+/* Save the state of a simulation */
+/* Pathogens of the metapopulation are numbered population by population, */
+/* in the order of their 'pathogens' arrays, and 'ances' pointers are */
+/* replaced by these numbers. The file is written under a temporary name */
+/* and renamed once complete, so that a crash never leaves a truncated */
+/* checkpoint. Isolates taken by get_simulation_sample are not saved. */
+void save_simulation(struct simulation *in, struct ts_sumstat *sumstats, const char *file){
+	int i, j, k, *popinfo, *grp, *samp;
+	long long pos, npat=0, nsamppat=0;
+	char *tmpfile;
+	double *stat;
+	struct ckpt_header h;
+	struct population *pop;
+	struct pathogen **all;
+	struct hash_ptr *index;
+	FILE *f;
+
+	/* header */
+	memset(&h, 0, sizeof(struct ckpt_header));
+	memcpy(h.magic, CKPT_MAGIC, 8);
+	h.version = CKPT_VERSION;
+	h.byteorder = CKPT_BYTEORDER;
+	h.rep = in->rep;
+	h.nstep = in->nstep;
+	h.nsamp = in->nsamp;
+	h.npop = get_npop(in->metapop);
+	h.duration = in->par->duration;
+	h.n_sample = in->par->n_sample;
+	h.L = in->par->L;
+	h.t1 = in->par->t1;
+	h.t2 = in->par->t2;
+	h.rngsize = (int) in->par->rng->type->size;
+	strncpy(h.rngname, gsl_rng_name(in->par->rng), 31);
+	h.mu = in->par->mu;
+	h.beta = in->par->beta;
+	if(sumstats != NULL){
+		h.nstat = sumstats->length;
+		h.maxstat = sumstats->maxlength;
+	}
+
+	/* number the pathogens of the metapopulation */
+	for(i=0;i<h.npop;i++) npat += get_nexpcum(get_populations(in->metapop)[i]);
+	for(i=0;i<in->nsamp;i++) for(j=0;j<get_n(in->samplist[i]);j++) if(in->samplist[i]->pathogens[j] != NULL) nsamppat++;
+	all = (struct pathogen **) malloc(((npat > nsamppat ? npat : nsamppat) + 1) * sizeof(struct pathogen *));
+	popinfo = (int *) malloc(h.npop * CKPT_NPOPFIELD * sizeof(int));
+	samp = (int *) malloc((in->nsamp + nsamppat + 1) * sizeof(int));
+	grp = (int *) malloc(5 * h.duration * sizeof(int));
+	if(all == NULL || popinfo == NULL || samp == NULL || grp == NULL){
+		fprintf(stderr, "\n[in: checkpoint.c->save_simulation]\nNo memory left for saving simulation. Exiting.\n");
+		exit(1);
+	}
+	index = create_hash_ptr((int) npat);
+	k = 0;
+	for(i=0;i<h.npop;i++){
+		pop = get_populations(in->metapop)[i];
+		popinfo[i*CKPT_NPOPFIELD] = get_nsus(pop);
+		popinfo[i*CKPT_NPOPFIELD + 1] = get_nexp(pop);
+		popinfo[i*CKPT_NPOPFIELD + 2] = get_ninf(pop);
+		popinfo[i*CKPT_NPOPFIELD + 3] = get_nrec(pop);
+		popinfo[i*CKPT_NPOPFIELD + 4] = get_nexpcum(pop);
+		popinfo[i*CKPT_NPOPFIELD + 5] = pop->popsize;
+		popinfo[i*CKPT_NPOPFIELD + 6] = get_popid(pop);
+		for(j=0;j<get_nexpcum(pop);j++){
+			hash_ptr_set(index, pop->pathogens[j], k);
+			all[k++] = pop->pathogens[j];
+		}
+	}
+	h.npat = npat;
+	h.nsamppat = nsamppat;
+
+	/* open a temporary file */
+	tmpfile = (char *) malloc(strlen(file) + 5);
+	if(tmpfile == NULL){
+		fprintf(stderr, "\n[in: checkpoint.c->save_simulation]\nNo memory left for saving simulation. Exiting.\n");
+		exit(1);
+	}
+	sprintf(tmpfile, "%s.tmp", file);
+	f = fopen(tmpfile, "wb");
+	if(f == NULL){
+		fprintf(stderr, "\n[in: checkpoint.c->save_simulation]\nUnable to open file %s. Exiting.\n", tmpfile);
+		exit(1);
+	}
+
+	/* sections - the header is written last, once offsets are known */
+	pos = sizeof(struct ckpt_header);
+	if(fseek(f, (long) pos, SEEK_SET) != 0){
+		fprintf(stderr, "\n[in: checkpoint.c->save_simulation]\nUnable to write file %s. Exiting.\n", tmpfile);
+		exit(1);
+	}
+	write_section(f, &h, CKPT_POP, popinfo, h.npop * CKPT_NPOPFIELD * sizeof(int), &pos);
+	h.nsnps = write_pathogen_table(f, &h, CKPT_PATHOGENS, all, npat, index, &pos);
+
+	for(i=0;i<h.duration;i++){
+		grp[i] = in->grpsizes->nsus[i];
+		grp[h.duration + i] = in->grpsizes->nexp[i];
+		grp[2*h.duration + i] = in->grpsizes->ninf[i];
+		grp[3*h.duration + i] = in->grpsizes->nrec[i];
+		grp[4*h.duration + i] = in->grpsizes->nexpcum[i];
+	}
+	write_section(f, &h, CKPT_GRPSIZES, grp, 5 * h.duration * sizeof(int), &pos);
+	write_section(f, &h, CKPT_DATES, in->par->t_sample, h.n_sample * sizeof(int), &pos);
+
+	/* isolates moved out of the samples by get_simulation_sample are skipped */
+	k = 0;
+	for(i=0;i<in->nsamp;i++){
+		samp[i] = 0;
+		for(j=0;j<get_n(in->samplist[i]);j++){
+			if(in->samplist[i]->pathogens[j] == NULL) continue;
+			samp[in->nsamp + k] = in->samplist[i]->popid[j];
+			all[k++] = in->samplist[i]->pathogens[j];
+			samp[i]++;
+		}
+	}
+	write_section(f, &h, CKPT_SAMPLES, samp, (in->nsamp + nsamppat) * sizeof(int), &pos);
+	h.nsampsnps = write_pathogen_table(f, &h, CKPT_SAMPPATHOGENS, all, nsamppat, index, &pos);
+
+	write_section(f, &h, CKPT_RNG, in->par->rng->state, h.rngsize, &pos);
+
+	if(sumstats != NULL){
+		stat = (double *) malloc((10 * h.nstat + 1) * sizeof(double));
+		if(stat == NULL){
+			fprintf(stderr, "\n[in: checkpoint.c->save_simulation]\nNo memory left for saving summary statistics. Exiting.\n");
+			exit(1);
+		}
+		for(i=0;i<h.nstat;i++){
+			stat[i] = sumstats->Hs[i];
+			stat[h.nstat + i] = sumstats->meanNbSnps[i];
+			stat[2*h.nstat + i] = sumstats->varNbSnps[i];
+			stat[3*h.nstat + i] = sumstats->meanPairwiseDist[i];
+			stat[4*h.nstat + i] = sumstats->varPairwiseDist[i];
+			stat[5*h.nstat + i] = sumstats->meanPairwiseDistStd[i];
+			stat[6*h.nstat + i] = sumstats->varPairwiseDistStd[i];
+			stat[7*h.nstat + i] = sumstats->Fst[i];
+			((int *) (stat + 8*h.nstat))[i] = sumstats->steps[i];
+			((int *) (stat + 8*h.nstat))[h.nstat + i] = sumstats->nbSnps[i];
+		}
+		write_section(f, &h, CKPT_SUMSTAT, stat, h.nstat * (8 * sizeof(double) + 2 * sizeof(int)), &pos);
+		free(stat);
+	}
+
+	/* header */
+	if(fseek(f, 0, SEEK_SET) != 0 || fwrite(&h, sizeof(struct ckpt_header), 1, f) != 1 || fclose(f) != 0){
+		fprintf(stderr, "\n[in: checkpoint.c->save_simulation]\nUnable to write file %s. Exiting.\n", tmpfile);
+		exit(1);
+	}
+
+	/* rename() does not replace existing files on all platforms */
+	if(rename(tmpfile, file) != 0 && (remove(file) != 0 || rename(tmpfile, file) != 0)){
+		fprintf(stderr, "\n[in: checkpoint.c->save_simulation]\nUnable to rename %s into %s. Exiting.\n", tmpfile, file);
+		exit(1);
+	}
+
+	free_hash_ptr(index);
+	free(tmpfile);
+	free(all);
+	free(popinfo);
+	free(samp);
+	free(grp);
+}
+
+
+
+/* Restore a simulation */
+/* The file is read in one go; arrays are then used in place. */
+struct simulation * load_simulation(const char *file, struct param *par, struct network *cn, int rep, struct ts_sumstat **sumstats){
+	int i, j, k, *popinfo, *grp, *samp, *dates;
+	long long bufsize, npat=0;
+	char *buf;
+	double *stat;
+	struct ckpt_header h;
+	struct population *pop;
+	struct pathogen **all, **sampall;
+	struct ts_sumstat *ts;
+	struct simulation *out;
+	FILE *f;
+
+	/* read file */
+	f = fopen(file, "rb");
+	if(f == NULL){
+		fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nCannot open file %s. Exiting.\n", file);
+		exit(1);
+	}
+	if(fseek(f, 0, SEEK_END) != 0 || (bufsize = ftell(f)) < (long long) sizeof(struct ckpt_header) || fseek(f, 0, SEEK_SET) != 0){
+		fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nFile %s is not a checkpoint. Exiting.\n", file);
+		exit(1);
+	}
+	buf = (char *) malloc(bufsize);
+	if(buf == NULL){
+		fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nNo memory left for reading checkpoint. Exiting.\n");
+		exit(1);
+	}
+	if(fread(buf, 1, (size_t) bufsize, f) != (size_t) bufsize){
+		fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nUnable to read file %s. Exiting.\n", file);
+		exit(1);
+	}
+	fclose(f);
+
+	/* check header */
+	memcpy(&h, buf, sizeof(struct ckpt_header));
+	if(memcmp(h.magic, CKPT_MAGIC, 8) != 0){
+		fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nFile %s is not a checkpoint. Exiting.\n", file);
+		exit(1);
+	}
+	if(h.version != CKPT_VERSION || h.byteorder != CKPT_BYTEORDER){
+		fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nCheckpoint %s was written by another version or on another platform. Exiting.\n", file);
+		exit(1);
+	}
+	h.rngname[31] = '\0';
+	if(h.npop != par->npop || h.duration != par->duration || h.L != par->L || h.t1 != par->t1 || h.t2 != par->t2 || h.nstep < 0 || h.nstep > h.duration || h.nsamp < 0 || h.n_sample < 0){
+		fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nCheckpoint %s does not match the parameters (npop, duration, L, t1 or t2). Exiting.\n", file);
+		exit(1);
+	}
+	popinfo = (int *) get_section(buf, bufsize, &h, CKPT_POP, h.npop * CKPT_NPOPFIELD * sizeof(int), file);
+	for(i=0;i<h.npop;i++){
+		if(popinfo[i*CKPT_NPOPFIELD + 5] != par->popsizes[i]){
+			fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nCheckpoint %s does not match the population sizes. Exiting.\n", file);
+			exit(1);
+		}
+		if(popinfo[i*CKPT_NPOPFIELD + 4] < 0 || popinfo[i*CKPT_NPOPFIELD + 4] > par->popsizes[i]){
+			fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nCheckpoint %s is corrupted (population %d). Exiting.\n", file, i);
+			exit(1);
+		}
+		npat += popinfo[i*CKPT_NPOPFIELD + 4];
+	}
+	if(npat != h.npat){
+		fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nCheckpoint %s is corrupted (number of pathogens). Exiting.\n", file);
+		exit(1);
+	}
+
+	out = (struct simulation *) malloc(sizeof(struct simulation));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nNo memory left for creating simulation. Exiting.\n");
+		exit(1);
+	}
+
+	/* private copy of parameters, with the saved sampling dates and generator */
+	out->par = (struct param *) malloc(sizeof(struct param));
+	if(out->par == NULL){
+		fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nNo memory left for copying parameters. Exiting.\n");
+		exit(1);
+	}
+	*(out->par) = *par;
+	out->par->n_sample = h.n_sample;
+	out->par->t_sample = (int *) malloc((h.n_sample > 0 ? h.n_sample : 1) * sizeof(int));
+	if(out->par->t_sample == NULL){
+		fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nNo memory left for copying parameters. Exiting.\n");
+		exit(1);
+	}
+	dates = (int *) get_section(buf, bufsize, &h, CKPT_DATES, h.n_sample * sizeof(int), file);
+	for(i=0;i<h.n_sample;i++) out->par->t_sample[i] = dates[i];
+	out->par->rng = create_rng(0);
+	if(strcmp(h.rngname, gsl_rng_name(out->par->rng)) != 0 || h.rngsize != (int) out->par->rng->type->size){
+		fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nCheckpoint %s was written with generator %s, not %s. Exiting.\n", file, h.rngname, gsl_rng_name(out->par->rng));
+		exit(1);
+	}
+	memcpy(out->par->rng->state, get_section(buf, bufsize, &h, CKPT_RNG, h.rngsize, file), h.rngsize);
+
+	/* metapopulation */
+	all = read_pathogen_table(buf, bufsize, &h, CKPT_PATHOGENS, h.npat, h.nsnps, NULL, 0, file);
+	out->metapop = (struct metapopulation *) malloc(sizeof(struct metapopulation));
+	if(out->metapop == NULL){
+		fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nNo memory left for creating metapopulation. Exiting.\n");
+		exit(1);
+	}
+	out->metapop->npop = h.npop;
+	out->metapop->popsizes = out->par->popsizes;
+	out->metapop->populations = (struct population **) malloc(h.npop * sizeof(struct population *));
+	if(out->metapop->populations == NULL){
+		fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nNo memory left for creating populations array in the metapopulation. Exiting.\n");
+		exit(1);
+	}
+	k = 0;
+	for(i=0;i<h.npop;i++){
+		pop = out->metapop->populations[i] = create_population(par->popsizes[i], 0, popinfo[i*CKPT_NPOPFIELD + 6]);
+		pop->nsus = popinfo[i*CKPT_NPOPFIELD];
+		pop->nexp = popinfo[i*CKPT_NPOPFIELD + 1];
+		pop->ninf = popinfo[i*CKPT_NPOPFIELD + 2];
+		pop->nrec = popinfo[i*CKPT_NPOPFIELD + 3];
+		pop->nexpcum = popinfo[i*CKPT_NPOPFIELD + 4];
+		for(j=0;j<pop->nexpcum;j++) pop->pathogens[j] = all[k++];
+	}
+
+	/* group sizes */
+	out->grpsizes = create_ts_groupsizes(out->par);
+	grp = (int *) get_section(buf, bufsize, &h, CKPT_GRPSIZES, 5 * h.duration * sizeof(int), file);
+	for(i=0;i<h.duration;i++){
+		out->grpsizes->nsus[i] = grp[i];
+		out->grpsizes->nexp[i] = grp[h.duration + i];
+		out->grpsizes->ninf[i] = grp[2*h.duration + i];
+		out->grpsizes->nrec[i] = grp[3*h.duration + i];
+		out->grpsizes->nexpcum[i] = grp[4*h.duration + i];
+	}
+
+	/* samples drawn so far; dates are already translated */
+	out->tabdates = get_table_int(out->par->t_sample, out->par->n_sample);
+	if(h.nsamp > out->tabdates->n){
+		fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nCheckpoint %s is corrupted (number of samples). Exiting.\n", file);
+		exit(1);
+	}
+	out->samplist = (struct sample **) malloc((out->tabdates->n > 0 ? out->tabdates->n : 1) * sizeof(struct sample *));
+	if(out->samplist == NULL){
+		fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nNo memory left for storing samples. Exiting.\n");
+		exit(1);
+	}
+	samp = (int *) get_section(buf, bufsize, &h, CKPT_SAMPLES, (h.nsamp + h.nsamppat) * sizeof(int), file);
+	sampall = read_pathogen_table(buf, bufsize, &h, CKPT_SAMPPATHOGENS, h.nsamppat, h.nsampsnps, all, h.npat, file);
+	k = 0;
+	for(i=0;i<h.nsamp;i++){
+		if(samp[i] < 0 || k + samp[i] > h.nsamppat){
+			fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nCheckpoint %s is corrupted (sample %d). Exiting.\n", file, i);
+			exit(1);
+		}
+		out->samplist[i] = create_sample(samp[i] > 0 ? samp[i] : 1);
+		if(samp[i] == 0){ /* empty sample, as in draw_sample */
+			out->samplist[i]->n = 0;
+			free(out->samplist[i]->pathogens);
+			free(out->samplist[i]->popid);
+			out->samplist[i]->pathogens = NULL;
+			out->samplist[i]->popid = NULL;
+		}
+		for(j=0;j<samp[i];j++){
+			out->samplist[i]->popid[j] = samp[h.nsamp + k];
+			out->samplist[i]->pathogens[j] = sampall[k++];
+		}
+	}
+
+	/* summary statistics */
+	if(sumstats != NULL){
+		*sumstats = NULL;
+		if(h.maxstat > 0){
+			if(h.nstat < 0 || h.nstat > h.maxstat || h.maxstat != out->par->duration){
+				fprintf(stderr, "\n[in: checkpoint.c->load_simulation]\nCheckpoint %s is corrupted (summary statistics). Exiting.\n", file);
+				exit(1);
+			}
+			ts = *sumstats = create_ts_sumstat(out->par);
+			stat = (double *) get_section(buf, bufsize, &h, CKPT_SUMSTAT, h.nstat * (8 * sizeof(double) + 2 * sizeof(int)), file);
+			for(i=0;i<h.nstat;i++){
+				ts->Hs[i] = stat[i];
+				ts->meanNbSnps[i] = stat[h.nstat + i];
+				ts->varNbSnps[i] = stat[2*h.nstat + i];
+				ts->meanPairwiseDist[i] = stat[3*h.nstat + i];
+				ts->varPairwiseDist[i] = stat[4*h.nstat + i];
+				ts->meanPairwiseDistStd[i] = stat[5*h.nstat + i];
+				ts->varPairwiseDistStd[i] = stat[6*h.nstat + i];
+				ts->Fst[i] = stat[7*h.nstat + i];
+				ts->steps[i] = ((int *) (stat + 8*h.nstat))[i];
+				ts->nbSnps[i] = ((int *) (stat + 8*h.nstat))[h.nstat + i];
+			}
+			ts->length = h.nstat;
+		}
+	}
+
+	out->cn = cn;
+	out->rep = rep < 0 ? h.rep : rep;
+	out->nstep = h.nstep;
+	out->nsamp = h.nsamp;
+	out->base = NULL;
+	out->nforks = 0;
+	out->popdyn = NULL;
+	out->events = NULL;
+
+	free(all);
+	free(sampall);
+	free(buf);
+	return out;
+}
+
@@ -0,0 +1,80 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions save the state of a simulation to a binary file and
+  restore it, so that runs can be resumed or branched.
+  Requires simulation.h and sumstat.h to be included first.
+*/
+
+
+/*
+   ==================
+   === STRUCTURES ===
+   ==================
+*/
+
+#define CKPT_MAGIC "EPIDCKPT"
+#define CKPT_VERSION 2
+#define CKPT_BYTEORDER 0x01020304
+
+
+/* sections of a checkpoint file */
+/* Pathogens are stored as tables of 4 sections (ages, ancestors, offsets */
+/* of the SNPs, SNPs), one for the metapopulation and one for the samples; */
+/* ancestors are indices in the table of the metapopulation (-1 for none). */
+#define CKPT_POP 0 /* CKPT_NPOPFIELD ints per population */
+#define CKPT_PATHOGENS 1 /* pathogens of the metapopulation: sections 1-4 */
+#define CKPT_GRPSIZES 5 /* nsus, nexp, ninf, nrec, nexpcum over 'duration' steps */
+#define CKPT_DATES 6 /* translated sampling dates (t_sample) */
+#define CKPT_SAMPLES 7 /* size of the samples drawn, then popid of their pathogens */
+#define CKPT_SAMPPATHOGENS 8 /* pathogens of the samples: sections 8-11 */
+#define CKPT_RNG 12 /* state of the generator */
+#define CKPT_SUMSTAT 13 /* ts_sumstat: 8 doubles then 2 ints per step, by column */
+#define CKPT_NSECT 14
+
+#define CKPT_NPOPFIELD 7
+
+
+/* Header of a checkpoint file */
+/* Fields are ordered so that the structure has no padding. Sections */
+/* follow the header; each starts at an 8-byte boundary at 'offset' bytes */
+/* from the beginning of the file and spans 'size' bytes, so that all */
+/* arrays can be read in place once the file is mapped in memory. */
+/* Integers are stored in the byte order of the machine, given by */
+/* 'byteorder'. */
+struct ckpt_header{
+	char magic[8];
+	int version, byteorder, rep, nstep, nsamp, npop, duration, n_sample, L, rngsize, nstat, maxstat, t1, t2;
+	char rngname[32];
+	double mu, beta;
+	long long npat, nsnps, nsamppat, nsampsnps;
+	long long offset[CKPT_NSECT], size[CKPT_NSECT];
+};
+
+
+
+
+/*
+   ==========================
+   === EXTERNAL FUNCTIONS ===
+   ==========================
+*/
+
+/* save the state of 'in' to 'file', which is written atomically; 'sumstats' */
+/* may be NULL; isolates already taken from the samples by */
+/* get_simulation_sample are not saved */
+void save_simulation(struct simulation *in, struct ts_sumstat *sumstats, const char *file);
+
+/* restore a simulation saved by save_simulation */
+/* - 'par' and 'cn' play the same role as in create_simulation; the */
+/* populations and their sizes, L, duration and the infectious period (t1, */
+/* t2, which the ages of saved pathogens depend on) must match the file, */
+/* while the other parameters are taken from 'par', so that a run can be */
+/* branched with other parameters */
+/* - 'rep' gives the substreams of the next steps: use -1 to resume the run, */
+/* or another replicate to branch it */
+/* - if 'sumstats' is not NULL, it receives the ts_sumstat saved with the */
+/* simulation, or NULL if none was saved */
+struct simulation * load_simulation(const char *file, struct param *par, struct network *cn, int rep, struct ts_sumstat **sumstats);
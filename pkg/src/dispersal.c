@@ -12,6 +12,20 @@
 #include "populations.h"
 #include "dispersal.h"
 
+/* network files are mapped in memory where mmap is available */
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* tolerance on the sum of the weights of a population in network files */
+#define NETWORK_WEIGHT_TOL 1e-6
+
+/* size in bytes of 'n' items of 'size' bytes, padded to 8 bytes */
+#define NETWORK_PADDED(n, size) ((((long long) (n) * (size)) + 7) / 8 * 8)
+
 
 
 
@@ -40,29 +54,35 @@ struct network * create_network(struct param *par){
 	/* allocate memory */
 	out->n = par->npop;
 	out->nbNb = (int *) malloc(out->n * sizeof(int));
+	out->offsets = (int *) malloc((out->n+1) * sizeof(int));
 	out->listNb = (int **) malloc(out->n * sizeof(int *));
 	out->weights = (double **) malloc(out->n * sizeof(double *));
 
-	if(out->nbNb == NULL || out->listNb == NULL || out->weights == NULL){
+	if(out->nbNb == NULL || out->offsets == NULL || out->listNb == NULL || out->weights == NULL){
 		fprintf(stderr, "\n[in: dispersal.c->create_network]\nNo memory left for creating connection network. Exiting.\n");
 		exit(1);
 	}
 
 	/* nb of neighbours*/
+	out->offsets[0] = 0;
 	for(i=0;i<par->npop;i++){
 		out->nbNb[i] = par->cn_nb_nb[i];
+		out->offsets[i+1] = out->offsets[i] + out->nbNb[i];
 	}
+	out->nEdges = out->offsets[out->n];
 
 	/* list of neighbours and weights */
+	out->allNb = (int *) malloc(out->nEdges * sizeof(int));
+	out->allWeights = (double *) malloc(out->nEdges * sizeof(double));
+	if(out->nEdges > 0 && (out->allNb == NULL || out->allWeights == NULL)){
+		fprintf(stderr, "\n[in: dispersal.c->create_network]\nNo memory left for creating connection network. Exiting.\n");
+		exit(1);
+	}
+
 	counter = 0;
 	for(i=0;i<par->npop;i++){
-		out->listNb[i] = (int *) malloc(out->nbNb[i] * sizeof(int));
-		out->weights[i] = (double *) malloc(out->nbNb[i] * sizeof(double));
-		if(out->listNb[i] == NULL || out->weights[i] == NULL){
-			fprintf(stderr, "\n[in: dispersal.c->create_network]\nNo memory left for creating connection network. Exiting.\n");
-			exit(1);
-		}
-
+		out->listNb[i] = out->allNb + out->offsets[i];
+		out->weights[i] = out->allWeights + out->offsets[i];
 		for(j=0;j<out->nbNb[i];j++){
 			out->listNb[i][j] = par->cn_list_nb[counter];
 			out->weights[i][j] = par->cn_weights[counter++];
@@ -85,6 +105,9 @@ struct network * create_network(struct param *par){
 	}
 
 	/* FREE / RETURN */
+	out->buf = NULL;
+	out->bufsize = 0;
+	out->mapped = FALSE;
 	free(wsum);
 	return out;
 }
@@ -92,6 +115,131 @@ struct network * create_network(struct param *par){
 
 
 
+/* Read a binary network file */
+/* The file is mapped with mmap where available, and read into memory */
+/* otherwise; offsets, neighbours and weights are used where they are. */
+/* The whole file is checked once: sizes, offsets, self-connections first, */
+/* neighbours in range, and weights summing to 1 for each population. */
+struct network * read_network(const char *file){
+	int i, j;
+	double wsum;
+	struct network_header h;
+	struct network *out = (struct network *) calloc(1, sizeof(struct network));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: dispersal.c->read_network]\nNo memory left for reading network. Exiting.\n");
+		exit(1);
+	}
+
+	/* MAP FILE */
+#ifndef _WIN32
+	struct stat st;
+	int fd = open(file, O_RDONLY);
+	if(fd < 0 || fstat(fd, &st) != 0){
+		fprintf(stderr, "\n[in: dispersal.c->read_network]\nCannot open file %s. Exiting.\n", file);
+		exit(1);
+	}
+	out->bufsize = (long long) st.st_size;
+	out->buf = out->bufsize > 0 ? (char *) mmap(NULL, (size_t) out->bufsize, PROT_READ, MAP_PRIVATE, fd, 0) : (char *) MAP_FAILED;
+	close(fd);
+	if(out->buf == (char *) MAP_FAILED){
+		fprintf(stderr, "\n[in: dispersal.c->read_network]\nCannot map file %s. Exiting.\n", file);
+		exit(1);
+	}
+	out->mapped = TRUE;
+#else
+	FILE *f = fopen(file, "rb");
+	if(f == NULL || fseek(f, 0, SEEK_END) != 0 || (out->bufsize = ftell(f)) < 0 || fseek(f, 0, SEEK_SET) != 0){
+		fprintf(stderr, "\n[in: dispersal.c->read_network]\nCannot open file %s. Exiting.\n", file);
+		exit(1);
+	}
+	out->buf = (char *) malloc((size_t) (out->bufsize > 0 ? out->bufsize : 1));
+	if(out->buf == NULL || fread(out->buf, 1, (size_t) out->bufsize, f) != (size_t) out->bufsize){
+		fprintf(stderr, "\n[in: dispersal.c->read_network]\nCannot read file %s. Exiting.\n", file);
+		exit(1);
+	}
+	fclose(f);
+	out->mapped = FALSE;
+#endif
+
+	/* CHECK HEADER AND SIZE */
+	if(out->bufsize < (long long) sizeof(struct network_header)){
+		fprintf(stderr, "\n[in: dispersal.c->read_network]\n%s is not a network file. Exiting.\n", file);
+		exit(1);
+	}
+	memcpy(&h, out->buf, sizeof(struct network_header));
+	if(memcmp(h.magic, NETWORK_MAGIC, 8) != 0 || h.version != NETWORK_VERSION || h.byteorder != NETWORK_BYTEORDER){
+		fprintf(stderr, "\n[in: dispersal.c->read_network]\n%s is not a network file of this version and byte order. Exiting.\n", file);
+		exit(1);
+	}
+	if(h.n < 1 || h.nedges < h.n || out->bufsize != (long long) (NETWORK_PADDED(sizeof(struct network_header), 1) + NETWORK_PADDED(h.n + 1, sizeof(int)) + NETWORK_PADDED(h.nedges, sizeof(int)) + h.nedges * sizeof(double))){
+		fprintf(stderr, "\n[in: dispersal.c->read_network]\nFile %s is truncated or has a wrong size. Exiting.\n", file);
+		exit(1);
+	}
+	out->n = h.n;
+	out->nEdges = h.nedges;
+	out->offsets = (int *) (out->buf + NETWORK_PADDED(sizeof(struct network_header), 1));
+	out->allNb = (int *) ((char *) out->offsets + NETWORK_PADDED(h.n + 1, sizeof(int)));
+	out->allWeights = (double *) ((char *) out->allNb + NETWORK_PADDED(h.nedges, sizeof(int)));
+
+	/* CHECK CONTENT */
+	if(out->offsets[0] != 0 || out->offsets[out->n] != out->nEdges){
+		fprintf(stderr, "\n[in: dispersal.c->read_network]\nFile %s: offsets do not match the number of connections. Exiting.\n", file);
+		exit(1);
+	}
+	for(i=0;i<out->n;i++){
+		if(out->offsets[i+1] <= out->offsets[i] || out->offsets[i+1] > out->nEdges || out->allNb[out->offsets[i]] != i){
+			fprintf(stderr, "\n[in: dispersal.c->read_network]\nFile %s: population %d is not the first of its own neighbours. Exiting.\n", file, i);
+			exit(1);
+		}
+		wsum = 0.0;
+		for(j=out->offsets[i];j<out->offsets[i+1];j++){
+			if(out->allNb[j] < 0 || out->allNb[j] >= out->n || !(out->allWeights[j] >= 0.0)){
+				fprintf(stderr, "\n[in: dispersal.c->read_network]\nFile %s: wrong neighbour or weight for population %d. Exiting.\n", file, i);
+				exit(1);
+			}
+			wsum += out->allWeights[j];
+		}
+		if(fabs(wsum - 1.0) > NETWORK_WEIGHT_TOL){
+			fprintf(stderr, "\n[in: dispersal.c->read_network]\nFile %s: weights of population %d sum to %f rather than 1. Exiting.\n", file, i, wsum);
+			exit(1);
+		}
+	}
+
+	/* PER-POPULATION ACCESS */
+	out->nbNb = (int *) malloc(out->n * sizeof(int));
+	out->listNb = (int **) malloc(out->n * sizeof(int *));
+	out->weights = (double **) malloc(out->n * sizeof(double *));
+	if(out->nbNb == NULL || out->listNb == NULL || out->weights == NULL){
+		fprintf(stderr, "\n[in: dispersal.c->read_network]\nNo memory left for reading network. Exiting.\n");
+		exit(1);
+	}
+	for(i=0;i<out->n;i++){
+		out->nbNb[i] = out->offsets[i+1] - out->offsets[i];
+		out->listNb[i] = out->allNb + out->offsets[i];
+		out->weights[i] = out->allWeights + out->offsets[i];
+	}
+
+	return out;
+}
+
+
+
+
+/* Network of a simulation, built from 'par' or read from 'file' */
+struct network * get_network(struct param *par, const char *file){
+	struct network *out;
+	if(file == NULL || file[0] == '\0') return create_network(par);
+	out = read_network(file);
+	if(out->n != par->npop){
+		fprintf(stderr, "\n[in: dispersal.c->get_network]\nThe network of %s has %d populations rather than %d. Exiting.\n", file, out->n, par->npop);
+		exit(1);
+	}
+	return out;
+}
+
+
+
+
 
 
 /*
@@ -102,11 +250,17 @@ struct network * create_network(struct param *par){
 
 /* Free network */
 void free_network(struct network *in){
-	int i;
 	if(in != NULL){
-		for(i=0;i<in->n;i++){
-			free(in->listNb[i]);
-			free(in->weights[i]);
+		if(in->buf == NULL){
+			free(in->allNb);
+			free(in->allWeights);
+			free(in->offsets);
+		} else {
+#ifndef _WIN32
+			if(in->mapped) munmap(in->buf, (size_t) in->bufsize);
+#else
+			free(in->buf);
+#endif
 		}
 		free(in->nbNb);
 		free(in->listNb);
@@ -170,6 +324,39 @@ void print_network(struct network *in, bool detail){
 
 
 
+/* write a network as a binary network file (see dispersal.h) */
+/* The weights written are those of the network, i.e. standardized. */
+void write_network(struct network *in, const char *file){
+	static const char zeros[8] = {0};
+	struct network_header h;
+	FILE *f = fopen(file, "wb");
+	long long pad1 = NETWORK_PADDED(in->n + 1, sizeof(int)) - (long long) (in->n + 1) * sizeof(int);
+	long long pad2 = NETWORK_PADDED(in->nEdges, sizeof(int)) - (long long) in->nEdges * sizeof(int);
+
+	if(f == NULL){
+		fprintf(stderr, "\n[in: dispersal.c->write_network]\nUnable to open file %s. Exiting.\n", file);
+		exit(1);
+	}
+	memset(&h, 0, sizeof(struct network_header));
+	memcpy(h.magic, NETWORK_MAGIC, 8);
+	h.version = NETWORK_VERSION;
+	h.byteorder = NETWORK_BYTEORDER;
+	h.n = in->n;
+	h.nedges = in->nEdges;
+
+	if(fwrite(&h, sizeof(struct network_header), 1, f) != 1
+	   || fwrite(in->offsets, sizeof(int), in->n + 1, f) != (size_t) (in->n + 1) || fwrite(zeros, 1, pad1, f) != (size_t) pad1
+	   || fwrite(in->allNb, sizeof(int), in->nEdges, f) != (size_t) in->nEdges || fwrite(zeros, 1, pad2, f) != (size_t) pad2
+	   || fwrite(in->allWeights, sizeof(double), in->nEdges, f) != (size_t) in->nEdges || fclose(f) != 0){
+		fprintf(stderr, "\n[in: dispersal.c->write_network]\nUnable to write file %s. Exiting.\n", file);
+		exit(1);
+	}
+}
+
+
+
+
+
 /*
    ===============================
    === MAIN EXTERNAL FUNCTIONS ===
@@ -189,7 +376,7 @@ void print_network(struct network *in, bool detail){
 
 /* gcc line:
 
-   gcc -o dispersal param.c auxiliary.c dispersal.c -Wall -O0 -lgsl -lgslcblas
+   gcc -o dispersal param.c auxiliary.c philox.c rng.c dispersal.c -Wall -O0 -lgsl -lgslcblas
   
    valgrind --leak-check=yes dispersal
 
@@ -20,9 +20,32 @@
 /* nbNb: nb of neighbours of each vertice */
 /* listNb: list of neighbours for each vertice */
 /* weights: weights ~ proba migration */
+/* Neighbours and weights are stored contiguously (CSR): listNb[i] and weights[i] */
+/* point to allNb + offsets[i] and allWeights + offsets[i]; nEdges = offsets[n]. */
+/* For networks read by read_network, offsets, allNb and allWeights point */
+/* into the file ('buf', of 'bufsize' bytes), mapped in memory if 'mapped'; */
+/* 'buf' is NULL otherwise. */
 struct network{
-	int n, *nbNb, **listNb;
-	double ** weights;
+	int n, *nbNb, **listNb, nEdges, *offsets, *allNb, mapped;
+	double ** weights, *allWeights;
+	char *buf;
+	long long bufsize;
+};
+
+
+/* Binary network files */
+/* Header, then offsets (n+1 ints), neighbours (nEdges ints) and weights */
+/* (nEdges doubles), each block starting at an 8-byte boundary. Each */
+/* population is its own first neighbour, and its weights sum to 1. */
+/* Numbers are stored in the byte order of the machine, given by */
+/* 'byteorder'. */
+#define NETWORK_MAGIC "EPIDNETW"
+#define NETWORK_VERSION 1
+#define NETWORK_BYTEORDER 0x01020304
+
+struct network_header{
+	char magic[8];
+	int version, byteorder, n, nedges;
 };
 
 
@@ -38,6 +61,14 @@ struct network{
 
 struct network * create_network(struct param *par);
 
+/* map a binary network file, checking its content; exits if invalid */
+struct network * read_network(const char *file);
+
+/* read the network from 'file' if it is neither NULL nor empty, and build */
+/* it from 'par' otherwise; exits if the file does not have par->npop */
+/* populations */
+struct network * get_network(struct param *par, const char *file);
+
 
 
 
@@ -65,6 +96,9 @@ void free_network(struct network *in);
 
 void print_network(struct network *in, bool detail);
 
+/* write a network as a binary network file */
+void write_network(struct network *in, const char *file);
+
 
 
 
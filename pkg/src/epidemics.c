@@ -14,8 +14,19 @@
 #include "sampling.h"
 #include "sumstat.h"
 #include "dispersal.h"
+#include "eventlog.h"
 #include "infection.h"
 #include "inout.h"
+#include "outstream.h"
+#include "stages.h"
+#include "tauleap.h"
+#include "nrm.h"
+#include "hostnet.h"
+#include "philox.h"
+#include "rng.h"
+#include "simulation.h"
+#include "sweep.h"
+#include "paramfile.h"
 
 
 
@@ -31,19 +42,118 @@
 */
 
 /* Function to be called from R */
-void R_epidemics(int *seqLength, double *mutRate, int *npop, int *nHostPerPop, double *beta, int *nStart, int *t1, int *t2, int *Nsample, int *Tsample, int *duration, int *nbnb, int *listnb, double *pdisp){
-	int i, nstep, counter_sample = 0, tabidx;
+/* seed is the key of the random number generator; outputs are identical to */
+/* those of the first replicate of R_epidemics_batch with the same seed */
+/* binary is 1 to write columnar binary files (.bin) rather than text files */
+/* networkFile names a binary network file (see read_network) replacing */
+/* nbnb, listnb and pdisp, or is empty */
+void R_epidemics(int *seqLength, double *mutRate, int *npop, int *nHostPerPop, double *beta, int *nStart, int *t1, int *t2, int *Nsample, int *Tsample, int *duration, int *nbnb, int *listnb, double *pdisp, double *seed, int *binary, char **popdynFile, char **treeFile, char **networkFile){
+	struct sample *samp;
+	int *dates;
+
+	/* transfer simulation parameters */
+	struct param * par;
+	par = (struct param *) malloc(sizeof(struct param));
+	par->L = *seqLength;
+	par->mu = *mutRate;
+	par->muL = par->mu * par->L;
+	par->rng = NULL; /* each simulation has its own generator */
+	par->npop = *npop;
+	par->popsizes = nHostPerPop;
+	par->beta = *beta;
+	par->nstart = *nStart;
+	par->t1 = *t1;
+	par->t2 = *t2;
+	par->t_sample = Tsample;
+	par->n_sample = *Nsample;
+	par->duration = *duration;
+	par->cn_nb_nb = nbnb;
+	par->cn_list_nb = listnb;
+	par->cn_weights = pdisp;
+
+	/* check/print parameters */
+	check_param(par);
+	print_param(par);
+
+	/* dispersal matrix */
+	struct network *cn = get_network(par, networkFile[0]);
+	/* print_network(cn, TRUE); */
+
+	/* initiate simulation (population, group sizes, sampling schemes) */
+	struct simulation *sim = create_simulation(par, cn, (unsigned long) *seed, 0);
+	printf("\n\nsampling at timesteps:");
+	print_table_int(sim->tabdates);
+
+	/* group sizes of each population are streamed to a file, if requested */
+	if(strlen(popdynFile[0]) > 0){
+		printf("\n\nStreaming group sizes of each population to file '%s'\n", popdynFile[0]);
+		sim->popdyn = create_outstream(popdynFile[0], COLFILE_POPDYN, get_outstream_format(popdynFile[0]), 0);
+	}
+
+	/* transmission events, if requested */
+	struct eventlog *treelog = NULL;
+	if(strlen(treeFile[0]) > 0){
+		printf("\n\nRecording transmissions to file '%s'\n", treeFile[0]);
+		treelog = create_eventlog(treeFile[0]);
+		sim->events = create_eventbuf(treelog, 0, 0);
+	}
+
+
+	/* MAKE METAPOPULATION EVOLVE */
+	run_simulation(sim);
+	close_outstream(sim->popdyn);
+	sim->popdyn = NULL;
+	free_eventbuf(sim->events);
+	sim->events = NULL;
+	close_eventlog(treelog);
+
+	/* we stopped after 'nstep' steps */
+	if(sim->nstep < par->duration){
+		printf("\nEpidemics ended at time %d, before last sampling time (%d).\n", sim->nstep, par->duration);
+	} else {
+
+		/* merge samples */
+		samp = get_simulation_sample(sim);
+		dates = get_simulation_dates(sim);
+
+		/* write sample to file */
+		printf("\n\nWriting sample to file 'out-sample.%s'\n", *binary ? "bin" : "txt");
+		write_sample_file(samp, dates, *binary);
+
+		/* free memory */
+		free_sample(samp);
+		free(dates);
+
+	}
+
+	/* write group sizes to file */
+	printf("\n\nPrinting group sizes to file 'out-popsize.%s'\n", *binary ? "bin" : "txt");
+	write_ts_groupsizes_file(sim->grpsizes, *binary);
+
+
+	/* free memory */
+	free_simulation(sim);
+	free(par);
+	free_network(cn);
+}
+
+
+
+
+
+
+
+/* Function to be called from R - continuous-time engines */
+/* nStages gives the number of Erlang stages of the latent and infectious periods */
+/* tauTol is the tolerance on relative propensity changes within a leap */
+/* engine is 0 for tau-leaping, 1 for the (exact) next-reaction method */
+/* networkFile is as in R_epidemics */
+void R_epidemics_ctmc(int *seqLength, double *mutRate, int *npop, int *nHostPerPop, double *beta, int *nStart, int *t1, int *t2, int *Nsample, int *Tsample, int *duration, int *nbnb, int *listnb, double *pdisp, int *nStages, double *tauTol, int *engine, double *seed, int *binary, char **networkFile){
+	int i, nstep, counter_sample = 0, tabidx, nevents = 0;
+	double t = 0.0;
 
 	/* Initialize random number generator */
-	int j;
-	time_t t;
-	t = time(NULL); // time in seconds, used to change the seed of the random generator
-	gsl_rng * rng;
-	const gsl_rng_type *typ;
-	gsl_rng_env_setup();
-	typ=gsl_rng_default;
-	rng=gsl_rng_alloc(typ);
-	gsl_rng_set(rng,t); // changes the seed of the random generator
+	gsl_rng * rng = create_rng((unsigned long) *seed);
 
 
 	/* transfer simulation parameters */
@@ -65,21 +175,27 @@ void R_epidemics(int *seqLength, double *mutRate, int *npop, int *nHostPerPop, d
 	par->cn_nb_nb = nbnb;
 	par->cn_list_nb = listnb;
 	par->cn_weights = pdisp;
+	par->ke = nStages[0];
+	par->ki = nStages[1];
+	par->tau_tol = *tauTol;
 
 	/* check/print parameters */
 	check_param(par);
+	check_param_stages(par);
 	print_param(par);
 
 	/* dispersal matrix */
-	struct network *cn = create_network(par);
-	/* print_network(cn, TRUE); */
+	struct network *cn = get_network(par, networkFile[0]);
 
 	/* group sizes */
 	struct ts_groupsizes * grpsizes = create_ts_groupsizes(par);
 
-	/* initiate population */
+	/* initiate population and stages */
 	struct metapopulation * metapop;
 	metapop = create_metapopulation(par);
+	struct stages * st = create_stages(metapop, par);
+	rng_set_stream(rng, 0, 0, 0, RNG_INIT);
+	struct nrm * engnrm = (*engine == 1) ? create_nrm(metapop, st, cn, par) : NULL;
 
 	/* get sampling schemes (timestep+effectives) */
 	translate_dates(par);
@@ -90,62 +206,191 @@ void R_epidemics(int *seqLength, double *mutRate, int *npop, int *nHostPerPop, d
 	/* create sample */
 	struct sample ** samplist = (struct sample **) malloc(tabdates->n * sizeof(struct sample *));
 	struct sample *samp;
+	int *dates;
 
 
-	/* MAKE METAPOPULATION EVOLVE */
+	/* MAKE METAPOPULATION EVOLVE - outputs are recorded at unit times */
 	nstep = 0;
 	while(get_total_nsus(metapop)>0 && (get_total_ninf(metapop)+get_total_nexp(metapop))>0 && nstep<par->duration){
 		nstep++;
 
-		/* age metapopulation */
-		age_metapopulation(metapop, par);
-
-		/* process infections */
-		for(j=0;j<get_npop(metapop);j++){
-			process_infections(get_populations(metapop)[j], metapop, cn, par);
+		/* simulate until next time step - one substream per unit of time */
+		rng_set_stream(rng, 0, nstep, 0, RNG_DYNAMICS);
+		if(*engine == 1){
+			nevents += nrm_until(engnrm, metapop, st, cn, (double) nstep, par);
+		} else {
+			nevents += tauleap_until(metapop, st, cn, &t, (double) nstep, par);
 		}
 
 		/* draw samples */
 		if((tabidx = int_in_vec(nstep, tabdates->items, tabdates->n)) > -1){ /* TRUE if step must be sampled */
+			rng_set_stream(rng, 0, nstep, 0, RNG_SAMPLING);
 			samplist[counter_sample++] = draw_sample(metapop, tabdates->times[tabidx], par);
 		}
 
 		fill_ts_groupsizes(grpsizes, metapop, nstep);
-
 	}
 
+	printf("\n%d %s performed over %d time steps\n", nevents, (*engine == 1) ? "events" : "leaps", nstep);
+
 	/* we stopped after 'nstep' steps */
 	if(nstep < par->duration){
 		printf("\nEpidemics ended at time %d, before last sampling time (%d).\n", nstep, par->duration);
 	} else {
+		/* merge samples */
+		samp = merge_samples(samplist, tabdates->n, par);
+		dates = get_sample_dates(samplist, tabdates->n, tabdates->items, tabdates->n);
+
+		/* write sample to file */
+		printf("\n\nWriting sample to file 'out-sample.%s'\n", *binary ? "bin" : "txt");
+		write_sample_file(samp, dates, *binary);
+
+		/* free memory */
+		free_sample(samp);
+		free(dates);
+	}
+
+	/* write group sizes to file */
+	printf("\n\nPrinting group sizes to file 'out-popsize.%s'\n", *binary ? "bin" : "txt");
+	write_ts_groupsizes_file(grpsizes, *binary);
+
+
+	/* free memory */
+	free_nrm(engnrm);
+	free_stages(st);
+	free_metapopulation(metapop);
+	free_param(par);
+	for(i=0;i<counter_sample;i++) free_sample(samplist[i]);
+	free(samplist);
+	free_table_int(tabdates);
+	free_network(cn);
+	free_ts_groupsizes(grpsizes);
+}
+
+
+
+
+
+
+
+/* Function to be called from R - individual-based engine on a host contact network */
+/* nHosts is the number of hosts; if nEdges >= 0, the network is given by */
+/* the edge list from/to (0-based host indices), otherwise it is read from */
+/* the binary edge list file edgeFile. directed is 0 for undirected contacts. */
+void R_epidemics_hostnet(int *seqLength, double *mutRate, int *nHosts, double *beta, int *nStart, int *t1, int *t2, int *Nsample, int *Tsample, int *duration, int *from, int *to, int *nEdges, int *directed, char **edgeFile, double *seed, int *binary){
+	int i, nstep, counter_sample = 0, tabidx;
+
+	/* Initialize random number generator */
+	gsl_rng * rng = create_rng((unsigned long) *seed);
+
+
+	/* host network */
+	struct hostgraph *g;
+	if(*nEdges >= 0){
+		g = create_hostgraph(*nHosts, from, to, (long) *nEdges, (bool) *directed);
+	} else {
+		g = read_hostgraph(*edgeFile, *nHosts, (bool) *directed);
+	}
+	print_hostgraph(g);
+
+
+	/* transfer simulation parameters - hosts form a single population */
+	struct param * par;
+	par = (struct param *) malloc(sizeof(struct param));
+	par->L = *seqLength;
+	par->mu = *mutRate;
+	par->muL = par->mu * par->L;
+	par->rng = rng;
+	par->npop = 1;
+	par->popsizes = &(g->n);
+	par->beta = *beta;
+	par->nstart = *nStart;
+	par->t1 = *t1;
+	par->t2 = *t2;
+	par->t_sample = Tsample;
+	par->n_sample = *Nsample;
+	par->duration = *duration;
+	par->cn_nb_nb = NULL;
+	par->cn_list_nb = NULL;
+	par->cn_weights = NULL;
+
+	/* check/print parameters */
+	check_param(par);
+	print_param(par);
+
+	/* group sizes */
+	struct ts_groupsizes * grpsizes = create_ts_groupsizes(par);
+
+	/* initiate population and seed hosts */
+	struct metapopulation * metapop;
+	metapop = create_metapopulation(par);
+	struct population * pop = get_populations(metapop)[0];
+	rng_set_stream(rng, 0, 0, 0, RNG_INIT);
+	struct hostnet * hn = create_hostnet(g, pop, par);
+
+	/* get sampling schemes (timestep+effectives) */
+	translate_dates(par);
+	struct table_int *tabdates = get_table_int(par->t_sample, par->n_sample);
+	printf("\n\nsampling at timesteps:");
+	print_table_int(tabdates);
+
+	/* create sample */
+	struct sample ** samplist = (struct sample **) malloc(tabdates->n * sizeof(struct sample *));
+	struct sample *samp;
+	int *dates;
+
+
+	/* MAKE EPIDEMIC SPREAD ON THE NETWORK */
+	nstep = 0;
+	while(get_nsus(pop)>0 && (get_ninf(pop)+get_nexp(pop))>0 && nstep<par->duration){
+		nstep++;
 
-		/* printf("\n\n-- FINAL METAPOPULATION --"); */
-		/* print_metapopulation(metapop, FALSE); */
+		/* age population */
+		age_metapopulation(metapop, par);
 
+		/* process infections */
+		rng_set_stream(rng, 0, nstep, 0, RNG_INFECTION);
+		process_host_infections(hn, pop, par);
+
+		/* draw samples */
+		if((tabidx = int_in_vec(nstep, tabdates->items, tabdates->n)) > -1){ /* TRUE if step must be sampled */
+			rng_set_stream(rng, 0, nstep, 0, RNG_SAMPLING);
+			samplist[counter_sample++] = draw_sample(metapop, tabdates->times[tabidx], par);
+		}
+
+		fill_ts_groupsizes(grpsizes, metapop, nstep);
+	}
+
+	/* we stopped after 'nstep' steps */
+	if(nstep < par->duration){
+		printf("\nEpidemics ended at time %d, before last sampling time (%d).\n", nstep, par->duration);
+	} else {
 		/* merge samples */
 		samp = merge_samples(samplist, tabdates->n, par);
+		dates = get_sample_dates(samplist, tabdates->n, tabdates->items, tabdates->n);
 
 		/* write sample to file */
-		printf("\n\nWriting sample to file 'out-sample.txt'\n");
-		write_sample(samp);
+		printf("\n\nWriting sample to file 'out-sample.%s'\n", *binary ? "bin" : "txt");
+		write_sample_file(samp, dates, *binary);
 
 		/* free memory */
 		free_sample(samp);
-
+		free(dates);
 	}
 
 	/* write group sizes to file */
-	printf("\n\nPrinting group sizes to file 'out-popsize.txt'\n");
-	write_ts_groupsizes(grpsizes);
+	printf("\n\nPrinting group sizes to file 'out-popsize.%s'\n", *binary ? "bin" : "txt");
+	write_ts_groupsizes_file(grpsizes, *binary);
 
 
 	/* free memory */
+	free_hostnet(hn);
 	free_metapopulation(metapop);
 	free_param(par);
 	for(i=0;i<counter_sample;i++) free_sample(samplist[i]);
 	free(samplist);
 	free_table_int(tabdates);
-	free_network(cn);
+	free_hostgraph(g);
 	free_ts_groupsizes(grpsizes);
 }
 
@@ -156,19 +401,12 @@ void R_epidemics(int *seqLength, double *mutRate, int *npop, int *nHostPerPop, d
 
 
 /* Function to be called from R */
-void R_monitor_epidemics(int *seqLength, double *mutRate, int *npop, int *nHostPerPop, double *beta, int *nStart, int *t1, int *t2, int *Nsample, int *Tsample, int *duration, int *nbnb, int *listnb, double *pdisp, int *minSize){
+void R_monitor_epidemics(int *seqLength, double *mutRate, int *npop, int *nHostPerPop, double *beta, int *nStart, int *t1, int *t2, int *Nsample, int *Tsample, int *duration, int *nbnb, int *listnb, double *pdisp, int *minSize, double *seed, int *binary){
 		int nstep;
 
 	/* Initialize random number generator */
 	int j;
-	time_t t;
-	t = time(NULL); // time in seconds, used to change the seed of the random generator
-	gsl_rng * rng;
-	const gsl_rng_type *typ;
-	gsl_rng_env_setup();
-	typ=gsl_rng_default;
-	rng=gsl_rng_alloc(typ);
-	gsl_rng_set(rng,t); // changes the seed of the random generator
+	gsl_rng * rng = create_rng((unsigned long) *seed);
 
 
 	/* transfer simulation parameters */
@@ -225,13 +463,15 @@ void R_monitor_epidemics(int *seqLength, double *mutRate, int *npop, int *nHostP
 		/* age metapopulation */
 		age_metapopulation(metapop, par);
 
-		/* process infections */
+		/* process infections - one substream per population */
 		for(j=0;j<get_npop(metapop);j++){
-			process_infections(get_populations(metapop)[j], metapop, cn, par);
+			rng_set_stream(rng, 0, nstep, j, RNG_INFECTION);
+			process_infections(get_populations(metapop)[j], metapop, cn, par, NULL);
 		}
 
 
 		/* draw sample */
+		rng_set_stream(rng, 0, nstep, 0, RNG_SAMPLING);
 		samp = draw_sample(metapop, par->n_sample, par);
 
 		/* compute statistics */
@@ -243,8 +483,8 @@ void R_monitor_epidemics(int *seqLength, double *mutRate, int *npop, int *nHostP
 
 	/* write group sizes to file */
 	printf("\n\nWriting results to file...");
-	write_ts_groupsizes(grpsizes);
-	write_ts_sumstat(sumstats);
+	write_ts_groupsizes_file(grpsizes, *binary);
+	write_ts_sumstat_file(sumstats, *binary);
 	printf("done.\n\n");
 
 	/* free memory */
@@ -274,19 +514,39 @@ void R_monitor_epidemics(int *seqLength, double *mutRate, int *npop, int *nHostP
 
 
 
+/* Parameter sweep read from a file (see paramfile.h), run without R */
+/* Scenarios and replicates are run by run_sweep over 'n.threads' threads, */
+/* and their results written to columnar files (see write_sweep_files). */
+void run_epidemics_file(char *file){
+	struct paramfile *pf = read_paramfile(file);
+	struct network *cn;
+	struct sweep *sw;
+
+	print_paramfile(pf);
+	cn = get_network(pf->par, pf->network);
+	sw = create_sweep(pf->theta, NULL, 0, pf->nscen, pf->nrep, pf->par->duration, pf->crn);
+	print_sweep(sw);
+
+	run_sweep(sw, pf->par, cn, pf->seed, pf->nthreads);
+
+	printf("\nWriting results to files '%s-sweep.bin' and '%s-popsize.bin'\n", pf->output, pf->output);
+	write_sweep_files(sw, pf->output);
+
+	/* free memory */
+	free_sweep(sw);
+	free_network(cn);
+	free_paramfile(pf);
+}
+
+
+
+
 /* all-in-one function testing epidemics growth, summary statistics, etc. */
-void test_epidemics(int seqLength, double mutRate, int npop, int *nHostPerPop, double beta, int nStart, int t1, int t2, int Nsample, int *Tsample, int duration, int *nbnb, int *listnb, double *pdisp){
+void test_epidemics(int seqLength, double mutRate, int npop, int *nHostPerPop, double beta, int nStart, int t1, int t2, int Nsample, int *Tsample, int duration, int *nbnb, int *listnb, double *pdisp, unsigned long seed){
 	int i, j, nstep=0, tabidx, counter_sample = 0;
 
 	/* Initialize random number generator */
-	time_t t;
-	t = time(NULL); // time in seconds, used to change the seed of the random generator
-	gsl_rng * rng;
-	const gsl_rng_type *typ;
-	gsl_rng_env_setup();
-	typ=gsl_rng_default;
-	rng=gsl_rng_alloc(typ);
-	gsl_rng_set(rng,t); // changes the seed of the random generator
+	gsl_rng * rng = create_rng(seed);
 
 
 	/* transfer simulation parameters */
@@ -345,13 +605,15 @@ void test_epidemics(int seqLength, double mutRate, int npop, int *nHostPerPop, d
 		/* age metapopulation */
 		age_metapopulation(metapop, par);
 
-		/* process infections */
+		/* process infections - one substream per population */
 		for(j=0;j<get_npop(metapop);j++){
-			process_infections(get_populations(metapop)[j], metapop, cn, par);
+			rng_set_stream(rng, 0, nstep, j, RNG_INFECTION);
+			process_infections(get_populations(metapop)[j], metapop, cn, par, NULL);
 		}
 
 		/* draw samples */
 		if((tabidx = int_in_vec(nstep, tabdates->items, tabdates->n)) > -1){ /* TRUE if step must be sampled */
+			rng_set_stream(rng, 0, nstep, 0, RNG_SAMPLING);
 			samplist[counter_sample++] = draw_sample(metapop, tabdates->times[tabidx], par);
 		}
 
@@ -450,7 +712,8 @@ void test_epidemics(int seqLength, double mutRate, int npop, int *nHostPerPop, d
 
 
 
-int main(){
+/* usage: epidemics [parameter file] - runs the test below without file */
+int main(int argc, char **argv){
 /* args: (int seqLength, double mutRate, int npop, int nHostPerPop, double beta, int nStart, int t1, int t2,int Tsample, int Nsample) */
 	double mu=1e-6, beta=2, pdisp[1]={1.0}; //pdisp[9] = {0.5,0.25,0.25,0.0,0.5,0.5,0.0,0.0,1.0};
 	time_t time1,time2;
@@ -459,8 +722,13 @@ int main(){
 	int nbnb[1] = {1};
 	int listnb[1] = {0};
 
+	if(argc > 1){
+		run_epidemics_file(argv[1]);
+		return 0;
+	}
+
 	time(&time1);
-	test_epidemics(genoL, mu, npop, popsize, beta, nstart, t1, t2, nsamp, tsamp, duration, nbnb, listnb, pdisp);
+	test_epidemics(genoL, mu, npop, popsize, beta, nstart, t1, t2, nsamp, tsamp, duration, nbnb, listnb, pdisp, (unsigned long) time(NULL));
 	time(&time2);
 	printf("\ntime ellapsed: %d seconds \n", (int) (time2-time1));
 	return 0;
@@ -472,20 +740,22 @@ int main(){
 /* gcc line:
 ## OPTIMIZED COMPILE - CHECK TIME ##
 
-   gcc -o epidemics param.c auxiliary.c pathogens.c populations.c dispersal.c infection.c sampling.c sumstat.c inout.c epidemics.c -Wall -O3 -lgsl -lgslcblas
+   gcc -o epidemics param.c auxiliary.c pathogens.c populations.c dispersal.c infection.c sampling.c sumstat.c inout.c stages.c tauleap.c nrm.c hostnet.c philox.c rng.c simulation.c abc.c sweep.c checkpoint.c splitting.c outstream.c eventlog.c genealogy.c spatial.c paramfile.c epidemics.c -Wall -O3 -fopenmp -pthread -lgsl -lgslcblas -lz
 
    ./epidemics
 
+   ./epidemics sweep.txt   # parameter sweep described by a file (see paramfile.h)
+
 
 ## FOR MEMORY LEAKS ##
 
-   gcc -o epidemics param.c auxiliary.c pathogens.c populations.c dispersal.c infection.c sampling.c sumstat.c inout.c epidemics.c -Wall -O0 -lgsl -lgslcblas
+   gcc -o epidemics param.c auxiliary.c pathogens.c populations.c dispersal.c infection.c sampling.c sumstat.c inout.c stages.c tauleap.c nrm.c hostnet.c philox.c rng.c simulation.c abc.c sweep.c checkpoint.c splitting.c outstream.c eventlog.c genealogy.c spatial.c paramfile.c epidemics.c -Wall -O0 -fopenmp -pthread -lgsl -lgslcblas -lz
 
    valgrind --leak-check=yes epidemics
 
 
 ## FOR PROFILING ##
-   gcc -o epidemics param.c auxiliary.c pathogens.c populations.c dispersal.c infection.c sampling.c sumstat.c inout.c epidemics.c -Wall -O3 -pg -lgsl -lgslcblas
+   gcc -o epidemics param.c auxiliary.c pathogens.c populations.c dispersal.c infection.c sampling.c sumstat.c inout.c stages.c tauleap.c nrm.c hostnet.c philox.c rng.c simulation.c abc.c sweep.c checkpoint.c splitting.c outstream.c eventlog.c genealogy.c spatial.c paramfile.c epidemics.c -Wall -O3 -pg -fopenmp -pthread -lgsl -lgslcblas -lz
 
    ./epidemics
 
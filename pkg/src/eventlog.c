@@ -0,0 +1,300 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions record the transmission tree (who infected whom).
+*/
+
+#include "common.h"
+#include "eventlog.h"
+
+/* maximum number of bytes of an int as a varint */
+#define VARINT_MAXLEN 5
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+/* Write 'x' as a varint at 'out'; returns the number of bytes */
+static int put_varint(unsigned char *out, unsigned int x){
+	int n = 0;
+	while(x >= 0x80){
+		out[n++] = (unsigned char) (x | 0x80);
+		x >>= 7;
+	}
+	out[n++] = (unsigned char) x;
+	return n;
+}
+
+
+
+/* Read a varint at position 'pos' of 'in' (of 'size' bytes) into 'x' */
+/* returns FALSE if the varint is truncated or too long */
+static bool get_varint(const unsigned char *in, long long size, long long *pos, unsigned int *x){
+	int shift = 0;
+	*x = 0;
+	while(*pos < size && shift < 7*VARINT_MAXLEN){
+		*x |= (unsigned int) (in[*pos] & 0x7f) << shift;
+		if((in[(*pos)++] & 0x80) == 0) return TRUE;
+		shift += 7;
+	}
+	return FALSE;
+}
+
+
+
+/* Check the blocks of a file and count its events; -1 if it is corrupted */
+static long long count_events(const unsigned char *buf, long long size){
+	long long pos = 8, n = 0;
+	unsigned int rep, nev, nbytes;
+
+	while(pos < size){
+		if(!get_varint(buf, size, &pos, &rep) || !get_varint(buf, size, &pos, &nev) || !get_varint(buf, size, &pos, &nbytes)) return -1;
+		if(nbytes > size - pos || (long long) nev * 5 > nbytes) return -1;
+		pos += nbytes;
+		n += nev;
+	}
+	return n;
+}
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+struct eventlog * create_eventlog(const char *file){
+	struct eventlog *out = (struct eventlog *) malloc(sizeof(struct eventlog));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: eventlog.c->create_eventlog]\nNo memory left for creating event log. Exiting.\n");
+		exit(1);
+	}
+
+	out->f = fopen(file, "wb");
+	if(out->f == NULL || fwrite(EVENTLOG_MAGIC, 1, 8, out->f) != 8){
+		fprintf(stderr, "\n[in: eventlog.c->create_eventlog]\nUnable to write file %s. Exiting.\n", file);
+		exit(1);
+	}
+	out->nevents = 0;
+
+	return out;
+}
+
+
+
+struct eventbuf * create_eventbuf(struct eventlog *log, int rep, int capacity){
+	struct eventbuf *out = (struct eventbuf *) malloc(sizeof(struct eventbuf));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: eventlog.c->create_eventbuf]\nNo memory left for creating event buffer. Exiting.\n");
+		exit(1);
+	}
+
+	out->capacity = capacity > 0 ? capacity : EVENTLOG_CAPACITY;
+	out->events = (struct infection_event *) malloc(out->capacity * sizeof(struct infection_event));
+	if(out->events == NULL){
+		fprintf(stderr, "\n[in: eventlog.c->create_eventbuf]\nNo memory left for creating event buffer. Exiting.\n");
+		exit(1);
+	}
+	out->log = log;
+	out->n = 0;
+	out->rep = rep;
+	out->step = 0;
+
+	return out;
+}
+
+
+
+/* Read an event log */
+/* The file is checked and its events counted before being decoded. */
+struct eventlist * read_eventlog(const char *file){
+	long long size, pos = 8, n, i = 0;
+	unsigned int rep, nev, nbytes, x[5], j, k;
+	int step;
+	unsigned char *buf;
+	struct eventlist *out;
+	FILE *f = fopen(file, "rb");
+
+	if(f == NULL) return NULL;
+	if(fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 8 || fseek(f, 0, SEEK_SET) != 0){
+		fclose(f);
+		return NULL;
+	}
+	buf = (unsigned char *) malloc((size_t) size);
+	if(buf == NULL){
+		fprintf(stderr, "\n[in: eventlog.c->read_eventlog]\nNo memory left for reading file %s. Exiting.\n", file);
+		exit(1);
+	}
+	if(fread(buf, 1, (size_t) size, f) != (size_t) size || memcmp(buf, EVENTLOG_MAGIC, 8) != 0 || (n = count_events(buf, size)) < 0){
+		fclose(f);
+		free(buf);
+		return NULL;
+	}
+	fclose(f);
+
+	/* allocate output */
+	out = (struct eventlist *) malloc(sizeof(struct eventlist));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: eventlog.c->read_eventlog]\nNo memory left for reading file %s. Exiting.\n", file);
+		exit(1);
+	}
+	out->n = n;
+	out->rep = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+	out->step = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+	out->frompop = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+	out->infector = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+	out->topop = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+	out->infectee = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+	if(out->rep == NULL || out->step == NULL || out->frompop == NULL || out->infector == NULL || out->topop == NULL || out->infectee == NULL){
+		fprintf(stderr, "\n[in: eventlog.c->read_eventlog]\nNo memory left for reading file %s. Exiting.\n", file);
+		exit(1);
+	}
+
+	/* decode blocks */
+	while(pos < size){
+		get_varint(buf, size, &pos, &rep);
+		get_varint(buf, size, &pos, &nev);
+		get_varint(buf, size, &pos, &nbytes);
+		step = 0;
+		for(j=0;j<nev;j++){
+			for(k=0;k<5;k++){
+				if(!get_varint(buf, size, &pos, x + k)){
+					free(buf);
+					free_eventlist(out);
+					return NULL;
+				}
+			}
+			step += (int) x[0];
+			out->rep[i] = (int) rep;
+			out->step[i] = step;
+			out->frompop[i] = (int) x[1] - 1;
+			out->infector[i] = (int) x[2] - 1;
+			out->topop[i] = (int) x[3];
+			out->infectee[i] = (int) x[4];
+			i++;
+		}
+	}
+
+	free(buf);
+	return out;
+}
+
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void close_eventlog(struct eventlog *in){
+	if(in == NULL) return;
+	if(fclose(in->f) != 0){
+		fprintf(stderr, "\n[in: eventlog.c->close_eventlog]\nUnable to write event log. Exiting.\n");
+		exit(1);
+	}
+	free(in);
+}
+
+
+
+void free_eventbuf(struct eventbuf *in){
+	if(in == NULL) return;
+	flush_eventbuf(in);
+	free(in->events);
+	free(in);
+}
+
+
+
+void free_eventlist(struct eventlist *in){
+	if(in == NULL) return;
+	free(in->rep);
+	free(in->step);
+	free(in->frompop);
+	free(in->infector);
+	free(in->topop);
+	free(in->infectee);
+	free(in);
+}
+
+
+
+
+/*
+   ===============================
+   === MAIN EXTERNAL FUNCTIONS ===
+   ===============================
+*/
+
+void add_infection_event(struct eventbuf *in, int frompop, int infector, int topop, int infectee){
+	struct infection_event *e;
+	if(in->n == in->capacity) flush_eventbuf(in);
+	e = in->events + in->n++;
+	e->step = in->step;
+	e->frompop = frompop;
+	e->infector = infector;
+	e->topop = topop;
+	e->infectee = infectee;
+}
+
+
+
+/* Write a block */
+/* Events are encoded by the calling thread; only the write itself is */
+/* done one thread at a time. */
+void flush_eventbuf(struct eventbuf *in){
+	int i, nbytes = 0, nhead = 0, prev = 0, ok = TRUE;
+	unsigned char *buf, head[3*VARINT_MAXLEN];
+	struct infection_event *e;
+
+	if(in->n == 0) return;
+	buf = (unsigned char *) malloc((size_t) in->n * 5 * VARINT_MAXLEN);
+	if(buf == NULL){
+		fprintf(stderr, "\n[in: eventlog.c->flush_eventbuf]\nNo memory left for writing events. Exiting.\n");
+		exit(1);
+	}
+
+	/* events, with times relative to the previous event */
+	for(i=0;i<in->n;i++){
+		e = in->events + i;
+		if(e->step < prev){
+			fprintf(stderr, "\n[in: eventlog.c->flush_eventbuf]\nEvents are not in chronological order. Exiting.\n");
+			exit(1);
+		}
+		nbytes += put_varint(buf + nbytes, (unsigned int) (e->step - prev));
+		nbytes += put_varint(buf + nbytes, (unsigned int) (e->frompop + 1));
+		nbytes += put_varint(buf + nbytes, (unsigned int) (e->infector + 1));
+		nbytes += put_varint(buf + nbytes, (unsigned int) e->topop);
+		nbytes += put_varint(buf + nbytes, (unsigned int) e->infectee);
+		prev = e->step;
+	}
+	nhead += put_varint(head + nhead, (unsigned int) in->rep);
+	nhead += put_varint(head + nhead, (unsigned int) in->n);
+	nhead += put_varint(head + nhead, (unsigned int) nbytes);
+
+#ifdef _OPENMP
+	#pragma omp critical(eventlog)
+#endif
+	{
+		ok = fwrite(head, 1, nhead, in->log->f) == (size_t) nhead && fwrite(buf, 1, nbytes, in->log->f) == (size_t) nbytes;
+		in->log->nevents += in->n;
+	}
+	if(!ok){
+		fprintf(stderr, "\n[in: eventlog.c->flush_eventbuf]\nUnable to write event log. Exiting.\n");
+		exit(1);
+	}
+
+	free(buf);
+	in->n = 0;
+}
@@ -0,0 +1,106 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions record the transmission tree (who infected whom).
+*/
+
+
+
+/*
+   ==================
+   === STRUCTURES ===
+   ==================
+*/
+
+/* Event log files */
+/* A host is identified by its population and its rank of infection in */
+/* this population (the index of its pathogen in the population, from 0). */
+/* Files are made of the magic string, then blocks of events of a */
+/* replicate. All numbers are unsigned LEB128 varints, so that files do */
+/* not depend on the byte order: a block is 'rep', the number of events, */
+/* the number of bytes of the events, then for each event the time step */
+/* minus that of the previous event of the block (the step itself for the */
+/* first one), frompop+1, infector+1, topop and infectee. Index cases */
+/* have no infector (frompop and infector are -1). */
+#define EVENTLOG_MAGIC "EPIDTREE"
+#define EVENTLOG_CAPACITY 4096 /* default capacity of buffers, in events */
+
+
+/* Infection of host 'infectee' of population 'topop' at time 'step' */
+struct infection_event{
+	int step, frompop, infector, topop, infectee;
+};
+
+
+/* Output file, shared by the replicates */
+struct eventlog{
+	FILE *f;
+	long long nevents;
+};
+
+
+/* Buffer of the events of a replicate */
+/* - 'step' is the current time step, set by the simulation */
+/* - once 'capacity' events are stored, they are written to 'log' as a */
+/* block, so that replicates run by different threads have their own */
+/* buffer and only take turns to write */
+struct eventbuf{
+	struct infection_event *events;
+	struct eventlog *log;
+	int n, capacity, rep, step;
+};
+
+
+/* Events read from a file, one array per field */
+struct eventlist{
+	int *rep, *step, *frompop, *infector, *topop, *infectee;
+	long long n;
+};
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+struct eventlog * create_eventlog(const char *file);
+
+/* 'capacity' <= 0 for the default */
+struct eventbuf * create_eventbuf(struct eventlog *log, int rep, int capacity);
+
+/* read a whole file; NULL if it cannot be read or is not an event log */
+struct eventlist * read_eventlog(const char *file);
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void close_eventlog(struct eventlog *in);
+
+/* writes the remaining events */
+void free_eventbuf(struct eventbuf *in);
+
+void free_eventlist(struct eventlist *in);
+
+
+
+/*
+   ==========================
+   === EXTERNAL FUNCTIONS ===
+   ==========================
+*/
+
+/* record an infection at the current step of 'in' */
+void add_infection_event(struct eventbuf *in, int frompop, int infector, int topop, int infectee);
+
+/* write the events of the buffer as a block (thread-safe) */
+void flush_eventbuf(struct eventbuf *in);
@@ -0,0 +1,278 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions build the genealogy of sampled isolates.
+*/
+
+#include "common.h"
+#include "auxiliary.h"
+#include "param.h"
+#include "pathogens.h"
+#include "genealogy.h"
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+/* Append formatted text to a growing string */
+/* 'x' has 'size' bytes, 'len' of which are used; at most 64 are added. */
+static char * append_text(char *x, long long *len, long long *size, const char *format, int value){
+	if(*len + 64 > *size){
+		*size *= 2;
+		x = (char *) realloc(x, (size_t) *size);
+		if(x == NULL){
+			fprintf(stderr, "\n[in: genealogy.c->append_text]\nNo memory left for writing tree. Exiting.\n");
+			exit(1);
+		}
+	}
+	*len += sprintf(x + *len, format, value);
+	return x;
+}
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+/* Genealogy of isolates */
+/* Ancestries are browsed backward once, as in reconstruct_sample, listing */
+/* the nodes of the induced subtree parents first. A single forward pass */
+/* then keeps isolates and nodes with several children, adding the lengths */
+/* of the removed nodes to the edges below them. No recursion is used, so */
+/* that the depth of the tree is not limited. */
+struct genealogy * get_genealogy(struct pathogen **isolates, int n){
+	int i, u, p, k, nnodes=0, maxnodes=2*n+1, chainsize, maxchain=64, anc, nroots=0, root=-1, count;
+	int *parent, *tip, *nbChildren, *top, *accgen, *accmut, *outid, gen, mut;
+	struct pathogen **nodes, **chain, *cur;
+	struct hash_ptr *map = create_hash_ptr(maxnodes);
+	struct genealogy *out;
+
+	nodes = (struct pathogen **) malloc(maxnodes * sizeof(struct pathogen *));
+	parent = (int *) malloc(maxnodes * sizeof(int));
+	chain = (struct pathogen **) malloc(maxchain * sizeof(struct pathogen *));
+	if(nodes == NULL || parent == NULL || chain == NULL){
+		fprintf(stderr, "\n[in: genealogy.c->get_genealogy]\nNo memory left to build genealogy. Exiting.\n");
+		exit(1);
+	}
+
+	/* LIST NODES OF THE INDUCED SUBTREE, PARENTS FIRST */
+	for(i=0;i<n;i++){
+		chainsize = 0;
+		cur = isolates[i];
+		while(cur != NULL && hash_ptr_get(map, cur) < 0){
+			if(chainsize == maxchain){
+				maxchain *= 2;
+				chain = (struct pathogen **) realloc(chain, maxchain * sizeof(struct pathogen *));
+				if(chain == NULL){
+					fprintf(stderr, "\n[in: genealogy.c->get_genealogy]\nNo memory left to build genealogy. Exiting.\n");
+					exit(1);
+				}
+			}
+			chain[chainsize++] = cur;
+			cur = get_ances(cur);
+		}
+		if(chainsize == 0){
+			fprintf(stderr, "\n[in: genealogy.c->get_genealogy]\nIsolate %d is given twice. Exiting.\n", i+1);
+			exit(1);
+		}
+		anc = (cur == NULL) ? -1 : hash_ptr_get(map, cur);
+
+		if(nnodes + chainsize > maxnodes){
+			while(nnodes + chainsize > maxnodes) maxnodes *= 2;
+			nodes = (struct pathogen **) realloc(nodes, maxnodes * sizeof(struct pathogen *));
+			parent = (int *) realloc(parent, maxnodes * sizeof(int));
+			if(nodes == NULL || parent == NULL){
+				fprintf(stderr, "\n[in: genealogy.c->get_genealogy]\nNo memory left to build genealogy. Exiting.\n");
+				exit(1);
+			}
+		}
+		for(k=chainsize-1;k>=0;k--){
+			nodes[nnodes] = chain[k];
+			parent[nnodes] = anc;
+			hash_ptr_set(map, chain[k], nnodes);
+			anc = nnodes++;
+		}
+	}
+
+	/* isolate of each node (-1 if none) and number of children */
+	tip = (int *) malloc((nnodes+1) * sizeof(int));
+	nbChildren = (int *) calloc(nnodes+1, sizeof(int));
+	top = (int *) malloc((nnodes+1) * sizeof(int));
+	accgen = (int *) malloc((nnodes+1) * sizeof(int));
+	accmut = (int *) malloc((nnodes+1) * sizeof(int));
+	outid = (int *) malloc((nnodes+1) * sizeof(int));
+	if(tip == NULL || nbChildren == NULL || top == NULL || accgen == NULL || accmut == NULL || outid == NULL){
+		fprintf(stderr, "\n[in: genealogy.c->get_genealogy]\nNo memory left to build genealogy. Exiting.\n");
+		exit(1);
+	}
+	for(u=0;u<nnodes;u++) tip[u] = -1;
+	for(i=0;i<n;i++) tip[hash_ptr_get(map, isolates[i])] = i;
+	for(u=0;u<nnodes;u++){
+		if(parent[u] < 0) nroots++; else nbChildren[parent[u]]++;
+	}
+
+	/* allocate output - at most n-1 internal nodes, plus a root */
+	out = (struct genealogy *) malloc(sizeof(struct genealogy));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: genealogy.c->get_genealogy]\nNo memory left to build genealogy. Exiting.\n");
+		exit(1);
+	}
+	out->ntip = n;
+	out->edge = (int *) malloc(2 * (2*n+1) * sizeof(int));
+	out->lengen = (int *) malloc((2*n+1) * sizeof(int));
+	out->lenmut = (int *) malloc((2*n+1) * sizeof(int));
+	if(out->edge == NULL || out->lengen == NULL || out->lenmut == NULL){
+		fprintf(stderr, "\n[in: genealogy.c->get_genealogy]\nNo memory left to build genealogy. Exiting.\n");
+		exit(1);
+	}
+
+	/* KEEP ISOLATES AND BRANCHING NODES, PARENTS FIRST */
+	/* 'top' is the kept node above each node (-1 if none), 'accgen' and */
+	/* 'accmut' the lengths of the removed nodes in between; isolates are */
+	/* copies of the pathogen sampled, at 0 generations and mutations of it. */
+	/* The first kept node is the root, unless there are several roots. */
+	count = n;
+	if(nroots > 1) root = ++count;
+	out->nedge = 0;
+	for(u=0;u<nnodes;u++){
+		p = parent[u];
+		if(p < 0){
+			top[u] = root;
+			accgen[u] = accmut[u] = 0;
+		} else if(outid[p] > 0){
+			top[u] = outid[p];
+			accgen[u] = accmut[u] = 0;
+		} else {
+			top[u] = top[p];
+			accgen[u] = accgen[p] + (parent[p] < 0 ? 0 : 1);
+			accmut[u] = accmut[p] + get_nb_snps(nodes[p]);
+		}
+
+		/* removed node */
+		outid[u] = -1;
+		if(tip[u] < 0 && nbChildren[u] < 2) continue;
+
+		/* kept node */
+		outid[u] = tip[u] >= 0 ? tip[u]+1 : ++count;
+		gen = tip[u] >= 0 || p < 0 ? 0 : 1;
+		mut = tip[u] >= 0 ? 0 : get_nb_snps(nodes[u]);
+		if(top[u] > 0){
+			out->edge[2*out->nedge] = top[u];
+			out->edge[2*out->nedge+1] = outid[u];
+			out->lengen[out->nedge] = accgen[u] + gen;
+			out->lenmut[out->nedge] = accmut[u] + mut;
+			out->nedge++;
+		}
+	}
+	out->nnode = count - n;
+
+	/* free temporary allocation */
+	free_hash_ptr(map);
+	free(nodes);
+	free(parent);
+	free(chain);
+	free(tip);
+	free(nbChildren);
+	free(top);
+	free(accgen);
+	free(accmut);
+	free(outid);
+
+	return out;
+}
+
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_genealogy(struct genealogy *in){
+	if(in == NULL) return;
+	free(in->edge);
+	free(in->lengen);
+	free(in->lenmut);
+	free(in);
+}
+
+
+
+
+/*
+   ===============================
+   === MAIN EXTERNAL FUNCTIONS ===
+   ===============================
+*/
+
+/* Newick string */
+/* Nodes are visited by an iterative depth-first search: a node is pushed */
+/* when entered, and its opposite when left, after its children. */
+char * get_newick(struct genealogy *in, bool mutations){
+	int i, node, top=0, nnodes = in->ntip + in->nnode, *first, *children, *len, *stack;
+	long long size = 64 + 32 * (long long) nnodes, n = 0;
+	char *out = (char *) malloc((size_t) size);
+
+	first = (int *) calloc(nnodes+2, sizeof(int));
+	children = (int *) malloc((in->nedge+1) * sizeof(int));
+	len = (int *) calloc(nnodes+1, sizeof(int));
+	stack = (int *) malloc((2*nnodes+1) * sizeof(int));
+	if(out == NULL || first == NULL || children == NULL || len == NULL || stack == NULL){
+		fprintf(stderr, "\n[in: genealogy.c->get_newick]\nNo memory left for writing tree. Exiting.\n");
+		exit(1);
+	}
+
+	/* children of each node (CSR: first[node]..first[node+1]-1) */
+	for(i=0;i<in->nedge;i++) first[in->edge[2*i]+1]++;
+	for(i=0;i<=nnodes;i++) first[i+1] += first[i];
+	for(i=0;i<in->nedge;i++){
+		children[first[in->edge[2*i]]++] = in->edge[2*i+1];
+		len[in->edge[2*i+1]] = mutations ? in->lenmut[i] : in->lengen[i];
+	}
+	for(i=nnodes;i>0;i--) first[i] = first[i-1];
+	first[0] = 0;
+
+	/* root: the only tip of a single isolate, node ntip+1 otherwise */
+	out[0] = '\0';
+	if(nnodes > 0) stack[top++] = in->nnode > 0 ? in->ntip+1 : 1;
+	while(top > 0){
+		node = stack[--top];
+		if(node < 0){ /* leaving an internal node */
+			node = -node;
+			out = append_text(out, &n, &size, "%c", ')');
+			if(node != in->ntip+1) out = append_text(out, &n, &size, ":%d", len[node]);
+			continue;
+		}
+
+		if(n > 0 && out[n-1] != '(') out = append_text(out, &n, &size, "%c", ',');
+		if(node <= in->ntip){
+			out = append_text(out, &n, &size, "%d", node);
+			if(in->nnode > 0) out = append_text(out, &n, &size, ":%d", len[node]);
+			continue;
+		}
+		out = append_text(out, &n, &size, "%c", '(');
+		stack[top++] = -node;
+		for(i=first[node+1]-1;i>=first[node];i--) stack[top++] = children[i];
+	}
+	out = append_text(out, &n, &size, "%c", ';');
+
+	free(first);
+	free(children);
+	free(len);
+	free(stack);
+
+	return out;
+}
@@ -0,0 +1,66 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions build the genealogy of sampled isolates.
+*/
+
+
+
+/*
+   ==================
+   === STRUCTURES ===
+   ==================
+*/
+
+/* Genealogy of 'ntip' isolates, as a tree with 'nnode' internal nodes */
+/* The tree is the subtree of the ancestries induced by the isolates, */
+/* where nodes with a single child are removed. Nodes are numbered as in */
+/* the 'phylo' class of the ape package: tips 1..ntip (in the order of the */
+/* isolates), the root ntip+1, then the other internal nodes. */
+/* - 'edge': parent and child of each of the 'nedge' edges */
+/* (edge[2*i], edge[2*i+1]) */
+/* - 'lengen': length of each edge in generations (transmissions) */
+/* - 'lenmut': length of each edge in mutations */
+/* Isolates descending from different initial pathogens are joined by a */
+/* root at the start of the epidemic, with edges of 0 generations. */
+struct genealogy{
+	int *edge, *lengen, *lenmut;
+	int ntip, nnode, nedge;
+};
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+/* 'isolates' are sampled pathogens (see reconstruct_sample), whose */
+/* ancestries must still exist */
+struct genealogy * get_genealogy(struct pathogen **isolates, int n);
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_genealogy(struct genealogy *in);
+
+
+
+/*
+   ==========================
+   === EXTERNAL FUNCTIONS ===
+   ==========================
+*/
+
+/* Newick string of the tree, with lengths in mutations if 'mutations' is */
+/* TRUE, in generations otherwise; tips are labelled 1..ntip */
+char * get_newick(struct genealogy *in, bool mutations);
@@ -0,0 +1,364 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions simulate transmission over an explicit host contact network.
+*/
+
+#include "common.h"
+#include "philox.h"
+#include "rng.h"
+#include "param.h"
+#include "pathogens.h"
+#include "populations.h"
+#include "hostnet.h"
+
+/* number of edges read at once from binary edge lists */
+#define EDGE_BUFFER_SIZE 65536
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+int get_degree(struct hostgraph *in, int host){
+	return (int) (in->offsets[host+1] - in->offsets[host]);
+}
+
+
+
+void print_hostgraph(struct hostgraph *in){
+	int i, deg, maxdeg=0;
+
+	for(i=0;i<in->n;i++){
+		deg = get_degree(in, i);
+		if(deg > maxdeg) maxdeg = deg;
+	}
+
+	printf("\nhost contact network");
+	printf("\nnb of hosts: %d", in->n);
+	printf("\nnb of (directed) edges: %ld", in->nedges);
+	printf("\nmean degree: %.2f   max degree: %d\n", ((double) in->nedges)/in->n, maxdeg);
+}
+
+
+
+
+/* The CSR arrays are built by counting sort in two passes over the edges: */
+/* alloc_hostgraph, then count_edge for each edge, then index_hostgraph, */
+/* then place_edge for each edge, then finish_hostgraph. */
+/* During the second pass offsets[i] is used as the insertion cursor of host i. */
+static struct hostgraph * alloc_hostgraph(int n){
+	struct hostgraph *out = (struct hostgraph *) malloc(sizeof(struct hostgraph));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: hostnet.c->alloc_hostgraph]\nNo memory left for creating host graph. Exiting.\n");
+		exit(1);
+	}
+
+	out->n = n;
+	out->nedges = 0;
+	out->nb = NULL;
+	out->offsets = (long *) calloc(n+1, sizeof(long));
+	if(out->offsets == NULL){
+		fprintf(stderr, "\n[in: hostnet.c->alloc_hostgraph]\nNo memory left for creating host graph. Exiting.\n");
+		exit(1);
+	}
+
+	return out;
+}
+
+
+
+static void check_edge(struct hostgraph *g, int a, int b){
+	if(a < 0 || b < 0 || a >= g->n || b >= g->n){
+		fprintf(stderr, "\n[in: hostnet.c->check_edge]\nEdge %d-%d refers to a host outside [0,%d[. Exiting.\n", a, b, g->n);
+		exit(1);
+	}
+}
+
+
+
+static void count_edge(struct hostgraph *g, int a, int b, bool directed){
+	if(a == b) return; /* self-contacts are ignored */
+	g->offsets[a+1]++;
+	if(!directed) g->offsets[b+1]++;
+}
+
+
+
+static void index_hostgraph(struct hostgraph *g){
+	int i;
+
+	for(i=1;i<=g->n;i++) g->offsets[i] += g->offsets[i-1];
+	g->nedges = g->offsets[g->n];
+
+	g->nb = (int *) malloc((g->nedges > 0 ? g->nedges : 1) * sizeof(int));
+	if(g->nb == NULL){
+		fprintf(stderr, "\n[in: hostnet.c->index_hostgraph]\nNo memory left for storing %ld edges. Exiting.\n", g->nedges);
+		exit(1);
+	}
+}
+
+
+
+static void place_edge(struct hostgraph *g, int a, int b, bool directed){
+	if(a == b) return;
+	g->nb[g->offsets[a]++] = b;
+	if(!directed) g->nb[g->offsets[b]++] = a;
+}
+
+
+
+/* cursors now point to the end of each row: shift them back */
+static void finish_hostgraph(struct hostgraph *g){
+	int i;
+
+	for(i=g->n;i>0;i--) g->offsets[i] = g->offsets[i-1];
+	g->offsets[0] = 0;
+}
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+/* Create a host graph from an edge list */
+/* Undirected edges are stored in both directions. */
+struct hostgraph * create_hostgraph(int n, int *from, int *to, long nedges, bool directed){
+	long i;
+	struct hostgraph *out = alloc_hostgraph(n);
+
+	for(i=0;i<nedges;i++){
+		check_edge(out, from[i], to[i]);
+		count_edge(out, from[i], to[i], directed);
+	}
+
+	index_hostgraph(out);
+
+	for(i=0;i<nedges;i++) place_edge(out, from[i], to[i], directed);
+
+	finish_hostgraph(out);
+
+	return out;
+}
+
+
+
+
+/* Read a host graph from a binary edge list */
+/* The file contains pairs of native 4-bytes integers (from, to), with hosts */
+/* indexed from 0. If n < 1, the number of hosts is the largest index + 1. */
+/* The file is streamed, so that the edge list is never held in memory. */
+struct hostgraph * read_hostgraph(char *file, int n, bool directed){
+	int i, nread, *buf;
+	struct hostgraph *out;
+	FILE *f = fopen(file, "rb");
+	if(f == NULL){
+		fprintf(stderr, "\n[in: hostnet.c->read_hostgraph]\nCannot open file %s. Exiting.\n", file);
+		exit(1);
+	}
+
+	buf = (int *) malloc(2 * EDGE_BUFFER_SIZE * sizeof(int));
+	if(buf == NULL){
+		fprintf(stderr, "\n[in: hostnet.c->read_hostgraph]\nNo memory left for reading edges. Exiting.\n");
+		exit(1);
+	}
+
+	/* find the number of hosts if needed */
+	if(n < 1){
+		n = 0;
+		while((nread = fread(buf, 2*sizeof(int), EDGE_BUFFER_SIZE, f)) > 0){
+			for(i=0;i<2*nread;i++) if(buf[i] >= n) n = buf[i] + 1;
+		}
+		rewind(f);
+	}
+
+	if(n < 1){
+		fprintf(stderr, "\n[in: hostnet.c->read_hostgraph]\nNo edge found in file %s. Exiting.\n", file);
+		exit(1);
+	}
+
+	out = alloc_hostgraph(n);
+
+	/* first pass: degrees */
+	while((nread = fread(buf, 2*sizeof(int), EDGE_BUFFER_SIZE, f)) > 0){
+		for(i=0;i<nread;i++){
+			check_edge(out, buf[2*i], buf[2*i+1]);
+			count_edge(out, buf[2*i], buf[2*i+1], directed);
+		}
+	}
+
+	index_hostgraph(out);
+	rewind(f);
+
+	/* second pass: neighbours */
+	while((nread = fread(buf, 2*sizeof(int), EDGE_BUFFER_SIZE, f)) > 0){
+		for(i=0;i<nread;i++) place_edge(out, buf[2*i], buf[2*i+1], directed);
+	}
+
+	finish_hostgraph(out);
+
+	free(buf);
+	fclose(f);
+
+	return out;
+}
+
+
+
+
+/* Create the state of an epidemic on a host graph */
+/* The pathogens initially in 'pop' are assigned to distinct random hosts. */
+struct hostnet * create_hostnet(struct hostgraph *g, struct population *pop, struct param *par){
+	int i, host, nini = get_nexpcum(pop);
+	struct hostnet *out = (struct hostnet *) malloc(sizeof(struct hostnet));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: hostnet.c->create_hostnet]\nNo memory left for creating host network. Exiting.\n");
+		exit(1);
+	}
+
+	if(get_popsize(pop) != g->n){
+		fprintf(stderr, "\n[in: hostnet.c->create_hostnet]\nPopulation size (%d) differs from the number of hosts in the graph (%d). Exiting.\n", get_popsize(pop), g->n);
+		exit(1);
+	}
+
+	out->g = g;
+	out->proba = 1.0 - exp(-par->beta);
+	out->nact = 0;
+	out->maxact = nini > 16 ? 2*nini : 32;
+	out->infected = (unsigned char *) calloc(g->n, sizeof(unsigned char));
+	out->acthost = (int *) malloc(out->maxact * sizeof(int));
+	out->actpat = (struct pathogen **) malloc(out->maxact * sizeof(struct pathogen *));
+	if(out->infected == NULL || out->acthost == NULL || out->actpat == NULL){
+		fprintf(stderr, "\n[in: hostnet.c->create_hostnet]\nNo memory left for creating host network. Exiting.\n");
+		exit(1);
+	}
+
+	/* seed initial infections */
+	for(i=0;i<nini;i++){
+		do{
+			host = (int) rng_uniform_int(par->rng, g->n);
+		} while(out->infected[host]);
+		out->infected[host] = 1;
+		out->acthost[out->nact] = host;
+		out->actpat[out->nact++] = get_pathogens(pop)[i];
+	}
+
+	return out;
+}
+
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_hostgraph(struct hostgraph *in){
+	if(in != NULL){
+		free(in->nb);
+		free(in->offsets);
+		free(in);
+	}
+}
+
+
+
+void free_hostnet(struct hostnet *in){
+	if(in != NULL){
+		free(in->infected);
+		free(in->acthost);
+		free(in->actpat);
+		free(in);
+	}
+}
+
+
+
+
+/*
+   ===============================
+   === MAIN EXTERNAL FUNCTIONS ===
+   ===============================
+*/
+
+/* add a new active host, growing the list if needed */
+static void add_active_host(struct hostnet *hn, int host, struct pathogen *pat){
+	if(hn->nact == hn->maxact){
+		hn->maxact *= 2;
+		hn->acthost = (int *) realloc(hn->acthost, hn->maxact * sizeof(int));
+		hn->actpat = (struct pathogen **) realloc(hn->actpat, hn->maxact * sizeof(struct pathogen *));
+		if(hn->acthost == NULL || hn->actpat == NULL){
+			fprintf(stderr, "\n[in: hostnet.c->add_active_host]\nNo memory left for storing active hosts. Exiting.\n");
+			exit(1);
+		}
+	}
+
+	hn->acthost[hn->nact] = host;
+	hn->actpat[hn->nact++] = pat;
+}
+
+
+
+
+/* PROCESS ALL INFECTIONS ON THE HOST GRAPH, FOR ONE GIVEN TIME STEP */
+/* Must be called after ageing the population. Only the frontier (infectious */
+/* hosts) is visited. Each edge transmits with the same probability, so the */
+/* index of the next transmitting edge is drawn directly from a geometric */
+/* distribution instead of testing edges one by one. */
+/* Returns the number of new infections. */
+int process_host_infections(struct hostnet *hn, struct population *pop, struct param *par){
+	int i, k, v, nact, nbnew = 0;
+	long j, end;
+	struct hostgraph *g = hn->g;
+	struct pathogen *ances;
+
+	/* DROP RECOVERED HOSTS FROM THE ACTIVE LIST */
+	k = 0;
+	for(i=0;i<hn->nact;i++){
+		if(get_age(hn->actpat[i]) > -1){
+			hn->acthost[k] = hn->acthost[i];
+			hn->actpat[k++] = hn->actpat[i];
+		}
+	}
+	hn->nact = k;
+
+	if(hn->proba <= 0.0) return 0;
+
+	/* TRANSMISSIONS FROM HOSTS INFECTIOUS AT THE START OF THE STEP */
+	nact = hn->nact;
+	for(i=0;i<nact;i++){
+		ances = hn->actpat[i];
+		if(get_age(ances) < par->t1) continue; /* still exposed */
+
+		end = g->offsets[hn->acthost[i]+1];
+		for(j = g->offsets[hn->acthost[i]] - 1 + rng_geometric(par->rng, hn->proba); j < end; j += rng_geometric(par->rng, hn->proba)){
+			v = g->nb[j];
+			if(hn->infected[v]) continue;
+
+			/* produce new pathogen */
+			hn->infected[v] = 1;
+			pop->pathogens[pop->nexpcum + nbnew] = replicate(ances, par);
+			add_active_host(hn, v, pop->pathogens[pop->nexpcum + nbnew]);
+			nbnew++;
+		}
+	}
+
+	/* UPDATE GROUP SIZES */
+	pop->nsus = pop->nsus - nbnew;
+	pop->nexpcum = pop->nexpcum + nbnew;
+	pop->nexp = pop->nexp + nbnew;
+
+	return nbnew;
+} /* end process_host_infections */
@@ -0,0 +1,96 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions simulate transmission over an explicit host contact network.
+*/
+
+
+/*
+   ==================
+   === STRUCTURES ===
+   ==================
+*/
+
+/* Host contact graph in compressed sparse row (CSR) format. */
+/* - 'n' is the number of hosts */
+/* - 'nedges' is the number of (directed) edges stored */
+/* - the contacts of host i are nb[offsets[i]] ... nb[offsets[i+1]-1] */
+/* Offsets are long integers so that graphs with more than 2^31 edges fit. */
+struct hostgraph{
+	int n, *nb;
+	long nedges, *offsets;
+};
+
+
+
+/* State of an individual-based epidemic on a host graph. */
+/* All pathogens are stored in a single population (one host = one slot), */
+/* so that ageing, sampling and group sizes are handled as for metapopulations. */
+/* - 'infected' is 1 for hosts which have ever been infected, 0 otherwise */
+/* - 'acthost' and 'actpat' list the exposed and infectious hosts and their */
+/*    pathogens; recovered hosts are dropped from this list at each step */
+/* - 'nact' is the number of active hosts, 'maxact' the allocated size */
+/* - 'proba' is the probability of transmission along one edge per time step */
+struct hostnet{
+	struct hostgraph *g;
+	unsigned char *infected;
+	int *acthost, nact, maxact;
+	struct pathogen **actpat;
+	double proba;
+};
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+/* build a graph from an edge list (from[i] -> to[i]), 0-based host indices */
+struct hostgraph * create_hostgraph(int n, int *from, int *to, long nedges, bool directed);
+
+/* read a graph from a binary edge list (pairs of 4-bytes integers, 0-based) */
+struct hostgraph * read_hostgraph(char *file, int n, bool directed);
+
+/* seed an epidemic on a graph; initial pathogens are those of 'pop' */
+struct hostnet * create_hostnet(struct hostgraph *g, struct population *pop, struct param *par);
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_hostgraph(struct hostgraph *in);
+
+/* note: does not free the graph nor the pathogens */
+void free_hostnet(struct hostnet *in);
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+int get_degree(struct hostgraph *in, int host);
+
+void print_hostgraph(struct hostgraph *in);
+
+
+
+/*
+   ==========================
+   === EXTERNAL FUNCTIONS ===
+   ==========================
+*/
+
+/* process transmissions from infectious hosts for one time step */
+int process_host_infections(struct hostnet *hn, struct population *pop, struct param *par);
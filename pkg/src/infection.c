@@ -7,11 +7,14 @@
 */
 
 #include "common.h"
+#include "philox.h"
+#include "rng.h"
 #include "auxiliary.h"
 #include "param.h"
 #include "pathogens.h"
 #include "populations.h"
 #include "dispersal.h"
+#include "eventlog.h"
 #include "infection.h"
 
 
@@ -43,44 +46,87 @@
 
 
 
+/* COMPUTE THE FORCE OF INFECTION EXERTED ON A POPULATION */
+/* \lambda_j = \beta w_{j->k} I_j/N_j for each neighbouring population j */
+/* is stored in lambdavec (allocated outside, one value per neighbour); */
+/* returns \lambda = \sum_j \lambda_j */
+double get_lambda(struct population * pop, struct metapopulation * metapop, struct network *cn, struct param * par, double *lambdavec){
+	int i, popid=get_popid(pop), nbNb=cn->nbNb[popid];
+	double lambda=0;
+	struct population *curpop;
+
+	for(i=0;i<nbNb;i++){
+		curpop = metapop->populations[cn->listNb[popid][i]];
+		lambdavec[i] = par->beta * cn->weights[popid][i] * ((double) get_ninf(curpop))/get_popsize(curpop);
+		lambda += lambdavec[i];
+	}
+
+	return lambda;
+}
+
+
+
+
+
 /* PROCESS ALL INFECTIONS IN ONE GIVEN POP, FOR ONE GIVEN TIME STEP */
-void process_infections(struct population * pop, struct metapopulation * metapop, struct network *cn, struct param * par){
-	int i, k, count, popid=get_popid(pop), nbNb=cn->nbNb[popid], nbnewcases, *nbnewcasesvec;
+void process_infections(struct population * pop, struct metapopulation * metapop, struct network *cn, struct param * par, struct eventbuf *events){
+	int i, k, count, popid=get_popid(pop), nbNb=cn->nbNb[popid], nbnewcases, *nbnewcasesvec, *ids = NULL;
 	double *lambdavec, lambda=0, proba=0;
-	struct pathogen * ances;
+	struct pathogen **newpat;
 	struct population *curpop;
 
 	/* COMPUTE \lambda_j = \beta w_{j->k} I_j/N_j for each neighbouring population j */
 	/* \lambda = \sum_j \lambda_j */
 	lambdavec = (double *) malloc(nbNb * sizeof(double));
-	for(i=0;i<nbNb;i++){
-		curpop = metapop->populations[cn->listNb[popid][i]];
-		lambdavec[i] = par->beta * cn->weights[popid][i] * ((double) get_ninf(curpop))/get_popsize(curpop);
-		lambda += lambdavec[i];
+	if(lambdavec == NULL){
+		fprintf(stderr, "\n[in: infection.c->process_infections]\nNo memory left for computing infection rates. Exiting.\n");
+		exit(1);
 	}
+	lambda = get_lambda(pop, metapop, cn, par, lambdavec);
 
 	/* COMPUTE PROBABILITY OF INFECTION PER SUSCEPTIBLE */
 	proba = 1 - exp(-lambda);
 
 	/* FIND NB OF NEW INFECTIONS SEEDED IN POP BY EACH NEIGHBOURING POPULATION */
-	nbnewcases = gsl_ran_binomial(par->rng, proba, get_nsus(pop));
+	nbnewcases = rng_binomial(par->rng, proba, get_nsus(pop));
 
 	/* DRAW NB OF ANCESTORS IN EACH NEIGHBOURING POPULATION */
 	nbnewcasesvec = malloc(nbNb * sizeof(int));
-	gsl_ran_multinomial(par->rng, nbNb, nbnewcases, lambdavec, (unsigned int *) nbnewcasesvec);
-
-	/* PRODUCE NEW PATHOGENS */
+	if(nbnewcasesvec == NULL){
+		fprintf(stderr, "\n[in: infection.c->process_infections]\nNo memory left for drawing new infections. Exiting.\n");
+		exit(1);
+	}
+	rng_multinomial(par->rng, nbNb, nbnewcases, lambdavec, (unsigned int *) nbnewcasesvec);
+
+	/* DETERMINE ANCESTORS - stored in the slots of the new pathogens */
+	rng_set_purpose(par->rng, RNG_ANCESTRY);
+	newpat = pop->pathogens + pop->nexpcum;
+	if(events != NULL && nbnewcases > 0){
+		ids = (int *) malloc(nbnewcases * sizeof(int));
+		if(ids == NULL){
+			fprintf(stderr, "\n[in: infection.c->process_infections]\nNo memory left for recording transmissions. Exiting.\n");
+			exit(1);
+		}
+	}
 	count = 0;
 	for(k=0;k<nbNb;k++){
 		curpop = metapop->populations[cn->listNb[popid][k]];
-		for(i=0;i<nbnewcasesvec[k];i++){
-			/* determine ancestor */
-			ances = select_random_infectious_pathogen(curpop, par);
-			/* produce new pathogen */
-			pop->pathogens[pop->nexpcum + count++] = replicate(ances, par);
+		select_random_infectious_pathogens(curpop, nbnewcasesvec[k], newpat + count, ids == NULL ? NULL : ids + count, par);
+		count += nbnewcasesvec[k];
+	}
+
+	/* RECORD TRANSMISSIONS - new hosts are ranked after the previous ones */
+	if(ids != NULL){
+		count = 0;
+		for(k=0;k<nbNb;k++){
+			for(i=0;i<nbnewcasesvec[k];i++,count++) add_infection_event(events, cn->listNb[popid][k], ids[count], popid, pop->nexpcum + count);
 		}
 	}
 
+	/* PRODUCE NEW PATHOGENS */
+	rng_set_purpose(par->rng, RNG_MUTATION);
+	replicate_cohort(newpat, nbnewcases, newpat, par);
+
 	/* UPDATE GROUP SIZES */
 	pop->nsus = pop->nsus - nbnewcases;
 	pop->nexpcum = pop->nexpcum + nbnewcases;
@@ -90,6 +136,7 @@ void process_infections(struct population * pop, struct metapopulation * metapop
 	/* FREE MEMORY AND RETURN */
 	free(lambdavec);
 	free(nbnewcasesvec);
+	free(ids);
 } /* end  process_infections */
 
 
@@ -99,7 +146,7 @@ void process_infections(struct population * pop, struct metapopulation * metapop
 
 /* gcc line:
 
-   gcc -o infection param.c auxiliary.c pathogens.c populations.c dispersal.c infection.c -Wall -O0 -lgsl -lgslcblas
+   gcc -o infection param.c auxiliary.c philox.c rng.c pathogens.c populations.c dispersal.c infection.c -Wall -O0 -lgsl -lgslcblas
 
    valgrind --leak-check=yes infection
 
@@ -7,5 +7,9 @@
 */
 
 
+/* COMPUTE THE FORCE OF INFECTION EXERTED ON A POPULATION */
+double get_lambda(struct population * pop, struct metapopulation * metapop, struct network *cn, struct param * par, double *lambdavec);
+
 /* SEED NEW INFECTION FROM A SINGLE PATHOGEN */
-void process_infections(struct population * pop, struct metapopulation * metapop, struct network *cn, struct param * par);
+/* infections are recorded in 'events', unless it is NULL */
+void process_infections(struct population * pop, struct metapopulation * metapop, struct network *cn, struct param * par, struct eventbuf *events);
@@ -14,6 +14,14 @@
 #include "sumstat.h"
 #include "inout.h"
 
+/* columnar files are mapped in memory where mmap is available */
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 
 
 /*
@@ -22,6 +30,63 @@
    ===========================
 */
 
+/* names of the columns of each kind of columnar file */
+static const char *colfile_grpnames[] = {"step", "nsus", "nexp", "ninf", "nrec", "nexpcum"};
+static const char *colfile_statnames[] = {"step", "nbSnps", "Hs", "meanNbSnps", "varNbSnps", "meanPairwiseDist", "varPairwiseDist", "meanPairwiseDistStd", "varPairwiseDistStd", "Fst"};
+static const char *colfile_sampnames[] = {"pop", "date", "rowptr", "colidx", "sites"};
+static const char *colfile_popdynnames[] = {"step", "pop", "nsus", "nexp", "ninf", "nrec", "nexpcum"};
+static const char *colfile_sweepnames[] = {"scenario", "rep", "nstep", "beta", "mu", "t1", "t2", "nbSnps", "Hs", "meanNbSnps", "varNbSnps", "meanPairwiseDist", "varPairwiseDist", "meanPairwiseDistStd", "varPairwiseDistStd", "Fst"};
+
+
+
+/* Start a new partition of a columnar file */
+static void new_colfile_partition(struct colfile *out, int id){
+	int ncol = out->h.ncol;
+
+	if(out->h.npart == out->maxpart){
+		out->maxpart *= 2;
+		out->ids = (int *) realloc(out->ids, out->maxpart * sizeof(int));
+		out->offset = (long long *) realloc(out->offset, out->maxpart * ncol * sizeof(long long));
+		out->length = (long long *) realloc(out->length, out->maxpart * ncol * sizeof(long long));
+		if(out->ids == NULL || out->offset == NULL || out->length == NULL){
+			fprintf(stderr, "\n[in: inout.c->new_colfile_partition]\nNo memory left for indexing partitions. Exiting.\n");
+			exit(1);
+		}
+	}
+
+	out->ids[out->h.npart] = id;
+	memset(out->offset + out->h.npart * ncol, 0, ncol * sizeof(long long));
+	memset(out->length + out->h.npart * ncol, 0, ncol * sizeof(long long));
+	out->h.npart++;
+}
+
+
+
+/* Write 'n' bytes of 'x', padded to 8 bytes */
+static void write_colfile_bytes(struct colfile *out, const void *x, long long n){
+	static const char zeros[8] = {0};
+	int pad = (int) ((8 - n % 8) % 8);
+
+	if((n > 0 && fwrite(x, 1, (size_t) n, out->f) != (size_t) n) || (pad > 0 && fwrite(zeros, 1, pad, out->f) != (size_t) pad)){
+		fprintf(stderr, "\n[in: inout.c->write_colfile_bytes]\nUnable to write file %s. Exiting.\n", out->tmpfile);
+		exit(1);
+	}
+	out->pos += n + pad;
+}
+
+
+
+/* Write the 'n' values of 'x' as column 'col' of the current partition */
+static void write_colfile_column(struct colfile *out, int col, const void *x, long long n){
+	long long k = (out->h.npart - 1) * out->h.ncol + col;
+	size_t size = out->cols[col].type == COLFILE_DOUBLE ? sizeof(double) : sizeof(int);
+
+	out->offset[k] = out->pos;
+	out->length[k] = n;
+	write_colfile_bytes(out, x, n * size);
+}
+
+
 
 
 
@@ -92,3 +157,372 @@ void write_sample(struct sample *in){
 	fclose(outfile);
 }
 
+
+
+
+
+
+/* names and number of the columns of a kind of table; NULL if unknown */
+const char ** get_colfile_names(int kind, int *ncol){
+	switch(kind){
+	case COLFILE_GROUPSIZES:
+		*ncol = 6;
+		return colfile_grpnames;
+	case COLFILE_SUMSTAT:
+		*ncol = 10;
+		return colfile_statnames;
+	case COLFILE_SAMPLE:
+		*ncol = 5;
+		return colfile_sampnames;
+	case COLFILE_POPDYN:
+		*ncol = 7;
+		return colfile_popdynnames;
+	case COLFILE_SWEEP:
+		*ncol = 16;
+		return colfile_sweepnames;
+	default:
+		*ncol = 0;
+		return NULL;
+	}
+}
+
+
+
+
+/* open a columnar file of a given kind (COLFILE_GROUPSIZES, ...) */
+struct colfile * create_colfile(const char *file, int kind){
+	int i;
+	const char **names;
+	struct colfile *out = (struct colfile *) calloc(1, sizeof(struct colfile));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: inout.c->create_colfile]\nNo memory left for creating output file. Exiting.\n");
+		exit(1);
+	}
+
+	/* header and columns */
+	memcpy(out->h.magic, COLFILE_MAGIC, 8);
+	out->h.version = COLFILE_VERSION;
+	out->h.byteorder = COLFILE_BYTEORDER;
+	out->h.kind = kind;
+	if((names = get_colfile_names(kind, &out->h.ncol)) == NULL){
+		fprintf(stderr, "\n[in: inout.c->create_colfile]\nUnknown kind of table (%d). Exiting.\n", kind);
+		exit(1);
+	}
+	out->cols = (struct colfile_column *) calloc(out->h.ncol, sizeof(struct colfile_column));
+	out->maxpart = 16;
+	out->ids = (int *) malloc(out->maxpart * sizeof(int));
+	out->offset = (long long *) malloc(out->maxpart * out->h.ncol * sizeof(long long));
+	out->length = (long long *) malloc(out->maxpart * out->h.ncol * sizeof(long long));
+	out->file = (char *) malloc(strlen(file) + 1);
+	out->tmpfile = (char *) malloc(strlen(file) + 5);
+	if(out->cols == NULL || out->ids == NULL || out->offset == NULL || out->length == NULL || out->file == NULL || out->tmpfile == NULL){
+		fprintf(stderr, "\n[in: inout.c->create_colfile]\nNo memory left for creating output file. Exiting.\n");
+		exit(1);
+	}
+	for(i=0;i<out->h.ncol;i++){
+		strncpy(out->cols[i].name, names[i], COLFILE_NAMELEN-1);
+		out->cols[i].type = ((kind == COLFILE_SUMSTAT && i > 1) || (kind == COLFILE_SWEEP && i > 2 && i != 5 && i != 6)) ? COLFILE_DOUBLE : COLFILE_INT;
+	}
+
+	/* write to a temporary file; the header is written last */
+	strcpy(out->file, file);
+	sprintf(out->tmpfile, "%s.tmp", file);
+	out->f = fopen(out->tmpfile, "wb");
+	if(out->f == NULL){
+		fprintf(stderr, "\n[in: inout.c->create_colfile]\nUnable to open file %s. Exiting.\n", out->tmpfile);
+		exit(1);
+	}
+	out->pos = sizeof(struct colfile_header);
+	if(fseek(out->f, (long) out->pos, SEEK_SET) != 0){
+		fprintf(stderr, "\n[in: inout.c->create_colfile]\nUnable to write file %s. Exiting.\n", out->tmpfile);
+		exit(1);
+	}
+
+	return out;
+}
+
+
+
+
+/* write the first 'nstep' group compositions as a partition */
+void write_ts_groupsizes_bin(struct ts_groupsizes *in, int nstep, int id, struct colfile *out){
+	int i, *step;
+	if(out->h.kind != COLFILE_GROUPSIZES || nstep > in->length){
+		fprintf(stderr, "\n[in: inout.c->write_ts_groupsizes_bin]\nWrong file or number of steps. Exiting.\n");
+		exit(1);
+	}
+	step = (int *) malloc((nstep > 0 ? nstep : 1) * sizeof(int));
+	if(step == NULL){
+		fprintf(stderr, "\n[in: inout.c->write_ts_groupsizes_bin]\nNo memory left for writing group sizes. Exiting.\n");
+		exit(1);
+	}
+	for(i=0;i<nstep;i++) step[i] = i+1;
+
+	new_colfile_partition(out, id);
+	write_colfile_column(out, 0, step, nstep);
+	write_colfile_column(out, 1, in->nsus, nstep);
+	write_colfile_column(out, 2, in->nexp, nstep);
+	write_colfile_column(out, 3, in->ninf, nstep);
+	write_colfile_column(out, 4, in->nrec, nstep);
+	write_colfile_column(out, 5, in->nexpcum, nstep);
+
+	free(step);
+}
+
+
+
+
+/* write summary statistics as a partition */
+void write_ts_sumstat_bin(struct ts_sumstat *in, int id, struct colfile *out){
+	if(out->h.kind != COLFILE_SUMSTAT){
+		fprintf(stderr, "\n[in: inout.c->write_ts_sumstat_bin]\nWrong kind of file. Exiting.\n");
+		exit(1);
+	}
+
+	new_colfile_partition(out, id);
+	write_colfile_column(out, 0, in->steps, in->length);
+	write_colfile_column(out, 1, in->nbSnps, in->length);
+	write_colfile_column(out, 2, in->Hs, in->length);
+	write_colfile_column(out, 3, in->meanNbSnps, in->length);
+	write_colfile_column(out, 4, in->varNbSnps, in->length);
+	write_colfile_column(out, 5, in->meanPairwiseDist, in->length);
+	write_colfile_column(out, 6, in->varPairwiseDist, in->length);
+	write_colfile_column(out, 7, in->meanPairwiseDistStd, in->length);
+	write_colfile_column(out, 8, in->varPairwiseDistStd, in->length);
+	write_colfile_column(out, 9, in->Fst, in->length);
+}
+
+
+
+
+/* write the genotypes of a sample as a partition */
+void write_genotypes_bin(struct genotypes *in, int id, struct colfile *out){
+	if(out->h.kind != COLFILE_SAMPLE){
+		fprintf(stderr, "\n[in: inout.c->write_genotypes_bin]\nWrong kind of file. Exiting.\n");
+		exit(1);
+	}
+
+	new_colfile_partition(out, id);
+	write_colfile_column(out, 0, in->popid, in->n);
+	write_colfile_column(out, 1, in->date, in->n);
+	write_colfile_column(out, 2, in->rowptr, in->n + 1);
+	write_colfile_column(out, 3, in->colidx, in->nnz);
+	write_colfile_column(out, 4, in->sites, in->nsites);
+}
+
+
+
+
+/* write 'nrec' records of integers, stored row by row, as a partition */
+/* (all columns of the table must be ints) */
+void write_records_bin(const int *rec, int nrec, int id, struct colfile *out){
+	int i, j, ncol = out->h.ncol;
+	int *col = (int *) malloc((nrec > 0 ? nrec : 1) * sizeof(int));
+	if(col == NULL){
+		fprintf(stderr, "\n[in: inout.c->write_records_bin]\nNo memory left for writing records. Exiting.\n");
+		exit(1);
+	}
+
+	new_colfile_partition(out, id);
+	for(j=0;j<ncol;j++){
+		if(out->cols[j].type != COLFILE_INT){
+			fprintf(stderr, "\n[in: inout.c->write_records_bin]\nColumn %s is not of integers. Exiting.\n", out->cols[j].name);
+			exit(1);
+		}
+		for(i=0;i<nrec;i++) col[i] = rec[i*ncol + j];
+		write_colfile_column(out, j, col, nrec);
+	}
+	free(col);
+}
+
+
+
+
+/* write 'n' values of each column as a partition */
+void write_columns_bin(void **cols, long long n, int id, struct colfile *out){
+	int j;
+	new_colfile_partition(out, id);
+	for(j=0;j<out->h.ncol;j++) write_colfile_column(out, j, cols[j], n);
+}
+
+
+
+
+/* write the directory and the header, and move the file to its name */
+void close_colfile(struct colfile *in){
+	long long ndir = (long long) in->h.npart * in->h.ncol;
+
+	in->h.diroffset = in->pos;
+	write_colfile_bytes(in, in->cols, in->h.ncol * sizeof(struct colfile_column));
+	write_colfile_bytes(in, in->ids, in->h.npart * sizeof(int));
+	write_colfile_bytes(in, in->offset, ndir * sizeof(long long));
+	write_colfile_bytes(in, in->length, ndir * sizeof(long long));
+	if(fseek(in->f, 0, SEEK_SET) != 0 || fwrite(&in->h, sizeof(struct colfile_header), 1, in->f) != 1 || fclose(in->f) != 0){
+		fprintf(stderr, "\n[in: inout.c->close_colfile]\nUnable to write file %s. Exiting.\n", in->tmpfile);
+		exit(1);
+	}
+
+	/* rename() does not replace existing files on all platforms */
+	if(rename(in->tmpfile, in->file) != 0 && (remove(in->file) != 0 || rename(in->tmpfile, in->file) != 0)){
+		fprintf(stderr, "\n[in: inout.c->close_colfile]\nUnable to rename %s into %s. Exiting.\n", in->tmpfile, in->file);
+		exit(1);
+	}
+
+	free(in->cols);
+	free(in->ids);
+	free(in->offset);
+	free(in->length);
+	free(in->file);
+	free(in->tmpfile);
+	free(in);
+}
+
+
+
+
+/* write results of a single run to out-popsize, out-sumstat and out-sample */
+/* files, as text (.txt) or as columnar binary files (.bin) */
+void write_ts_groupsizes_file(struct ts_groupsizes *in, bool binary){
+	struct colfile *out;
+	if(!binary){
+		write_ts_groupsizes(in);
+		return;
+	}
+	out = create_colfile("out-popsize.bin", COLFILE_GROUPSIZES);
+	write_ts_groupsizes_bin(in, in->length, 0, out);
+	close_colfile(out);
+}
+
+
+
+void write_ts_sumstat_file(struct ts_sumstat *in, bool binary){
+	struct colfile *out;
+	if(!binary){
+		write_ts_sumstat(in);
+		return;
+	}
+	out = create_colfile("out-sumstat.bin", COLFILE_SUMSTAT);
+	write_ts_sumstat_bin(in, 0, out);
+	close_colfile(out);
+}
+
+
+
+/* 'dates' (the time step of sampling of each isolate) is only written to */
+/* binary files, and may be NULL */
+void write_sample_file(struct sample *in, int *dates, bool binary){
+	struct colfile *out;
+	struct genotypes *gen;
+	if(!binary){
+		write_sample(in);
+		return;
+	}
+	gen = get_genotypes(in, dates);
+	out = create_colfile("out-sample.bin", COLFILE_SAMPLE);
+	write_genotypes_bin(gen, 0, out);
+	close_colfile(out);
+	free_genotypes(gen);
+}
+
+
+
+
+/* map a columnar file for reading */
+/* The file is mapped with mmap where available, and read into memory */
+/* otherwise. All blocks are checked to lie within the file. */
+struct colfile_map * map_colfile(const char *file){
+	int i;
+	long long k, ndir, dirsize, size;
+	struct colfile_map *out = (struct colfile_map *) calloc(1, sizeof(struct colfile_map));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: inout.c->map_colfile]\nNo memory left for reading file. Exiting.\n");
+		exit(1);
+	}
+
+#ifndef _WIN32
+	struct stat st;
+	int fd = open(file, O_RDONLY);
+	if(fd < 0 || fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(struct colfile_header)){
+		if(fd >= 0) close(fd);
+		free(out);
+		return NULL;
+	}
+	out->size = (long long) st.st_size;
+	out->buf = (char *) mmap(NULL, (size_t) out->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(out->buf == (char *) MAP_FAILED){
+		free(out);
+		return NULL;
+	}
+	out->mapped = TRUE;
+#else
+	FILE *f = fopen(file, "rb");
+	if(f == NULL){
+		free(out);
+		return NULL;
+	}
+	if(fseek(f, 0, SEEK_END) != 0 || (out->size = ftell(f)) < (long long) sizeof(struct colfile_header) || fseek(f, 0, SEEK_SET) != 0
+	   || (out->buf = (char *) malloc((size_t) out->size)) == NULL || fread(out->buf, 1, (size_t) out->size, f) != (size_t) out->size){
+		fclose(f);
+		free(out->buf);
+		free(out);
+		return NULL;
+	}
+	fclose(f);
+	out->mapped = FALSE;
+#endif
+
+	/* check header and directory */
+	memcpy(&out->h, out->buf, sizeof(struct colfile_header));
+	ndir = (long long) out->h.npart * out->h.ncol;
+	dirsize = out->h.ncol * sizeof(struct colfile_column) + (out->h.npart * sizeof(int) + 7) / 8 * 8 + 2 * ndir * sizeof(long long);
+	if(memcmp(out->h.magic, COLFILE_MAGIC, 8) != 0 || out->h.version != COLFILE_VERSION || out->h.byteorder != COLFILE_BYTEORDER
+	   || out->h.ncol < 1 || out->h.npart < 0 || out->h.diroffset < (long long) sizeof(struct colfile_header) || out->h.diroffset % 8 != 0
+	   || out->h.diroffset + dirsize > out->size){
+		unmap_colfile(out);
+		return NULL;
+	}
+	out->cols = (struct colfile_column *) (out->buf + out->h.diroffset);
+	out->ids = (int *) (out->cols + out->h.ncol);
+	out->offset = (long long *) (out->buf + out->h.diroffset + out->h.ncol * sizeof(struct colfile_column) + (out->h.npart * sizeof(int) + 7) / 8 * 8);
+	out->length = out->offset + ndir;
+
+	/* check blocks; names may fill their COLFILE_NAMELEN bytes */
+	for(i=0;i<out->h.ncol;i++){
+		if(out->cols[i].type != COLFILE_INT && out->cols[i].type != COLFILE_DOUBLE){
+			unmap_colfile(out);
+			return NULL;
+		}
+	}
+	for(k=0;k<ndir;k++){
+		size = out->length[k] * (out->cols[k % out->h.ncol].type == COLFILE_DOUBLE ? sizeof(double) : sizeof(int));
+		if(out->length[k] < 0 || (out->length[k] > 0 && (out->offset[k] < (long long) sizeof(struct colfile_header) || out->offset[k] % 8 != 0 || out->offset[k] + size > out->h.diroffset))){
+			unmap_colfile(out);
+			return NULL;
+		}
+	}
+
+	return out;
+}
+
+
+
+
+/* pointer to the block of column 'col' in partition 'part' */
+void * get_colfile_block(struct colfile_map *in, int part, int col){
+	return in->buf + in->offset[(long long) part * in->h.ncol + col];
+}
+
+
+
+
+/* release a mapped columnar file */
+void unmap_colfile(struct colfile_map *in){
+	if(in == NULL) return;
+#ifndef _WIN32
+	if(in->mapped) munmap(in->buf, (size_t) in->size);
+#else
+	free(in->buf);
+#endif
+	free(in);
+}
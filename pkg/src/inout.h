@@ -8,6 +8,80 @@
 
 
 
+/*
+   ==================
+   === STRUCTURES ===
+   ==================
+*/
+
+/* Columnar binary files */
+/* A file holds one table ('kind'), whose columns are stored as blocks of */
+/* ints or doubles. Rows may be split into partitions, e.g. one per */
+/* replicate, identified by 'id'; within a partition, columns may have */
+/* different lengths (e.g. isolates and their SNPs). */
+/* Layout: header, column blocks (each at an 8-byte boundary), then the */
+/* directory at 'diroffset': 'ncol' struct colfile_column, 'npart' ids */
+/* (padded to 8 bytes), then the offsets and the lengths (in elements) of */
+/* the blocks as long longs, partition by partition. Numbers are stored in */
+/* the byte order of the machine, given by 'byteorder'. */
+#define COLFILE_MAGIC "EPIDCOLS"
+#define COLFILE_VERSION 1
+#define COLFILE_BYTEORDER 0x01020304
+#define COLFILE_NAMELEN 24
+
+/* types of columns */
+#define COLFILE_INT 0
+#define COLFILE_DOUBLE 1
+
+/* kinds of tables */
+#define COLFILE_GROUPSIZES 1 /* step, nsus, nexp, ninf, nrec, nexpcum */
+#define COLFILE_SUMSTAT 2 /* step, nbSnps, then the 8 statistics */
+#define COLFILE_SAMPLE 3 /* genotypes of a sample: see below */
+#define COLFILE_POPDYN 4 /* step, pop, then the group sizes of the population */
+#define COLFILE_SWEEP 5 /* scenario, rep, nstep, beta, mu, t1, t2, then the */
+/* statistics of the final sample (NaN if the epidemic ended before) */
+
+/* Samples are stored as their genotypes (struct genotypes): columns pop */
+/* and date (one value per isolate), rowptr (n+1 values), colidx (one per */
+/* SNP of each isolate) and sites (the segregating sites), forming a sparse */
+/* isolate x site matrix in compressed sparse row format. */
+
+struct colfile_header{
+	char magic[8];
+	int version, byteorder, kind, ncol, npart, unused;
+	long long diroffset;
+};
+
+struct colfile_column{
+	char name[COLFILE_NAMELEN];
+	int type, unused;
+};
+
+
+/* Columnar file being written; partitions are appended one at a time */
+struct colfile{
+	FILE *f;
+	char *file, *tmpfile;
+	struct colfile_header h;
+	struct colfile_column *cols;
+	int maxpart, *ids;
+	long long pos, *offset, *length;
+};
+
+
+/* Columnar file mapped in memory for reading */
+struct colfile_map{
+	char *buf;
+	long long size;
+	int mapped;
+	struct colfile_header h;
+	struct colfile_column *cols;
+	int *ids;
+	long long *offset, *length;
+};
+
+
+
 
 /*
    ===========================
@@ -25,3 +99,38 @@
 void write_ts_groupsizes(struct ts_groupsizes *in);
 
 void write_sample(struct sample *in);
+
+/* columnar binary output: the file is written atomically by close_colfile */
+const char ** get_colfile_names(int kind, int *ncol);
+
+struct colfile * create_colfile(const char *file, int kind);
+
+void write_ts_groupsizes_bin(struct ts_groupsizes *in, int nstep, int id, struct colfile *out);
+
+void write_ts_sumstat_bin(struct ts_sumstat *in, int id, struct colfile *out);
+
+void write_genotypes_bin(struct genotypes *in, int id, struct colfile *out);
+
+void write_records_bin(const int *rec, int nrec, int id, struct colfile *out);
+
+/* write 'n' values of each column, given as arrays of ints or doubles */
+/* according to the types of the columns, as a partition */
+void write_columns_bin(void **cols, long long n, int id, struct colfile *out);
+
+void close_colfile(struct colfile *in);
+
+/* results of a single run, as text or columnar files */
+void write_ts_groupsizes_file(struct ts_groupsizes *in, bool binary);
+
+void write_ts_sumstat_file(struct ts_sumstat *in, bool binary);
+
+void write_sample_file(struct sample *in, int *dates, bool binary);
+
+/* map a columnar file for reading; returns NULL if it cannot be read or is */
+/* not a valid columnar file */
+struct colfile_map * map_colfile(const char *file);
+
+/* pointer to the block of column 'col' in partition 'part' */
+void * get_colfile_block(struct colfile_map *in, int part, int col);
+
+void unmap_colfile(struct colfile_map *in);
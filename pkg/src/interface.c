@@ -0,0 +1,1061 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions are called from R through .Call, and return their results
+  as R objects rather than through output files.
+*/
+
+/* R headers come first: common.h redefines TRUE/FALSE */
+#define R_NO_REMAP
+#include <R.h>
+#include <Rinternals.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "common.h"
+#include "auxiliary.h"
+#include "param.h"
+#include "pathogens.h"
+#include "populations.h"
+#include "sampling.h"
+#include "dispersal.h"
+#include "sumstat.h"
+#include "philox.h"
+#include "rng.h"
+#include "simulation.h"
+#include "checkpoint.h"
+#include "abc.h"
+#include "sweep.h"
+#include "splitting.h"
+#include "inout.h"
+#include "eventlog.h"
+#include "genealogy.h"
+#include "spatial.h"
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+/* Fill in template parameters from R arguments (no rng) */
+static struct param * param_from_R(SEXP seqLength, SEXP mutRate, SEXP npop, SEXP nHostPerPop, SEXP beta, SEXP nStart, SEXP t1, SEXP t2, SEXP Nsample, SEXP Tsample, SEXP duration, SEXP nbnb, SEXP listnb, SEXP pdisp){
+	struct param * par = (struct param *) calloc(1, sizeof(struct param));
+	if(par == NULL){
+		fprintf(stderr, "\n[in: interface.c->param_from_R]\nNo memory left for creating parameters. Exiting.\n");
+		exit(1);
+	}
+
+	par->L = INTEGER(seqLength)[0];
+	par->mu = REAL(mutRate)[0];
+	par->muL = par->mu * par->L;
+	par->rng = NULL;
+	par->npop = INTEGER(npop)[0];
+	par->popsizes = INTEGER(nHostPerPop);
+	par->beta = REAL(beta)[0];
+	par->nstart = INTEGER(nStart)[0];
+	par->t1 = INTEGER(t1)[0];
+	par->t2 = INTEGER(t2)[0];
+	par->t_sample = INTEGER(Tsample);
+	par->n_sample = INTEGER(Nsample)[0];
+	par->duration = INTEGER(duration)[0];
+	par->cn_nb_nb = INTEGER(nbnb);
+	par->cn_list_nb = INTEGER(listnb);
+	par->cn_weights = REAL(pdisp);
+
+	return par;
+}
+
+
+
+
+/* Live simulation driven from R through an external pointer */
+/* The handle owns the network and the population sizes, which the */
+/* parameters of the simulation point to. 'ndrawn' counts the samples */
+/* drawn on demand, each reading its own substream. */
+struct sim_handle{
+	struct simulation *sim;
+	struct network *cn;
+	int *popsizes, ndrawn;
+};
+
+
+
+/* Finalizer of simulation handles */
+static void free_sim_handle(SEXP x){
+	struct sim_handle *h = (struct sim_handle *) R_ExternalPtrAddr(x);
+	if(h != NULL){
+		free_simulation(h->sim);
+		free_network(h->cn);
+		free(h->popsizes);
+		free(h);
+		R_ClearExternalPtr(x);
+	}
+}
+
+
+
+/* Return the simulation of a handle; errors if it is not valid, e.g. after */
+/* being saved and reloaded in another session */
+static struct sim_handle * get_sim_handle(SEXP x){
+	struct sim_handle *h;
+	if(TYPEOF(x) != EXTPTRSXP || R_ExternalPtrTag(x) != Rf_install("epidemics_simulation")) Rf_error("not a simulation handle");
+	h = (struct sim_handle *) R_ExternalPtrAddr(x);
+	if(h == NULL) Rf_error("simulation handle is no longer valid");
+	return h;
+}
+
+
+
+
+/* Convert group sizes to an integer matrix (step, nsus, nexp, ninf, nrec, nexpcum) */
+static SEXP groupsizes_to_R(struct ts_groupsizes *in, int nstep){
+	int i, *x;
+	SEXP out = PROTECT(Rf_allocMatrix(INTSXP, nstep, 6));
+	x = INTEGER(out);
+
+	for(i=0;i<nstep;i++){
+		x[i] = i+1;
+		x[i + nstep] = in->nsus[i];
+		x[i + 2*nstep] = in->nexp[i];
+		x[i + 3*nstep] = in->ninf[i];
+		x[i + 4*nstep] = in->nrec[i];
+		x[i + 5*nstep] = in->nexpcum[i];
+	}
+
+	UNPROTECT(1);
+	return out;
+}
+
+
+
+
+/* Convert a sample to a list(gen, pop); gen is a list of SNP positions */
+static SEXP sample_to_R(struct sample *in){
+	int i, n = (in == NULL) ? 0 : get_n(in);
+	SEXP out = PROTECT(Rf_allocVector(VECSXP, 2));
+	SEXP names = PROTECT(Rf_allocVector(STRSXP, 2));
+	SEXP gen = PROTECT(Rf_allocVector(VECSXP, n));
+	SEXP pop = PROTECT(Rf_allocVector(INTSXP, n));
+	SEXP snps;
+
+	for(i=0;i<n;i++){
+		snps = Rf_allocVector(INTSXP, get_nb_snps(in->pathogens[i]));
+		SET_VECTOR_ELT(gen, i, snps);
+		if(get_nb_snps(in->pathogens[i]) > 0) memcpy(INTEGER(snps), get_snps(in->pathogens[i]), get_nb_snps(in->pathogens[i]) * sizeof(int));
+		INTEGER(pop)[i] = in->popid[i];
+	}
+
+	SET_VECTOR_ELT(out, 0, gen);
+	SET_VECTOR_ELT(out, 1, pop);
+	SET_STRING_ELT(names, 0, Rf_mkChar("gen"));
+	SET_STRING_ELT(names, 1, Rf_mkChar("pop"));
+	Rf_setAttrib(out, R_NamesSymbol, names);
+
+	UNPROTECT(4);
+	return out;
+}
+
+
+
+
+/* Order partitions of a columnar file by id, then by position in the file */
+static int compare_colfile_parts(const void *a, const void *b){
+	const int *x = (const int *) a, *y = (const int *) b;
+	if(x[0] != y[0]) return x[0] < y[0] ? -1 : 1;
+	return x[1] - y[1];
+}
+
+
+
+
+/*
+   ===============================
+   === MAIN EXTERNAL FUNCTIONS ===
+   ===============================
+*/
+
+/* Run nRep replicates of R_epidemics over nThreads threads */
+/* All replicates share the same dispersal network (read-only); each has its */
+/* own generator, reading the substreams of 'seed' indexed by the replicate, */
+/* so that results do not depend on the number of threads. Returns a list with one element */
+/* per replicate: list(popdyn = integer matrix, sample = list(gen, pop)); */
+/* 'sample' is NULL when the epidemic ended before 'duration'. */
+/* If 'files' gives two file names, replicates are instead written as they */
+/* complete to columnar files of group sizes and genotypes of the samples, */
+/* one partition per replicate (identified by its index), and NULL is */
+/* returned; a third file name adds the transmission events of all */
+/* replicates (see eventlog.h). 'network' names a binary network file */
+/* (see read_network) replacing nbnb, listnb and pdisp, or is empty. */
+SEXP R_epidemics_batch(SEXP seqLength, SEXP mutRate, SEXP npop, SEXP nHostPerPop, SEXP beta, SEXP nStart, SEXP t1, SEXP t2, SEXP Nsample, SEXP Tsample, SEXP duration, SEXP nbnb, SEXP listnb, SEXP pdisp, SEXP nRep, SEXP seed, SEXP nThreads, SEXP files, SEXP network){
+	int k, nrep = INTEGER(nRep)[0], *nsteps;
+	unsigned long baseseed = (unsigned long) REAL(seed)[0];
+	struct ts_groupsizes **grpsizes;
+	struct sample **samples;
+	struct colfile *grpfile = NULL, *sampfile = NULL;
+	struct eventlog *treefile = NULL;
+	SEXP out, elt, names;
+
+	/* parameters and network shared by all replicates */
+	struct param *par = param_from_R(seqLength, mutRate, npop, nHostPerPop, beta, nStart, t1, t2, Nsample, Tsample, duration, nbnb, listnb, pdisp);
+	check_param(par);
+	struct network *cn = get_network(par, CHAR(STRING_ELT(network, 0)));
+
+	/* output files */
+	if(Rf_length(files) >= 2){
+		grpfile = create_colfile(CHAR(STRING_ELT(files, 0)), COLFILE_GROUPSIZES);
+		sampfile = create_colfile(CHAR(STRING_ELT(files, 1)), COLFILE_SAMPLE);
+	}
+	if(Rf_length(files) == 3) treefile = create_eventlog(CHAR(STRING_ELT(files, 2)));
+
+	nsteps = (int *) calloc(nrep, sizeof(int));
+	grpsizes = (struct ts_groupsizes **) calloc(nrep, sizeof(struct ts_groupsizes *));
+	samples = (struct sample **) calloc(nrep, sizeof(struct sample *));
+	if(nsteps == NULL || grpsizes == NULL || samples == NULL){
+		fprintf(stderr, "\n[in: interface.c->R_epidemics_batch]\nNo memory left for storing replicates. Exiting.\n");
+		exit(1);
+	}
+
+	/* RUN REPLICATES */
+	/* only C structures are handled here - no R API call */
+#ifdef _OPENMP
+	int nthreads = INTEGER(nThreads)[0];
+	if(nthreads < 1) nthreads = omp_get_num_procs();
+	#pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+	for(k=0;k<nrep;k++){
+		struct simulation *sim = create_simulation(par, cn, baseseed, k);
+		if(treefile != NULL) sim->events = create_eventbuf(treefile, k, 0);
+		run_simulation(sim);
+		free_eventbuf(sim->events);
+		sim->events = NULL;
+		nsteps[k] = sim->nstep;
+		samples[k] = get_simulation_sample(sim);
+		if(grpfile != NULL){
+			struct genotypes *gen = NULL;
+			if(samples[k] != NULL){
+				int *dates = get_simulation_dates(sim);
+				gen = get_genotypes(samples[k], dates);
+				free(dates);
+				free_sample(samples[k]);
+			}
+
+			/* write and free the replicate, one thread at a time */
+#ifdef _OPENMP
+			#pragma omp critical(batch_output)
+#endif
+			{
+				write_ts_groupsizes_bin(sim->grpsizes, sim->nstep, k, grpfile);
+				if(gen != NULL) write_genotypes_bin(gen, k, sampfile);
+			}
+			free_genotypes(gen);
+			free_simulation(sim);
+			continue;
+		}
+		grpsizes[k] = sim->grpsizes; /* keep group sizes, free the rest */
+		sim->grpsizes = NULL;
+		free_simulation(sim);
+	}
+
+	/* replicates written to files */
+	if(grpfile != NULL){
+		close_colfile(grpfile);
+		close_colfile(sampfile);
+		close_eventlog(treefile);
+		free(nsteps);
+		free(grpsizes);
+		free(samples);
+		free_network(cn);
+		free(par);
+		return R_NilValue;
+	}
+
+	/* CONVERT RESULTS */
+	out = PROTECT(Rf_allocVector(VECSXP, nrep));
+	for(k=0;k<nrep;k++){
+		elt = PROTECT(Rf_allocVector(VECSXP, 2));
+		names = PROTECT(Rf_allocVector(STRSXP, 2));
+		SET_VECTOR_ELT(elt, 0, groupsizes_to_R(grpsizes[k], nsteps[k]));
+		if(samples[k] != NULL) SET_VECTOR_ELT(elt, 1, sample_to_R(samples[k]));
+		SET_STRING_ELT(names, 0, Rf_mkChar("popdyn"));
+		SET_STRING_ELT(names, 1, Rf_mkChar("sample"));
+		Rf_setAttrib(elt, R_NamesSymbol, names);
+		SET_VECTOR_ELT(out, k, elt);
+		UNPROTECT(2);
+
+		free_ts_groupsizes(grpsizes[k]);
+		if(samples[k] != NULL) free_sample(samples[k]);
+	}
+
+	/* free memory */
+	free(nsteps);
+	free(grpsizes);
+	free(samples);
+	free_network(cn);
+	free(par);
+
+	UNPROTECT(1);
+	return out;
+}
+
+
+
+
+/* Read a columnar file written by the writers of inout.c */
+/* 'columns' gives the names of the columns to read, and 'ids' the ids of */
+/* the partitions (e.g. replicates); empty vectors read all of them, */
+/* partitions being then ordered by id. Requested ids absent from the file */
+/* are skipped. Returns a named list with one vector per column, holding */
+/* the blocks of all partitions end to end, with attributes 'kind', */
+/* 'partitions' (the ids read) and 'lengths' (the lengths of the blocks, one */
+/* row per partition). Blocks are copied from the mapped file. */
+SEXP R_read_colfile(SEXP file, SEXP columns, SEXP ids){
+	int i, j, p, ncol, npart, nsel = 0, *colsel, *part, *sel, key[2], *first;
+	long long n;
+	size_t size;
+	char *x, *end;
+	SEXP out, names, lengths, partids, elt, kind;
+	struct colfile_map *in = map_colfile(CHAR(STRING_ELT(file, 0)));
+	if(in == NULL) Rf_error("%s is not a valid columnar file", CHAR(STRING_ELT(file, 0)));
+	npart = in->h.npart;
+
+	/* columns */
+	ncol = Rf_length(columns) > 0 ? Rf_length(columns) : in->h.ncol;
+	colsel = (int *) R_alloc(ncol, sizeof(int));
+	for(i=0;i<ncol;i++){
+		colsel[i] = i;
+		if(Rf_length(columns) == 0) continue;
+		for(j=0;j<in->h.ncol && strncmp(CHAR(STRING_ELT(columns, i)), in->cols[j].name, COLFILE_NAMELEN) != 0;j++);
+		if(j == in->h.ncol){
+			unmap_colfile(in);
+			Rf_error("no column %s in the file", CHAR(STRING_ELT(columns, i)));
+		}
+		colsel[i] = j;
+	}
+
+	/* partitions, sorted by id; a file may hold several partitions with the */
+	/* same id (e.g. streamed outputs), which are kept in the order written */
+	part = (int *) R_alloc(2 * npart + 1, sizeof(int));
+	for(p=0;p<npart;p++){
+		part[2*p] = in->ids[p];
+		part[2*p+1] = p;
+	}
+	qsort(part, npart, 2 * sizeof(int), compare_colfile_parts);
+	if(Rf_length(ids) == 0){
+		sel = (int *) R_alloc(npart + 1, sizeof(int));
+		for(p=0;p<npart;p++) sel[nsel++] = part[2*p+1];
+	} else {
+		/* first partition with each id, then the number of partitions */
+		first = (int *) R_alloc(Rf_length(ids), sizeof(int));
+		for(i=0;i<Rf_length(ids);i++){
+			key[0] = INTEGER(ids)[i];
+			key[1] = -1;
+			for(p=0, j=npart;p<j;){
+				if(compare_colfile_parts(part + 2*((p+j)/2), key) < 0) p = (p+j)/2 + 1; else j = (p+j)/2;
+			}
+			first[i] = p;
+			for(;p<npart && part[2*p] == key[0];p++) nsel++;
+		}
+		sel = (int *) R_alloc(nsel + 1, sizeof(int));
+		nsel = 0;
+		for(i=0;i<Rf_length(ids);i++){
+			for(p=first[i];p<npart && part[2*p] == INTEGER(ids)[i];p++) sel[nsel++] = part[2*p+1];
+		}
+	}
+
+	/* copy blocks */
+	out = PROTECT(Rf_allocVector(VECSXP, ncol));
+	names = PROTECT(Rf_allocVector(STRSXP, ncol));
+	lengths = PROTECT(Rf_allocMatrix(INTSXP, nsel, ncol));
+	partids = PROTECT(Rf_allocVector(INTSXP, nsel));
+	for(i=0;i<ncol;i++){
+		j = colsel[i];
+		size = in->cols[j].type == COLFILE_DOUBLE ? sizeof(double) : sizeof(int);
+		n = 0;
+		for(p=0;p<nsel;p++) n += in->length[(long long) sel[p] * in->h.ncol + j];
+		elt = Rf_allocVector(in->cols[j].type == COLFILE_DOUBLE ? REALSXP : INTSXP, (R_xlen_t) n);
+		SET_VECTOR_ELT(out, i, elt);
+		x = in->cols[j].type == COLFILE_DOUBLE ? (char *) REAL(elt) : (char *) INTEGER(elt);
+		for(p=0;p<nsel;p++){
+			n = in->length[(long long) sel[p] * in->h.ncol + j];
+			if(n > 0) memcpy(x, get_colfile_block(in, sel[p], j), (size_t) n * size);
+			x += n * size;
+			INTEGER(lengths)[p + i*nsel] = (int) n;
+		}
+		end = (char *) memchr(in->cols[j].name, '\0', COLFILE_NAMELEN);
+		SET_STRING_ELT(names, i, Rf_mkCharLen(in->cols[j].name, end != NULL ? (int) (end - in->cols[j].name) : COLFILE_NAMELEN));
+	}
+	for(p=0;p<nsel;p++) INTEGER(partids)[p] = in->ids[sel[p]];
+
+	kind = PROTECT(Rf_ScalarInteger(in->h.kind));
+
+	Rf_setAttrib(out, R_NamesSymbol, names);
+	Rf_setAttrib(out, Rf_install("kind"), kind);
+	Rf_setAttrib(out, Rf_install("partitions"), partids);
+	Rf_setAttrib(out, Rf_install("lengths"), lengths);
+
+	unmap_colfile(in);
+	UNPROTECT(5);
+	return out;
+}
+
+
+
+
+/* Read the transmission events of a file written by eventlog.c */
+/* Returns a list of integer vectors (rep, step, frompop, infector, topop, */
+/* infectee), in the order of the file; numbers are those of the C code */
+/* (from 0, -1 for the infector of index cases). */
+SEXP R_read_eventlog(SEXP file){
+	int k;
+	long long i;
+	int *x[6];
+	const char *fields[6] = {"rep", "step", "frompop", "infector", "topop", "infectee"};
+	SEXP out, names, elt;
+	struct eventlist *in = read_eventlog(CHAR(STRING_ELT(file, 0)));
+	if(in == NULL) Rf_error("%s is not a valid event log", CHAR(STRING_ELT(file, 0)));
+
+	x[0] = in->rep;
+	x[1] = in->step;
+	x[2] = in->frompop;
+	x[3] = in->infector;
+	x[4] = in->topop;
+	x[5] = in->infectee;
+	out = PROTECT(Rf_allocVector(VECSXP, 6));
+	names = PROTECT(Rf_allocVector(STRSXP, 6));
+	for(k=0;k<6;k++){
+		elt = Rf_allocVector(INTSXP, (R_xlen_t) in->n);
+		SET_VECTOR_ELT(out, k, elt);
+		for(i=0;i<in->n;i++) INTEGER(elt)[i] = x[k][i];
+		SET_STRING_ELT(names, k, Rf_mkChar(fields[k]));
+	}
+	Rf_setAttrib(out, R_NamesSymbol, names);
+
+	free_eventlist(in);
+	UNPROTECT(2);
+	return out;
+}
+
+
+
+
+/* Write the dispersal network of a metapopulation to a binary network */
+/* file (see dispersal.h); 'nbnb', 'listnb' and 'pdisp' are as in */
+/* R_epidemics_batch, weights being standardized as by create_network. */
+SEXP R_write_network(SEXP npop, SEXP nbnb, SEXP listnb, SEXP pdisp, SEXP file){
+	struct param par;
+	struct network *cn;
+
+	memset(&par, 0, sizeof(struct param));
+	par.npop = INTEGER(npop)[0];
+	par.cn_nb_nb = INTEGER(nbnb);
+	par.cn_list_nb = INTEGER(listnb);
+	par.cn_weights = REAL(pdisp);
+
+	cn = create_network(&par);
+	write_network(cn, CHAR(STRING_ELT(file, 0)));
+	free_network(cn);
+
+	return R_NilValue;
+}
+
+
+
+
+/* Connection network between points of coordinates 'x' and 'y' (see */
+/* spatial.h); 'type' is that of chooseCn: 1 (Delaunay), 5 (distance, */
+/* between 'd1' and 'd2') or 6 ('k' nearest neighbours, symmetrized if */
+/* 'sym'). Returns the number of neighbours of each point, neighbours */
+/* (from 1) and distances. */
+SEXP R_spatial_graph(SEXP x, SEXP y, SEXP type, SEXP k, SEXP d1, SEXP d2, SEXP sym){
+	int i, n = Rf_length(x);
+	const char *onames[3] = {"nbnb", "listnb", "dist"};
+	struct spatialgraph *g = NULL;
+	SEXP out, names, nbnb, listnb, dist;
+
+	switch(INTEGER(type)[0]){
+	case 1:
+		g = get_delaunay_graph(REAL(x), REAL(y), n);
+		break;
+	case 5:
+		g = get_dist_graph(REAL(x), REAL(y), n, REAL(d1)[0], REAL(d2)[0]);
+		break;
+	case 6:
+		g = get_knn_graph(REAL(x), REAL(y), n, INTEGER(k)[0], (bool) LOGICAL(sym)[0]);
+		break;
+	default:
+		Rf_error("no native graph of type %d", INTEGER(type)[0]);
+	}
+
+	out = PROTECT(Rf_allocVector(VECSXP, 3));
+	names = PROTECT(Rf_allocVector(STRSXP, 3));
+	nbnb = PROTECT(Rf_allocVector(INTSXP, n));
+	listnb = PROTECT(Rf_allocVector(INTSXP, g->nedges));
+	dist = PROTECT(Rf_allocVector(REALSXP, g->nedges));
+	for(i=0;i<n;i++) INTEGER(nbnb)[i] = g->offsets[i+1] - g->offsets[i];
+	for(i=0;i<g->nedges;i++){
+		INTEGER(listnb)[i] = g->nb[i] + 1;
+		REAL(dist)[i] = g->dist[i];
+	}
+	SET_VECTOR_ELT(out, 0, nbnb);
+	SET_VECTOR_ELT(out, 1, listnb);
+	SET_VECTOR_ELT(out, 2, dist);
+	for(i=0;i<3;i++) SET_STRING_ELT(names, i, Rf_mkChar(onames[i]));
+	Rf_setAttrib(out, R_NamesSymbol, names);
+
+	free_spatialgraph(g);
+	UNPROTECT(5);
+	return out;
+}
+
+
+
+
+/* Parameter sweep over scenarios */
+/* The first arguments are those of R_epidemics_batch. 'theta' gives the */
+/* values of beta, mu, t1 and t2 of each scenario (one row per scenario, */
+/* stored row by row), 'weights' their dispersal weights (same layout, or */
+/* empty to use 'pdisp'); each scenario is run nRep times, under common */
+/* random numbers if 'crn' is TRUE. Returns list(grpsizes = group sizes */
+/* (step, group, replicate, scenario), stats = statistics of the final */
+/* samples (statistic, replicate, scenario), nstep = steps performed). */
+SEXP R_epidemics_sweep(SEXP seqLength, SEXP mutRate, SEXP npop, SEXP nHostPerPop, SEXP beta, SEXP nStart, SEXP t1, SEXP t2, SEXP Nsample, SEXP Tsample, SEXP duration, SEXP nbnb, SEXP listnb, SEXP pdisp, SEXP theta, SEXP weights, SEXP nRep, SEXP crn, SEXP seed, SEXP nThreads){
+	int k, nscen = Rf_length(theta) / SWEEP_NPAR, nrun;
+	SEXP out, names, grp, stats, nstep;
+	const char *onames[3] = {"grpsizes", "stats", "nstep"};
+
+	struct param *par = param_from_R(seqLength, mutRate, npop, nHostPerPop, beta, nStart, t1, t2, Nsample, Tsample, duration, nbnb, listnb, pdisp);
+	check_param(par);
+	struct network *cn = create_network(par);
+	struct sweep *sw = create_sweep(REAL(theta), Rf_length(weights) > 0 ? REAL(weights) : NULL, Rf_length(pdisp), nscen, INTEGER(nRep)[0], par->duration, (bool) LOGICAL(crn)[0]);
+
+	/* only C structures are handled here - no R API call */
+	run_sweep(sw, par, cn, (unsigned long) REAL(seed)[0], INTEGER(nThreads)[0]);
+
+	/* CONVERT RESULTS */
+	nrun = sw->nscen * sw->nrep;
+	out = PROTECT(Rf_allocVector(VECSXP, 3));
+	names = PROTECT(Rf_allocVector(STRSXP, 3));
+	grp = PROTECT(Rf_allocVector(INTSXP, nrun * sw->duration * SWEEP_NGRP));
+	stats = PROTECT(Rf_allocVector(REALSXP, nrun * SUMSTAT_NSTAT));
+	nstep = PROTECT(Rf_allocVector(INTSXP, nrun));
+	memcpy(INTEGER(grp), sw->grpsizes, nrun * sw->duration * SWEEP_NGRP * sizeof(int));
+	memcpy(REAL(stats), sw->stats, nrun * SUMSTAT_NSTAT * sizeof(double));
+	memcpy(INTEGER(nstep), sw->nstep, nrun * sizeof(int));
+	SET_VECTOR_ELT(out, 0, grp);
+	SET_VECTOR_ELT(out, 1, stats);
+	SET_VECTOR_ELT(out, 2, nstep);
+	for(k=0;k<3;k++) SET_STRING_ELT(names, k, Rf_mkChar(onames[k]));
+	Rf_setAttrib(out, R_NamesSymbol, names);
+
+	/* free memory */
+	free_sweep(sw);
+	free_network(cn);
+	free(par);
+
+	UNPROTECT(5);
+	return out;
+}
+
+
+
+/* Epidemics conditioned on large outbreaks, by multilevel splitting */
+/* The first arguments are those of R_epidemics_batch; 'levels' gives the */
+/* increasing numbers of cumulative cases used as levels, and nTraj the */
+/* number of trajectories of each stage. Returns list(nreached = number of */
+/* trajectories reaching each level, proba = estimated probability of */
+/* reaching the last one, grpsizes = group sizes (step, group, trajectory) */
+/* and stats = statistics of the final samples (statistic, trajectory) of */
+/* the conditioned trajectories, nstep = their steps performed, nstepsim = */
+/* number of time steps simulated). */
+SEXP R_epidemics_split(SEXP seqLength, SEXP mutRate, SEXP npop, SEXP nHostPerPop, SEXP beta, SEXP nStart, SEXP t1, SEXP t2, SEXP Nsample, SEXP Tsample, SEXP duration, SEXP nbnb, SEXP listnb, SEXP pdisp, SEXP levels, SEXP nTraj, SEXP seed, SEXP nThreads){
+	int k;
+	SEXP out, names, nreached, grp, stats, nstep;
+	const char *onames[6] = {"nreached", "proba", "grpsizes", "stats", "nstep", "nstepsim"};
+
+	struct param *par = param_from_R(seqLength, mutRate, npop, nHostPerPop, beta, nStart, t1, t2, Nsample, Tsample, duration, nbnb, listnb, pdisp);
+	check_param(par);
+	struct network *cn = create_network(par);
+	struct splitting *sp = create_splitting(INTEGER(levels), Rf_length(levels), INTEGER(nTraj)[0], par->duration);
+
+	/* only C structures are handled here - no R API call */
+	run_splitting(sp, par, cn, (unsigned long) REAL(seed)[0], INTEGER(nThreads)[0]);
+
+	/* CONVERT RESULTS */
+	out = PROTECT(Rf_allocVector(VECSXP, 6));
+	names = PROTECT(Rf_allocVector(STRSXP, 6));
+	nreached = PROTECT(Rf_allocVector(INTSXP, sp->nlevels));
+	grp = PROTECT(Rf_allocVector(INTSXP, sp->ntraj * sp->duration * SWEEP_NGRP));
+	stats = PROTECT(Rf_allocVector(REALSXP, sp->ntraj * SUMSTAT_NSTAT));
+	nstep = PROTECT(Rf_allocVector(INTSXP, sp->ntraj));
+	memcpy(INTEGER(nreached), sp->nreached, sp->nlevels * sizeof(int));
+	memcpy(INTEGER(grp), sp->grpsizes, sp->ntraj * sp->duration * SWEEP_NGRP * sizeof(int));
+	memcpy(REAL(stats), sp->stats, sp->ntraj * SUMSTAT_NSTAT * sizeof(double));
+	memcpy(INTEGER(nstep), sp->nstep, sp->ntraj * sizeof(int));
+	SET_VECTOR_ELT(out, 0, nreached);
+	SET_VECTOR_ELT(out, 1, Rf_ScalarReal(sp->proba));
+	SET_VECTOR_ELT(out, 2, grp);
+	SET_VECTOR_ELT(out, 3, stats);
+	SET_VECTOR_ELT(out, 4, nstep);
+	SET_VECTOR_ELT(out, 5, Rf_ScalarReal(sp->nstepsim));
+	for(k=0;k<6;k++) SET_STRING_ELT(names, k, Rf_mkChar(onames[k]));
+	Rf_setAttrib(out, R_NamesSymbol, names);
+
+	/* free memory */
+	free_splitting(sp);
+	free_network(cn);
+	free(par);
+
+	UNPROTECT(6);
+	return out;
+}
+
+
+/* Create a simulation handle */
+/* The first arguments are those of R_epidemics_batch; the simulation reads */
+/* the substreams of replicate 'rep' of 'seed', and 'network' is as in */
+/* R_epidemics_batch. Returns an external pointer, freed by the garbage */
+/* collector. */
+SEXP R_sim_create(SEXP seqLength, SEXP mutRate, SEXP npop, SEXP nHostPerPop, SEXP beta, SEXP nStart, SEXP t1, SEXP t2, SEXP Nsample, SEXP Tsample, SEXP duration, SEXP nbnb, SEXP listnb, SEXP pdisp, SEXP seed, SEXP rep, SEXP network){
+	int i;
+	SEXP out;
+	struct param *par = param_from_R(seqLength, mutRate, npop, nHostPerPop, beta, nStart, t1, t2, Nsample, Tsample, duration, nbnb, listnb, pdisp);
+	struct sim_handle *h = (struct sim_handle *) malloc(sizeof(struct sim_handle));
+	if(h == NULL){
+		fprintf(stderr, "\n[in: interface.c->R_sim_create]\nNo memory left for creating simulation. Exiting.\n");
+		exit(1);
+	}
+	check_param(par);
+
+	/* population sizes are copied, so that the handle does not depend on R memory */
+	h->popsizes = (int *) malloc(par->npop * sizeof(int));
+	if(h->popsizes == NULL){
+		fprintf(stderr, "\n[in: interface.c->R_sim_create]\nNo memory left for creating simulation. Exiting.\n");
+		exit(1);
+	}
+	for(i=0;i<par->npop;i++) h->popsizes[i] = par->popsizes[i];
+	par->popsizes = h->popsizes;
+	h->cn = get_network(par, CHAR(STRING_ELT(network, 0)));
+	h->sim = create_simulation(par, h->cn, (unsigned long) REAL(seed)[0], INTEGER(rep)[0]);
+	h->ndrawn = 0;
+	free(par);
+
+	out = PROTECT(R_MakeExternalPtr(h, Rf_install("epidemics_simulation"), R_NilValue));
+	R_RegisterCFinalizerEx(out, free_sim_handle, TRUE);
+	UNPROTECT(1);
+	return out;
+}
+
+
+
+/* Perform up to 'k' time steps; returns the number of steps performed */
+SEXP R_sim_step(SEXP handle, SEXP k){
+	int i, n = INTEGER(k)[0];
+	struct sim_handle *h = get_sim_handle(handle);
+	for(i=0;i<n && step_simulation(h->sim);i++);
+	return Rf_ScalarInteger(i);
+}
+
+
+
+/* Current group sizes: integer matrix with one row per population and */
+/* columns nsus, nexp, ninf, nrec, nexpcum */
+SEXP R_sim_counts(SEXP handle){
+	int j, npop, *x;
+	struct population *pop;
+	struct sim_handle *h = get_sim_handle(handle);
+	SEXP out;
+
+	npop = get_npop(h->sim->metapop);
+	out = PROTECT(Rf_allocMatrix(INTSXP, npop, 5));
+	x = INTEGER(out);
+	for(j=0;j<npop;j++){
+		pop = get_populations(h->sim->metapop)[j];
+		x[j] = get_nsus(pop);
+		x[j + npop] = get_nexp(pop);
+		x[j + 2*npop] = get_ninf(pop);
+		x[j + 3*npop] = get_nrec(pop);
+		x[j + 4*npop] = get_nexpcum(pop);
+	}
+
+	UNPROTECT(1);
+	return out;
+}
+
+
+
+/* Draw a sample of 'n' isolates now, as list(gen, pop); the simulation is */
+/* left unchanged, apart from the random numbers of later samples drawn */
+/* this way */
+SEXP R_sim_sample(SEXP handle, SEXP n){
+	struct sim_handle *h = get_sim_handle(handle);
+	struct sample *samp;
+	SEXP out;
+
+	rng_set_stream(h->sim->par->rng, h->sim->rep, h->sim->nstep, ++h->ndrawn, RNG_SAMPLING);
+	samp = draw_sample(h->sim->metapop, INTEGER(n)[0], h->sim->par);
+	out = PROTECT(sample_to_R(samp));
+	free_sample(samp);
+
+	UNPROTECT(1);
+	return out;
+}
+
+
+
+/* Statistics of the samples drawn so far at the sampling dates (NA if */
+/* none), and group sizes since the start as in R_epidemics_batch: */
+/* list(stats, popdyn, nstep) */
+SEXP R_sim_stats(SEXP handle){
+	int i, j, k, n=0;
+	struct sim_handle *h = get_sim_handle(handle);
+	struct sample *samp;
+	SEXP out, names, stats;
+	const char *onames[3] = {"stats", "popdyn", "nstep"};
+
+	out = PROTECT(Rf_allocVector(VECSXP, 3));
+	names = PROTECT(Rf_allocVector(STRSXP, 3));
+	stats = PROTECT(Rf_allocVector(REALSXP, SUMSTAT_NSTAT));
+	for(k=0;k<SUMSTAT_NSTAT;k++) REAL(stats)[k] = NA_REAL;
+
+	/* pool the samples without copying isolates */
+	for(i=0;i<h->sim->nsamp;i++) n += get_n(h->sim->samplist[i]);
+	if(n > 0){
+		samp = create_sample(n);
+		n = 0;
+		for(i=0;i<h->sim->nsamp;i++){
+			for(j=0;j<get_n(h->sim->samplist[i]);j++){
+				samp->pathogens[n] = h->sim->samplist[i]->pathogens[j];
+				samp->popid[n++] = h->sim->samplist[i]->popid[j];
+			}
+		}
+		get_sumstat_vector(samp, h->sim->par, REAL(stats));
+		for(i=0;i<n;i++) samp->pathogens[i] = NULL; /* isolates belong to the simulation */
+		free_sample(samp);
+	}
+
+	SET_VECTOR_ELT(out, 0, stats);
+	SET_VECTOR_ELT(out, 1, groupsizes_to_R(h->sim->grpsizes, h->sim->nstep));
+	SET_VECTOR_ELT(out, 2, Rf_ScalarInteger(h->sim->nstep));
+	for(k=0;k<3;k++) SET_STRING_ELT(names, k, Rf_mkChar(onames[k]));
+	Rf_setAttrib(out, R_NamesSymbol, names);
+
+	UNPROTECT(3);
+	return out;
+}
+
+
+
+
+/* Genealogy of the samples drawn so far at the dates t_sample */
+/* Returns a list with the edges (integer matrix, one row per edge: parent, */
+/* child), the number of internal nodes, the lengths of the edges in */
+/* generations and in mutations, the Newick strings of the tree with either */
+/* lengths, and the population and date of each isolate (tip). */
+SEXP R_sim_genealogy(SEXP handle){
+	int i, j, k, n=0, *dates;
+	char *newick;
+	struct sim_handle *h = get_sim_handle(handle);
+	struct pathogen **isolates;
+	struct genealogy *gen;
+	SEXP out, names, edge, x, pop, date;
+	const char *onames[7] = {"edge", "Nnode", "generations", "mutations", "newick", "pop", "date"};
+
+	for(i=0;i<h->sim->nsamp;i++) n += get_n(h->sim->samplist[i]);
+	if(n == 0) Rf_error("no isolate has been sampled");
+
+	/* isolates are not copied: their ancestries belong to the simulation */
+	isolates = (struct pathogen **) R_alloc(n, sizeof(struct pathogen *));
+	pop = PROTECT(Rf_allocVector(INTSXP, n));
+	n = 0;
+	for(i=0;i<h->sim->nsamp;i++){
+		for(j=0;j<get_n(h->sim->samplist[i]);j++){
+			isolates[n] = h->sim->samplist[i]->pathogens[j];
+			INTEGER(pop)[n++] = h->sim->samplist[i]->popid[j];
+		}
+	}
+	date = PROTECT(Rf_allocVector(INTSXP, n));
+	dates = get_simulation_dates(h->sim);
+	for(i=0;i<n;i++) INTEGER(date)[i] = dates[i];
+	free(dates);
+
+	gen = get_genealogy(isolates, n);
+
+	out = PROTECT(Rf_allocVector(VECSXP, 7));
+	names = PROTECT(Rf_allocVector(STRSXP, 7));
+	edge = Rf_allocMatrix(INTSXP, gen->nedge, 2);
+	SET_VECTOR_ELT(out, 0, edge);
+	for(k=0;k<gen->nedge;k++){
+		INTEGER(edge)[k] = gen->edge[2*k];
+		INTEGER(edge)[k + gen->nedge] = gen->edge[2*k+1];
+	}
+	SET_VECTOR_ELT(out, 1, Rf_ScalarInteger(gen->nnode));
+	x = Rf_allocVector(INTSXP, gen->nedge);
+	SET_VECTOR_ELT(out, 2, x);
+	for(k=0;k<gen->nedge;k++) INTEGER(x)[k] = gen->lengen[k];
+	x = Rf_allocVector(INTSXP, gen->nedge);
+	SET_VECTOR_ELT(out, 3, x);
+	for(k=0;k<gen->nedge;k++) INTEGER(x)[k] = gen->lenmut[k];
+	x = Rf_allocVector(STRSXP, 2);
+	SET_VECTOR_ELT(out, 4, x);
+	for(k=0;k<2;k++){
+		newick = get_newick(gen, k == 1);
+		SET_STRING_ELT(x, k, Rf_mkChar(newick));
+		free(newick);
+	}
+	SET_VECTOR_ELT(out, 5, pop);
+	SET_VECTOR_ELT(out, 6, date);
+	for(k=0;k<7;k++) SET_STRING_ELT(names, k, Rf_mkChar(onames[k]));
+	Rf_setAttrib(out, R_NamesSymbol, names);
+
+	free_genealogy(gen);
+	UNPROTECT(4);
+	return out;
+}
+
+
+/* Save the state of the simulation of a handle to 'file' */
+SEXP R_sim_save(SEXP handle, SEXP file){
+	struct sim_handle *h = get_sim_handle(handle);
+	save_simulation(h->sim, NULL, CHAR(STRING_ELT(file, 0)));
+	return R_NilValue;
+}
+
+
+
+/* Replace the simulation of a handle by one saved in 'file' */
+/* The parameters and network of the handle are used as in */
+/* load_simulation, which checks that they match the file; 'rep' is -1 to */
+/* resume the saved replicate. Returns the replicate of the new simulation. */
+SEXP R_sim_load(SEXP handle, SEXP file, SEXP rep){
+	struct sim_handle *h = get_sim_handle(handle);
+	struct simulation *sim = load_simulation(CHAR(STRING_ELT(file, 0)), h->sim->par, h->cn, INTEGER(rep)[0], NULL);
+	free_simulation(h->sim);
+	h->sim = sim;
+	h->ndrawn = 0;
+	return Rf_ScalarInteger(sim->rep);
+}
+
+
+
+
+/* Rejection ABC on beta, mu, t1 and t2 */
+/* The first arguments are those of R_epidemics_batch; values of the */
+/* estimated parameters are overwritten by draws from the uniform priors */
+/* [prMin, prMax]. 'obs' and 'scale' are the observed statistics and their */
+/* scales (see abc.h); 'obsTs' holds the observed group sizes, step by step */
+/* (possibly empty), 'scaleTs' their scales, and 'early' is TRUE to stop */
+/* replicates which cannot be accepted. Returns list(theta = matrix of */
+/* accepted parameters, dist = their distances, nsim = number of simulations, */
+/* scale = scales used, scalets = scales of group sizes, early = numbers of */
+/* replicates stopped early, of time steps run, and of time steps saved). */
+SEXP R_epidemics_abc(SEXP seqLength, SEXP mutRate, SEXP npop, SEXP nHostPerPop, SEXP beta, SEXP nStart, SEXP t1, SEXP t2, SEXP Nsample, SEXP Tsample, SEXP duration, SEXP nbnb, SEXP listnb, SEXP pdisp, SEXP prMin, SEXP prMax, SEXP obs, SEXP scale, SEXP obsTs, SEXP scaleTs, SEXP early, SEXP tol, SEXP nSim, SEXP maxAccept, SEXP seed, SEXP nThreads){
+	int i, k;
+	SEXP out, names, theta, dist, sc, scts, ear;
+	const char *onames[6] = {"theta", "dist", "nsim", "scale", "scalets", "early"};
+
+	struct param *par = param_from_R(seqLength, mutRate, npop, nHostPerPop, beta, nStart, t1, t2, Nsample, Tsample, duration, nbnb, listnb, pdisp);
+	check_param(par);
+	struct network *cn = create_network(par);
+	struct abc *abc = create_abc(REAL(prMin), REAL(prMax), REAL(obs), REAL(scale), REAL(tol)[0], INTEGER(maxAccept)[0]);
+	set_abc_timeseries(abc, REAL(obsTs), REAL(scaleTs), Rf_length(obsTs) / ABC_NTS, (bool) LOGICAL(early)[0]);
+
+	/* only C structures are handled here - no R API call */
+	run_abc_rejection(abc, par, cn, (unsigned long) REAL(seed)[0], INTEGER(nSim)[0], INTEGER(nThreads)[0]);
+
+	/* CONVERT RESULTS */
+	out = PROTECT(Rf_allocVector(VECSXP, 6));
+	names = PROTECT(Rf_allocVector(STRSXP, 6));
+	theta = PROTECT(Rf_allocMatrix(REALSXP, abc->nacc, ABC_NPAR));
+	dist = PROTECT(Rf_allocVector(REALSXP, abc->nacc));
+	sc = PROTECT(Rf_allocVector(REALSXP, SUMSTAT_NSTAT));
+	scts = PROTECT(Rf_allocVector(REALSXP, ABC_NTS));
+	ear = PROTECT(Rf_allocVector(REALSXP, 3));
+	for(i=0;i<abc->nacc;i++){
+		for(k=0;k<ABC_NPAR;k++) REAL(theta)[k*abc->nacc + i] = abc->theta[i*ABC_NPAR + k];
+		REAL(dist)[i] = abc->dist[i];
+	}
+	for(k=0;k<SUMSTAT_NSTAT;k++) REAL(sc)[k] = abc->scale[k];
+	for(k=0;k<ABC_NTS;k++) REAL(scts)[k] = abc->scalets[k];
+	REAL(ear)[0] = abc->nabort;
+	REAL(ear)[1] = abc->nstep;
+	REAL(ear)[2] = abc->nskip;
+	SET_VECTOR_ELT(out, 0, theta);
+	SET_VECTOR_ELT(out, 1, dist);
+	SET_VECTOR_ELT(out, 2, Rf_ScalarInteger(abc->nsim));
+	SET_VECTOR_ELT(out, 3, sc);
+	SET_VECTOR_ELT(out, 4, scts);
+	SET_VECTOR_ELT(out, 5, ear);
+	for(k=0;k<6;k++) SET_STRING_ELT(names, k, Rf_mkChar(onames[k]));
+	Rf_setAttrib(out, R_NamesSymbol, names);
+
+	/* free memory */
+	free_abc(abc);
+	free_network(cn);
+	free(par);
+
+	UNPROTECT(7);
+	return out;
+}
+
+
+
+/* ABC-SMC on beta, mu, t1 and t2 */
+/* Arguments are as in R_epidemics_abc; see abc.h for the others. Returns */
+/* list(theta, weights, dist, nsim, scale, gen = matrix with one row per */
+/* generation: tolerance, number of simulations, time in seconds, */
+/* scalets, early), the last two being as in R_epidemics_abc. */
+SEXP R_epidemics_abc_smc(SEXP seqLength, SEXP mutRate, SEXP npop, SEXP nHostPerPop, SEXP beta, SEXP nStart, SEXP t1, SEXP t2, SEXP Nsample, SEXP Tsample, SEXP duration, SEXP nbnb, SEXP listnb, SEXP pdisp, SEXP prMin, SEXP prMax, SEXP obs, SEXP scale, SEXP obsTs, SEXP scaleTs, SEXP early, SEXP nPart, SEXP nGen, SEXP alpha, SEXP minTol, SEXP minAcc, SEXP maxSim, SEXP seed, SEXP nThreads){
+	int i, k, n, ng;
+	SEXP out, names, theta, weights, dist, sc, gen, scts, ear;
+	const char *onames[8] = {"theta", "weights", "dist", "nsim", "scale", "gen", "scalets", "early"};
+
+	struct param *par = param_from_R(seqLength, mutRate, npop, nHostPerPop, beta, nStart, t1, t2, Nsample, Tsample, duration, nbnb, listnb, pdisp);
+	check_param(par);
+	struct network *cn = create_network(par);
+	struct abc_smc *smc = create_abc_smc(REAL(prMin), REAL(prMax), REAL(obs), REAL(scale), INTEGER(nPart)[0], INTEGER(nGen)[0], REAL(alpha)[0], REAL(minTol)[0], REAL(minAcc)[0], INTEGER(maxSim)[0]);
+	set_abc_timeseries(smc->abc, REAL(obsTs), REAL(scaleTs), Rf_length(obsTs) / ABC_NTS, (bool) LOGICAL(early)[0]);
+
+	/* only C structures are handled here - no R API call */
+	run_abc_smc(smc, par, cn, (unsigned long) REAL(seed)[0], INTEGER(nThreads)[0]);
+
+	/* CONVERT RESULTS */
+	n = smc->abc->nacc;
+	ng = smc->gen;
+	out = PROTECT(Rf_allocVector(VECSXP, 8));
+	names = PROTECT(Rf_allocVector(STRSXP, 8));
+	theta = PROTECT(Rf_allocMatrix(REALSXP, n, ABC_NPAR));
+	weights = PROTECT(Rf_allocVector(REALSXP, n));
+	dist = PROTECT(Rf_allocVector(REALSXP, n));
+	sc = PROTECT(Rf_allocVector(REALSXP, SUMSTAT_NSTAT));
+	gen = PROTECT(Rf_allocMatrix(REALSXP, ng, 3));
+	scts = PROTECT(Rf_allocVector(REALSXP, ABC_NTS));
+	ear = PROTECT(Rf_allocVector(REALSXP, 3));
+	for(i=0;i<n;i++){
+		for(k=0;k<ABC_NPAR;k++) REAL(theta)[k*n + i] = smc->abc->theta[i*ABC_NPAR + k];
+		REAL(weights)[i] = smc->weights[i];
+		REAL(dist)[i] = smc->abc->dist[i];
+	}
+	for(k=0;k<SUMSTAT_NSTAT;k++) REAL(sc)[k] = smc->abc->scale[k];
+	for(i=0;i<ng;i++){
+		REAL(gen)[i] = smc->gentol[i];
+		REAL(gen)[ng + i] = smc->gensim[i];
+		REAL(gen)[2*ng + i] = smc->gentime[i];
+	}
+	for(k=0;k<ABC_NTS;k++) REAL(scts)[k] = smc->abc->scalets[k];
+	REAL(ear)[0] = smc->abc->nabort;
+	REAL(ear)[1] = smc->abc->nstep;
+	REAL(ear)[2] = smc->abc->nskip;
+	SET_VECTOR_ELT(out, 0, theta);
+	SET_VECTOR_ELT(out, 1, weights);
+	SET_VECTOR_ELT(out, 2, dist);
+	SET_VECTOR_ELT(out, 3, Rf_ScalarInteger(smc->abc->nsim));
+	SET_VECTOR_ELT(out, 4, sc);
+	SET_VECTOR_ELT(out, 5, gen);
+	SET_VECTOR_ELT(out, 6, scts);
+	SET_VECTOR_ELT(out, 7, ear);
+	for(k=0;k<8;k++) SET_STRING_ELT(names, k, Rf_mkChar(onames[k]));
+	Rf_setAttrib(out, R_NamesSymbol, names);
+
+	/* free memory */
+	free_abc_smc(smc);
+	free_network(cn);
+	free(par);
+
+	UNPROTECT(9);
+	return out;
+}
+
+
+
+/* Draw one value of a discrete distribution used in the simulations, either */
+/* with the inline draws of rng.h or with the GSL reference */
+static unsigned int rng_diagnostics_draw(gsl_rng *r, int dist, bool ref){
+	double p[4] = {0.1, 0.2, 0.3, 0.4};
+	unsigned int n[4];
+
+	switch(dist){
+	case 0:
+		return ref ? (unsigned int) gsl_rng_uniform_int(r, 7) : rng_uniform_int(r, 7);
+	case 1:
+		return ref ? gsl_ran_geometric(r, 0.2) : rng_geometric(r, 0.2);
+	case 2:
+		return ref ? gsl_ran_poisson(r, 0.1) : rng_poisson(r, 0.1);
+	case 3:
+		return ref ? gsl_ran_poisson(r, 3.0) : rng_poisson(r, 3.0);
+	case 4:
+		return ref ? gsl_ran_poisson(r, 30.0) : rng_poisson(r, 30.0);
+	case 5:
+		return ref ? gsl_ran_binomial(r, 0.1, 20) : rng_binomial(r, 0.1, 20);
+	case 6:
+		return ref ? gsl_ran_binomial(r, 0.8, 50) : rng_binomial(r, 0.8, 50);
+	case 7:
+		return ref ? gsl_ran_binomial(r, 0.3, 1000) : rng_binomial(r, 0.3, 1000);
+	default: /* multinomial: count of the last category */
+		if(ref) gsl_ran_multinomial(r, 4, 50, p, n); else rng_multinomial(r, 4, 50, p, n);
+		return n[3];
+	}
+}
+
+
+
+
+/* Draw 'n' values of each distribution used in the simulations, both with */
+/* the inline draws of rng.h and with GSL, from two substreams of 'seed'. */
+/* Returns a list whose first element is the name of the backend, and the */
+/* others are matrices with two columns (inline, GSL). Used by check.rng. */
+SEXP R_rng_diagnostics(SEXP n, SEXP seed){
+	int i, k, N = INTEGER(n)[0];
+	double *x;
+	int *y;
+	const char *dnames[12] = {"backend", "unif", "expo", "unifint", "geom", "pois.small", "pois.medium", "pois.large", "binom.small", "binom.high", "binom.large", "multinom"};
+	gsl_rng *fast = create_rng((unsigned long) REAL(seed)[0]), *ref = create_rng((unsigned long) REAL(seed)[0]);
+	SEXP out, names, elt;
+
+	rng_set_stream(fast, 0, 1, 0, RNG_INIT);
+	rng_set_stream(ref, 0, 2, 0, RNG_INIT);
+
+	out = PROTECT(Rf_allocVector(VECSXP, 12));
+	names = PROTECT(Rf_allocVector(STRSXP, 12));
+	for(k=0;k<12;k++) SET_STRING_ELT(names, k, Rf_mkChar(dnames[k]));
+	SET_VECTOR_ELT(out, 0, Rf_mkString(get_rng_backend()));
+
+	/* continuous: uniform and exponential */
+	for(k=0;k<2;k++){
+		elt = PROTECT(Rf_allocMatrix(REALSXP, N, 2));
+		x = REAL(elt);
+		for(i=0;i<N;i++){
+			x[i] = k==0 ? rng_uniform(fast) : rng_exponential(fast, 1.0);
+			x[N+i] = k==0 ? gsl_rng_uniform(ref) : gsl_ran_exponential(ref, 1.0);
+		}
+		SET_VECTOR_ELT(out, k+1, elt);
+		UNPROTECT(1);
+	}
+
+	/* discrete */
+	for(k=0;k<9;k++){
+		elt = PROTECT(Rf_allocMatrix(INTSXP, N, 2));
+		y = INTEGER(elt);
+		for(i=0;i<N;i++){
+			y[i] = (int) rng_diagnostics_draw(fast, k, FALSE);
+			y[N+i] = (int) rng_diagnostics_draw(ref, k, TRUE);
+		}
+		SET_VECTOR_ELT(out, k+3, elt);
+		UNPROTECT(1);
+	}
+
+	Rf_setAttrib(out, R_NamesSymbol, names);
+
+	gsl_rng_free(fast);
+	gsl_rng_free(ref);
+
+	UNPROTECT(2);
+	return out;
+}
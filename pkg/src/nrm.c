@@ -0,0 +1,206 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions implement an exact, next-reaction method simulation engine.
+  Reactions are the same as in the tau-leaping engine (see tauleap.c), but
+  events are simulated one at a time. Only populations whose propensity may
+  have changed after an event are updated: the population where the event
+  occurred and, when its number of infectious changed, the populations it
+  can infect.
+*/
+
+#include "common.h"
+#include "philox.h"
+#include "rng.h"
+#include "auxiliary.h"
+#include "param.h"
+#include "pathogens.h"
+#include "populations.h"
+#include "dispersal.h"
+#include "eventlog.h"
+#include "infection.h"
+#include "stages.h"
+#include "nrm.h"
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+/* compute (and store) the total propensity of a population */
+static double population_propensity(struct nrm *in, struct population *pop, struct metapopulation *metapop, struct stages *st, struct network *cn, struct param *par){
+	int b, p=get_popid(pop);
+	double out;
+
+	in->ainf[p] = get_nsus(pop) * get_lambda(pop, metapop, cn, par, in->lambdavec);
+	out = in->ainf[p];
+	for(b=1;b<st->nblocks;b++) out += st->rates[b] * get_block_size(st, p, b);
+
+	in->prop[p] = out;
+	return out;
+}
+
+
+
+/* draw a new putative time for a population */
+static double draw_next_time(double t, double prop, struct param *par){
+	if(prop < NEARZERO) return HUGE_VAL;
+	return t + rng_exponential(par->rng, 1.0/prop);
+}
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+struct nrm * create_nrm(struct metapopulation *metapop, struct stages *st, struct network *cn, struct param *par){
+	int i, j, q, npop=get_npop(metapop), maxnb=0, *counter;
+	double *times;
+	struct nrm *out = (struct nrm *) malloc(sizeof(struct nrm));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: nrm.c->create_nrm]\nNo memory left for creating simulation engine. Exiting.\n");
+		exit(1);
+	}
+
+	for(i=0;i<npop;i++) if(cn->nbNb[i] > maxnb) maxnb = cn->nbNb[i];
+
+	out->npop = npop;
+	out->t = 0.0;
+	out->nevents = 0;
+	out->prop = (double *) calloc(npop, sizeof(double));
+	out->ainf = (double *) calloc(npop, sizeof(double));
+	out->lambdavec = (double *) malloc(maxnb * sizeof(double));
+	out->revOffsets = (int *) calloc(npop+1, sizeof(int));
+	out->revNb = (int *) malloc(cn->nEdges * sizeof(int));
+	counter = (int *) calloc(npop, sizeof(int));
+	times = (double *) malloc(npop * sizeof(double));
+	if(out->prop == NULL || out->ainf == NULL || out->lambdavec == NULL || out->revOffsets == NULL || out->revNb == NULL || counter == NULL || times == NULL){
+		fprintf(stderr, "\n[in: nrm.c->create_nrm]\nNo memory left for creating simulation engine. Exiting.\n");
+		exit(1);
+	}
+
+	/* transpose the connection network: q -> populations having q as neighbour */
+	for(i=0;i<cn->nEdges;i++) out->revOffsets[cn->allNb[i]+1]++;
+	for(q=0;q<npop;q++) out->revOffsets[q+1] += out->revOffsets[q];
+	for(i=0;i<npop;i++){
+		for(j=0;j<cn->nbNb[i];j++){
+			q = cn->listNb[i][j];
+			out->revNb[out->revOffsets[q] + counter[q]++] = i;
+		}
+	}
+
+	/* initial propensities and putative times */
+	for(i=0;i<npop;i++){
+		population_propensity(out, get_populations(metapop)[i], metapop, st, cn, par);
+		times[i] = draw_next_time(0.0, out->prop[i], par);
+	}
+	out->queue = create_ipq(npop, times);
+
+	free(counter);
+	free(times);
+	return out;
+}
+
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_nrm(struct nrm *in){
+	if(in != NULL){
+		free_ipq(in->queue);
+		free(in->prop);
+		free(in->ainf);
+		free(in->lambdavec);
+		free(in->revOffsets);
+		free(in->revNb);
+		free(in);
+	}
+}
+
+
+
+
+/*
+   ==========================
+   === EXTERNAL FUNCTIONS ===
+   ==========================
+*/
+
+/* SIMULATE ALL EVENTS UNTIL A GIVEN TIME */
+int nrm_until(struct nrm *in, struct metapopulation *metapop, struct stages *st, struct network *cn, double tend, struct param *par){
+	int i, b, p, q, k, out=0, ninfBefore;
+	double u, old, tq;
+	struct population *pop, *curpop;
+	struct pathogen *newpat;
+
+	while(in->queue->keys[(p = ipq_top(in->queue))] <= tend){
+		in->t = in->queue->keys[p];
+		pop = get_populations(metapop)[p];
+		ninfBefore = get_ninf(pop);
+
+		/* CHOOSE AND FIRE A REACTION OF POPULATION P */
+		u = rng_uniform(par->rng) * in->prop[p];
+		if(u < in->ainf[p]){ /* infection: find the source population */
+			get_lambda(pop, metapop, cn, par, in->lambdavec);
+			k = 0;
+			while(k < cn->nbNb[p]-1 && u >= in->lambdavec[k] * get_nsus(pop)){
+				u -= in->lambdavec[k] * get_nsus(pop);
+				k++;
+			}
+			curpop = get_populations(metapop)[cn->listNb[p][k]];
+			newpat = replicate(select_random_infectious_pathogen(curpop, par), par);
+			add_infections(pop, st, &newpat, 1);
+		} else { /* progression: find the block */
+			u -= in->ainf[p];
+			b = st->nblocks - 1;
+			while(b > 1 && u >= st->rates[b] * get_block_size(st, p, b)){
+				u -= st->rates[b] * get_block_size(st, p, b);
+				b--;
+			}
+			progress_block(pop, st, b, 1, par);
+		}
+		update_stage_counts(pop, st);
+		out++;
+
+		/* UPDATE POPULATION P - fresh draw for the fired channel */
+		population_propensity(in, pop, metapop, st, cn, par);
+		ipq_update(in->queue, p, draw_next_time(in->t, in->prop[p], par));
+
+		/* UPDATE POPULATIONS EXPOSED TO P, IF ITS PREVALENCE CHANGED */
+		if(get_ninf(pop) != ninfBefore){
+			for(i=in->revOffsets[p];i<in->revOffsets[p+1];i++){
+				q = in->revNb[i];
+				if(q == p) continue;
+				old = in->prop[q];
+				population_propensity(in, get_populations(metapop)[q], metapop, st, cn, par);
+				tq = in->queue->keys[q];
+				if(old > NEARZERO && in->prop[q] > NEARZERO && tq < HUGE_VAL){
+					/* rescale remaining time (Gibson & Bruck) */
+					tq = in->t + (old / in->prop[q]) * (tq - in->t);
+				} else {
+					tq = draw_next_time(in->t, in->prop[q], par);
+				}
+				ipq_update(in->queue, q, tq);
+			}
+		}
+	}
+
+	in->t = tend;
+	in->nevents += out;
+	return out;
+}
@@ -0,0 +1,60 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions implement an exact, next-reaction method simulation engine.
+*/
+
+
+/*
+   ==================
+   === STRUCTURES ===
+   ==================
+*/
+
+/* State of the next-reaction method (Gibson & Bruck 2000, J Phys Chem A 104:1876). */
+/* All reactions of a population are grouped in one channel: */
+/* - 'queue' holds the putative time of the next event of each population */
+/* - 'prop' is the total propensity of each population, 'ainf' its infection part */
+/* - 'revOffsets' and 'revNb' list, for each population, the populations it can */
+/*    infect (transposed connection network, CSR) */
+/* - 'lambdavec' is a work array for per-neighbour forces of infection */
+/* - 't' is the current time, 'nevents' the number of events simulated */
+struct nrm{
+	struct ipq *queue;
+	double *prop, *ainf, *lambdavec, t;
+	int npop, *revOffsets, *revNb, nevents;
+};
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+struct nrm * create_nrm(struct metapopulation *metapop, struct stages *st, struct network *cn, struct param *par);
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_nrm(struct nrm *in);
+
+
+
+/*
+   ==========================
+   === EXTERNAL FUNCTIONS ===
+   ==========================
+*/
+
+/* simulate all events until time 'tend'; returns the number of events */
+int nrm_until(struct nrm *in, struct metapopulation *metapop, struct stages *st, struct network *cn, double tend, struct param *par);
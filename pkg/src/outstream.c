@@ -0,0 +1,249 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions stream per-step outputs to a file through a writer thread.
+*/
+
+#include <zlib.h>
+
+#include "common.h"
+#include "param.h"
+#include "pathogens.h"
+#include "populations.h"
+#include "sampling.h"
+#include "sumstat.h"
+#include "inout.h"
+#include "outstream.h"
+
+/* number of records formatted at a time in text files */
+#define OUTSTREAM_LINES 1024
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+/* Write 'n' bytes of text */
+static void write_outstream_text(struct outstream *in, const char *x, int n){
+	if(n == 0) return;
+	if((in->format == OUTSTREAM_GZIP && gzwrite(in->gz, x, (unsigned) n) != n) || (in->format == OUTSTREAM_TEXT && fwrite(x, 1, (size_t) n, in->f) != (size_t) n)){
+		fprintf(stderr, "\n[in: outstream.c->write_outstream_text]\nUnable to write output file. Exiting.\n");
+		exit(1);
+	}
+}
+
+
+
+/* Write the 'n' records of 'in->chunk' */
+static void write_outstream_chunk(struct outstream *in, int n){
+	int i, j, k, len;
+
+	if(in->format == OUTSTREAM_BINARY){
+		write_records_bin(in->chunk, n, 0, in->bin);
+		return;
+	}
+
+	for(i=0;i<n;i+=OUTSTREAM_LINES){
+		len = 0;
+		for(k=i;k<n && k<i+OUTSTREAM_LINES;k++){
+			for(j=0;j<in->ncol;j++) len += sprintf(in->text + len, j < in->ncol-1 ? "%d\t" : "%d\n", in->chunk[k*in->ncol + j]);
+		}
+		write_outstream_text(in, in->text, len);
+	}
+}
+
+
+
+/* Writer thread: drain the buffer until the stream is closed */
+static void * run_outstream(void *arg){
+	struct outstream *in = (struct outstream *) arg;
+	int n, n1, ncol = in->ncol;
+
+	pthread_mutex_lock(&in->lock);
+	while(TRUE){
+		while(in->count < in->batch && !in->closed) pthread_cond_wait(&in->notempty, &in->lock);
+		if(in->count == 0) break; /* closed and empty */
+
+		/* copy the records out of the ring, then free their room */
+		n = in->count;
+		n1 = in->capacity - in->head < n ? in->capacity - in->head : n;
+		memcpy(in->chunk, in->buf + (size_t) in->head * ncol, (size_t) n1 * ncol * sizeof(int));
+		if(n1 < n) memcpy(in->chunk + (size_t) n1 * ncol, in->buf, (size_t) (n-n1) * ncol * sizeof(int));
+		in->head = (in->head + n) % in->capacity;
+		in->count -= n;
+		pthread_cond_signal(&in->notfull);
+		pthread_mutex_unlock(&in->lock);
+
+		write_outstream_chunk(in, n);
+
+		pthread_mutex_lock(&in->lock);
+	}
+	pthread_mutex_unlock(&in->lock);
+
+	return NULL;
+}
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+struct outstream * create_outstream(const char *file, int kind, int format, int capacity){
+	int j, len;
+	const char **names;
+	struct outstream *out = (struct outstream *) calloc(1, sizeof(struct outstream));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: outstream.c->create_outstream]\nNo memory left for creating output stream. Exiting.\n");
+		exit(1);
+	}
+
+	if((names = get_colfile_names(kind, &out->ncol)) == NULL){
+		fprintf(stderr, "\n[in: outstream.c->create_outstream]\nUnknown kind of table (%d). Exiting.\n", kind);
+		exit(1);
+	}
+	out->kind = kind;
+	out->format = format;
+	out->capacity = capacity > 0 ? capacity : OUTSTREAM_CAPACITY;
+	out->batch = out->capacity > 1 ? out->capacity / 2 : 1;
+
+	/* buffers; ints take at most 11 characters, plus a separator */
+	out->buf = (int *) malloc((size_t) out->capacity * out->ncol * sizeof(int));
+	out->chunk = (int *) malloc((size_t) out->capacity * out->ncol * sizeof(int));
+	out->text = (char *) malloc((size_t) OUTSTREAM_LINES * out->ncol * 12 + COLFILE_NAMELEN * out->ncol + 1);
+	if(out->buf == NULL || out->chunk == NULL || out->text == NULL){
+		fprintf(stderr, "\n[in: outstream.c->create_outstream]\nNo memory left for creating output stream. Exiting.\n");
+		exit(1);
+	}
+
+	/* file */
+	switch(format){
+	case OUTSTREAM_TEXT:
+		out->f = fopen(file, "w");
+		break;
+	case OUTSTREAM_GZIP:
+		out->gz = gzopen(file, "wb");
+		break;
+	case OUTSTREAM_BINARY:
+		out->bin = create_colfile(file, kind);
+		break;
+	default:
+		fprintf(stderr, "\n[in: outstream.c->create_outstream]\nUnknown format (%d). Exiting.\n", format);
+		exit(1);
+	}
+	if((format == OUTSTREAM_TEXT && out->f == NULL) || (format == OUTSTREAM_GZIP && out->gz == NULL)){
+		fprintf(stderr, "\n[in: outstream.c->create_outstream]\nUnable to open file %s. Exiting.\n", file);
+		exit(1);
+	}
+	if(format != OUTSTREAM_BINARY){
+		len = 0;
+		for(j=0;j<out->ncol;j++) len += sprintf(out->text + len, j < out->ncol-1 ? "%s\t" : "%s\n", names[j]);
+		write_outstream_text(out, out->text, len);
+	}
+
+	/* writer thread */
+	if(pthread_mutex_init(&out->lock, NULL) != 0 || pthread_cond_init(&out->notempty, NULL) != 0 || pthread_cond_init(&out->notfull, NULL) != 0 || pthread_create(&out->writer, NULL, run_outstream, out) != 0){
+		fprintf(stderr, "\n[in: outstream.c->create_outstream]\nUnable to start the writer thread. Exiting.\n");
+		exit(1);
+	}
+
+	return out;
+}
+
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void close_outstream(struct outstream *in){
+	int ok = TRUE;
+	if(in == NULL) return;
+
+	pthread_mutex_lock(&in->lock);
+	in->closed = TRUE;
+	pthread_cond_signal(&in->notempty);
+	pthread_mutex_unlock(&in->lock);
+	pthread_join(in->writer, NULL);
+
+	switch(in->format){
+	case OUTSTREAM_TEXT:
+		ok = fclose(in->f) == 0;
+		break;
+	case OUTSTREAM_GZIP:
+		ok = gzclose(in->gz) == Z_OK;
+		break;
+	case OUTSTREAM_BINARY:
+		close_colfile(in->bin);
+		break;
+	}
+	if(!ok){
+		fprintf(stderr, "\n[in: outstream.c->close_outstream]\nUnable to write output file. Exiting.\n");
+		exit(1);
+	}
+
+	pthread_mutex_destroy(&in->lock);
+	pthread_cond_destroy(&in->notempty);
+	pthread_cond_destroy(&in->notfull);
+	free(in->buf);
+	free(in->chunk);
+	free(in->text);
+	free(in);
+}
+
+
+
+
+/*
+   ===============================
+   === MAIN EXTERNAL FUNCTIONS ===
+   ===============================
+*/
+
+int get_outstream_format(const char *file){
+	size_t n = strlen(file);
+	if(n >= 4 && strcmp(file + n - 4, ".bin") == 0) return OUTSTREAM_BINARY;
+	if(n >= 3 && strcmp(file + n - 3, ".gz") == 0) return OUTSTREAM_GZIP;
+	return OUTSTREAM_TEXT;
+}
+
+
+
+/* Push records */
+/* Records are copied in as many pieces as the room left in the buffer */
+/* allows; the writer is woken up once a batch is ready. */
+void push_outstream(struct outstream *in, const int *rec, int n){
+	int m, tail, ncol = in->ncol;
+
+	pthread_mutex_lock(&in->lock);
+	while(n > 0){
+		while(in->count == in->capacity){
+			in->nwait++;
+			pthread_cond_signal(&in->notempty);
+			pthread_cond_wait(&in->notfull, &in->lock);
+		}
+		tail = (in->head + in->count) % in->capacity;
+		m = in->capacity - in->count;
+		if(m > in->capacity - tail) m = in->capacity - tail;
+		if(m > n) m = n;
+		memcpy(in->buf + (size_t) tail * ncol, rec, (size_t) m * ncol * sizeof(int));
+		in->count += m;
+		in->nrec += m;
+		rec += (size_t) m * ncol;
+		n -= m;
+		if(in->count >= in->batch) pthread_cond_signal(&in->notempty);
+	}
+	pthread_mutex_unlock(&in->lock);
+}
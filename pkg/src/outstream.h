@@ -0,0 +1,85 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions stream per-step outputs to a file through a writer thread.
+  Requires inout.h to be included first.
+*/
+
+#include <pthread.h>
+
+
+
+/*
+   ==================
+   === STRUCTURES ===
+   ==================
+*/
+
+/* formats of streamed outputs */
+#define OUTSTREAM_TEXT 0 /* tab-separated, with a header */
+#define OUTSTREAM_GZIP 1 /* as OUTSTREAM_TEXT, compressed with zlib */
+#define OUTSTREAM_BINARY 2 /* columnar file (see inout.h) */
+
+/* default capacity of the buffer, in records */
+#define OUTSTREAM_CAPACITY 65536
+
+
+/* Output stream */
+/* Records are rows of 'ncol' integers, the columns of a kind of table of */
+/* inout.h (e.g. COLFILE_POPDYN). They are pushed into a ring buffer of */
+/* 'capacity' records ('count' of them from 'head'), which a writer thread */
+/* drains 'batch' records or more at a time, formats and writes without */
+/* holding the lock. The simulation only waits if the buffer is full */
+/* ('nwait' counts these waits); memory does not depend on the number of */
+/* records. In binary files, each drained batch is a partition of id 0. */
+struct outstream{
+	int *buf, *chunk;
+	char *text;
+	int kind, format, ncol, capacity, batch, head, count, closed, nwait;
+	long long nrec;
+	FILE *f;
+	struct gzFile_s *gz;
+	struct colfile *bin;
+	pthread_t writer;
+	pthread_mutex_t lock;
+	pthread_cond_t notempty, notfull;
+};
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+/* open 'file' and start the writer thread; 'capacity' <= 0 for the default */
+struct outstream * create_outstream(const char *file, int kind, int format, int capacity);
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+/* write the remaining records, stop the writer thread and close the file */
+void close_outstream(struct outstream *in);
+
+
+
+/*
+   ==========================
+   === EXTERNAL FUNCTIONS ===
+   ==========================
+*/
+
+/* format of an output file from its name: .bin, .gz, otherwise text */
+int get_outstream_format(const char *file);
+
+/* copy 'n' records (n x ncol integers, row by row) into the buffer */
+void push_outstream(struct outstream *in, const int *rec, int n);
@@ -113,6 +113,30 @@ void check_param(struct param *in){
 
 
 
+/* check parameters specific to continuous-time engines */
+void check_param_stages(struct param *in){
+	/* ke & ki */
+	if(in->ke < 1 || in->ki < 1){
+		fprintf(stderr, "\n[in: param.c->check_param_stages]\nParameter error: less than one stage in latent or infectious period.\n");
+		exit(1);
+	}
+
+	/* t1 & t2 */
+	if(in->t2 <= in->t1){
+		fprintf(stderr, "\n[in: param.c->check_param_stages]\nParameter error: infectious period must have a positive duration.\n");
+		exit(1);
+	}
+
+	/* tau_tol */
+	if(in->tau_tol <= 0.0 || in->tau_tol > 1.0){
+		fprintf(stderr, "\n[in: param.c->check_param_stages]\nParameter error: tau-leaping tolerance must be in ]0,1].\n");
+		exit(1);
+	}
+}
+
+
+
+
 /* print parameters */
 void print_param(struct param *in){
 	int i, totpopsizes=0;
@@ -22,9 +22,11 @@
 /* n_sample: sample size, in number of pathogens */
 /* npop: number of populations in the metapopulation */
 /* duration: maximum number of steps to run simulations for; implicitely the duration of the epidemic until most recent sample */
+/* ke, ki: number of Erlang stages of the latent and infectious periods (continuous-time engines only) */
+/* tau_tol: tolerance on relative propensity changes used to size tau-leaps */
 struct param{
-	int L, t1, t2, nstart, *t_sample, n_sample, duration, npop, *popsizes, *cn_nb_nb, *cn_list_nb;
-	double mu, muL, beta, *cn_weights;
+	int L, t1, t2, nstart, *t_sample, n_sample, duration, npop, *popsizes, *cn_nb_nb, *cn_list_nb, ke, ki;
+	double mu, muL, beta, *cn_weights, tau_tol;
 	gsl_rng * rng;
 };
 
@@ -37,5 +39,8 @@ void free_param(struct param *in);
 /* Check parameters */
 void check_param(struct param *in);
 
+/* Check parameters of continuous-time engines */
+void check_param_stages(struct param *in);
+
 /* Print parameters */
 void print_param(struct param *in);
@@ -0,0 +1,612 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions read simulation parameters from a file.
+*/
+
+#include "common.h"
+#include "auxiliary.h"
+#include "param.h"
+#include "pathogens.h"
+#include "populations.h"
+#include "sampling.h"
+#include "dispersal.h"
+#include "sumstat.h"
+#include "sweep.h"
+#include "spatial.h"
+#include "paramfile.h"
+
+/* maximum number of values of a range */
+#define PARAMFILE_MAXRANGE 10000000
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+/* Read a line of any length into 'buf' (of 'size' bytes, grown as needed) */
+/* returns NULL at the end of the file */
+static char * read_line(FILE *f, char **buf, int *size){
+	int n = 0;
+	if(fgets(*buf, *size, f) == NULL) return NULL;
+	while((n = (int) strlen(*buf)) == *size-1 && (*buf)[n-1] != '\n'){
+		*size *= 2;
+		*buf = (char *) realloc(*buf, *size);
+		if(*buf == NULL){
+			fprintf(stderr, "\n[in: paramfile.c->read_line]\nNo memory left for reading parameters. Exiting.\n");
+			exit(1);
+		}
+		if(fgets(*buf + n, *size - n, f) == NULL) break;
+	}
+	return *buf;
+}
+
+
+
+/* Remove comments and surrounding blanks; returns the start of the text */
+static char * trim_text(char *x){
+	char *end = strchr(x, '#');
+	if(end != NULL) *end = '\0';
+	while(*x == ' ' || *x == '\t') x++;
+	end = x + strlen(x);
+	while(end > x && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r')) end--;
+	*end = '\0';
+	return x;
+}
+
+
+
+/* Append 'x' to the 'n' values of 'out' (of size 'max', grown as needed) */
+static void add_value(double **out, int *n, int *max, double x){
+	if(*n == *max){
+		*max *= 2;
+		*out = (double *) realloc(*out, *max * sizeof(double));
+		if(*out == NULL){
+			fprintf(stderr, "\n[in: paramfile.c->add_value]\nNo memory left for reading parameters. Exiting.\n");
+			exit(1);
+		}
+	}
+	(*out)[(*n)++] = x;
+}
+
+
+
+/* Read numbers and ranges separated by commas or blanks into 'out' */
+/* returns the number of values, or -1 if 'x' is not a list of numbers */
+static int read_values(char *x, double **out, int *max){
+	int n = 0, k, nby;
+	double from, to, by;
+	char *tok, *end;
+
+	for(tok=strtok(x, ", \t");tok!=NULL;tok=strtok(NULL, ", \t")){
+		from = strtod(tok, &end);
+		if(end == tok) return -1;
+		if(*end == '\0'){
+			add_value(out, &n, max, from);
+			continue;
+		}
+
+		/* range from:to[:by], by default by steps of 1 as in R */
+		if(*end != ':') return -1;
+		tok = end + 1;
+		to = strtod(tok, &end);
+		if(end == tok) return -1;
+		by = to < from ? -1.0 : 1.0;
+		if(*end == ':'){
+			tok = end + 1;
+			by = strtod(tok, &end);
+			if(end == tok) return -1;
+		}
+		if(*end != '\0' || by == 0.0 || (to - from) / by < 0.0 || (to - from) / by > PARAMFILE_MAXRANGE) return -1;
+		nby = (int) floor((to - from) / by + NEARZERO);
+		for(k=0;k<=nby;k++) add_value(out, &n, max, from + k * by);
+	}
+	return n;
+}
+
+
+
+/* Convert a value into an integer, checking it is one */
+static int get_int_value(double x, const char *name, const char *file, int nline){
+	if(x != floor(x) || fabs(x) > 2147483647.0){
+		fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\n%s, line %d: %s must be an integer. Exiting.\n", file, nline, name);
+		exit(1);
+	}
+	return (int) x;
+}
+
+
+
+/* Read the connections between the 'npop' populations of 'par' from text */
+/* The list of neighbours of each population starts with itself, as */
+/* expected by create_network. */
+static void read_network_file(const char *file, struct param *par){
+	int i, k, from, to, nline = 0, nedges = 0, maxedges = 64, size = 256, *efrom, *eto, *first;
+	double w, *ew, *wsum;
+	char *line = (char *) malloc(size), *x;
+	FILE *f = fopen(file, "r");
+
+	if(f == NULL){
+		fprintf(stderr, "\n[in: paramfile.c->read_network_file]\nUnable to open file %s. Exiting.\n", file);
+		exit(1);
+	}
+	efrom = (int *) malloc(maxedges * sizeof(int));
+	eto = (int *) malloc(maxedges * sizeof(int));
+	ew = (double *) malloc(maxedges * sizeof(double));
+	first = (int *) calloc(par->npop + 1, sizeof(int));
+	wsum = (double *) calloc(par->npop, sizeof(double));
+	if(line == NULL || efrom == NULL || eto == NULL || ew == NULL || first == NULL || wsum == NULL){
+		fprintf(stderr, "\n[in: paramfile.c->read_network_file]\nNo memory left for reading network. Exiting.\n");
+		exit(1);
+	}
+
+	/* READ EDGES */
+	while(read_line(f, &line, &size) != NULL){
+		nline++;
+		x = trim_text(line);
+		if(*x == '\0') continue;
+		if(sscanf(x, "%d %d %lf", &from, &to, &w) != 3){
+			fprintf(stderr, "\n[in: paramfile.c->read_network_file]\n%s, line %d: expected 'from to weight'. Exiting.\n", file, nline);
+			exit(1);
+		}
+		if(from < 1 || from > par->npop || to < 1 || to > par->npop || from == to || w < 0.0){
+			fprintf(stderr, "\n[in: paramfile.c->read_network_file]\n%s, line %d: populations must differ and be in 1..%d, and weights be positive. Exiting.\n", file, nline, par->npop);
+			exit(1);
+		}
+		if(nedges == maxedges){
+			maxedges *= 2;
+			efrom = (int *) realloc(efrom, maxedges * sizeof(int));
+			eto = (int *) realloc(eto, maxedges * sizeof(int));
+			ew = (double *) realloc(ew, maxedges * sizeof(double));
+			if(efrom == NULL || eto == NULL || ew == NULL){
+				fprintf(stderr, "\n[in: paramfile.c->read_network_file]\nNo memory left for reading network. Exiting.\n");
+				exit(1);
+			}
+		}
+		efrom[nedges] = from-1;
+		eto[nedges] = to-1;
+		ew[nedges++] = w;
+		first[from]++;
+		wsum[from-1] += w;
+	}
+	fclose(f);
+
+	for(i=0;i<par->npop;i++){
+		if(wsum[i] > 1.0 + NEARZERO){
+			fprintf(stderr, "\n[in: paramfile.c->read_network_file]\n%s: dispersal weights of population %d sum to more than 1. Exiting.\n", file, i+1);
+			exit(1);
+		}
+	}
+
+	/* LISTS OF NEIGHBOURS, SELF FIRST */
+	par->cn_nb_nb = (int *) malloc(par->npop * sizeof(int));
+	par->cn_list_nb = (int *) malloc((par->npop + nedges) * sizeof(int));
+	par->cn_weights = (double *) malloc((par->npop + nedges) * sizeof(double));
+	if(par->cn_nb_nb == NULL || par->cn_list_nb == NULL || par->cn_weights == NULL){
+		fprintf(stderr, "\n[in: paramfile.c->read_network_file]\nNo memory left for reading network. Exiting.\n");
+		exit(1);
+	}
+	for(i=0;i<par->npop;i++){
+		par->cn_nb_nb[i] = first[i+1] + 1;
+		first[i+1] += first[i] + 1; /* first[i]: position of population i */
+		par->cn_list_nb[first[i]] = i;
+		par->cn_weights[first[i]] = wsum[i] < 1.0 ? 1.0 - wsum[i] : 0.0;
+		first[i]++;
+	}
+	for(k=0;k<nedges;k++){
+		par->cn_list_nb[first[efrom[k]]] = eto[k];
+		par->cn_weights[first[efrom[k]]++] = ew[k];
+	}
+
+	free(line);
+	free(efrom);
+	free(eto);
+	free(ew);
+	free(first);
+	free(wsum);
+}
+
+
+
+/* Build the connections between the 'npop' populations of 'par' from */
+/* their coordinates, read from text ('x y' per line, one population per */
+/* line); 'graph' is 1 (Delaunay), 5 (distance between d1 and d2) or 6 */
+/* ('k' nearest neighbours), as in chooseCn. */
+static void read_spatial_file(const char *file, int graph, int k, double d1, double d2, double pdisp, double decay, struct param *par){
+	int n = 0, nline = 0, size = 256;
+	double *x, *y;
+	char *line = (char *) malloc(size), *txt;
+	struct spatialgraph *g = NULL;
+	FILE *f = fopen(file, "r");
+
+	if(f == NULL){
+		fprintf(stderr, "\n[in: paramfile.c->read_spatial_file]\nUnable to open file %s. Exiting.\n", file);
+		exit(1);
+	}
+	x = (double *) malloc(par->npop * sizeof(double));
+	y = (double *) malloc(par->npop * sizeof(double));
+	if(line == NULL || x == NULL || y == NULL){
+		fprintf(stderr, "\n[in: paramfile.c->read_spatial_file]\nNo memory left for reading coordinates. Exiting.\n");
+		exit(1);
+	}
+
+	/* READ COORDINATES */
+	while(read_line(f, &line, &size) != NULL){
+		nline++;
+		txt = trim_text(line);
+		if(*txt == '\0') continue;
+		if(n == par->npop){
+			fprintf(stderr, "\n[in: paramfile.c->read_spatial_file]\n%s: more coordinates than populations (%d). Exiting.\n", file, par->npop);
+			exit(1);
+		}
+		if(sscanf(txt, "%lf %lf", &x[n], &y[n]) != 2 || !isfinite(x[n]) || !isfinite(y[n])){
+			fprintf(stderr, "\n[in: paramfile.c->read_spatial_file]\n%s, line %d: expected 'x y'. Exiting.\n", file, nline);
+			exit(1);
+		}
+		n++;
+	}
+	fclose(f);
+	if(n != par->npop){
+		fprintf(stderr, "\n[in: paramfile.c->read_spatial_file]\n%s: %d coordinates for %d populations. Exiting.\n", file, n, par->npop);
+		exit(1);
+	}
+
+	/* CONNECTIONS */
+	if(graph == 1) g = get_delaunay_graph(x, y, n);
+	if(graph == 5) g = get_dist_graph(x, y, n, d1, d2);
+	if(graph == 6) g = get_knn_graph(x, y, n, k, TRUE);
+
+	par->cn_nb_nb = (int *) malloc(par->npop * sizeof(int));
+	par->cn_list_nb = (int *) malloc((par->npop + g->nedges) * sizeof(int));
+	par->cn_weights = (double *) malloc((par->npop + g->nedges) * sizeof(double));
+	if(par->cn_nb_nb == NULL || par->cn_list_nb == NULL || par->cn_weights == NULL){
+		fprintf(stderr, "\n[in: paramfile.c->read_spatial_file]\nNo memory left for storing connections. Exiting.\n");
+		exit(1);
+	}
+	get_spatial_cninfo(g, pdisp, decay, par->cn_nb_nb, par->cn_list_nb, par->cn_weights);
+
+	free_spatialgraph(g);
+	free(line);
+	free(x);
+	free(y);
+}
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+/* Read a parameter file */
+/* Parameters missing from the file take the defaults of epidemics.sweep; */
+/* pop.sizes, n.sample and duration are required. Each scenario is checked */
+/* as by check_param. */
+struct paramfile * read_paramfile(const char *file){
+	int i, j, k, s, n, nline = 0, size = 256, maxval = 16, ntsamp = 0, *tsamp = NULL, graph = 0, graphk = 0;
+	int nval[SWEEP_NPAR], maxgrid[SWEEP_NPAR];
+	double *val, *grid[SWEEP_NPAR], defaults[SWEEP_NPAR] = {1.0, 1e-5, 1.0, 2.0}, d1 = 0.0, d2 = 0.0, pdisp = -1.0, decay = 0.0;
+	char *line, *x, *eq, *name, *network = NULL, *xy = NULL, c;
+	const char *gridnames[SWEEP_NPAR] = {"beta", "mut.rate", "t.infectious", "t.recover"};
+	struct paramfile *out;
+	struct param *par;
+	FILE *f = fopen(file, "r");
+
+	if(f == NULL){
+		fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\nUnable to open file %s. Exiting.\n", file);
+		exit(1);
+	}
+
+	/* ALLOCATE OUTPUT - DEFAULTS OF EPIDEMICS.SWEEP */
+	out = (struct paramfile *) malloc(sizeof(struct paramfile));
+	par = (struct param *) calloc(1, sizeof(struct param));
+	line = (char *) malloc(size);
+	val = (double *) malloc(maxval * sizeof(double));
+	if(out == NULL || par == NULL || line == NULL || val == NULL){
+		fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\nNo memory left for reading parameters. Exiting.\n");
+		exit(1);
+	}
+	for(k=0;k<SWEEP_NPAR;k++){
+		maxgrid[k] = 16;
+		grid[k] = (double *) malloc(maxgrid[k] * sizeof(double));
+		if(grid[k] == NULL){
+			fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\nNo memory left for reading parameters. Exiting.\n");
+			exit(1);
+		}
+		grid[k][0] = defaults[k];
+		nval[k] = 1;
+	}
+	out->par = par;
+	out->output = NULL;
+	out->network = NULL;
+	out->nrep = 1;
+	out->nthreads = 0;
+	out->crn = TRUE;
+	out->seed = (unsigned long) time(NULL);
+	par->L = 10000;
+	par->nstart = 10;
+	par->n_sample = -1;
+	par->duration = -1;
+	par->rng = NULL;
+
+	/* READ PARAMETERS */
+	while(read_line(f, &line, &size) != NULL){
+		nline++;
+		x = trim_text(line);
+		if(*x == '\0') continue;
+		if((eq = strchr(x, '=')) == NULL){
+			fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\n%s, line %d: expected 'name = value'. Exiting.\n", file, nline);
+			exit(1);
+		}
+		*eq = '\0';
+		name = trim_text(x);
+		x = trim_text(eq + 1);
+		if(strlen(name) >= PARAMFILE_MAXNAME || *x == '\0'){
+			fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\n%s, line %d: expected 'name = value'. Exiting.\n", file, nline);
+			exit(1);
+		}
+
+		/* text values; relative paths of networks and coordinates start */
+		/* from the directory of the parameter file */
+		if(strcmp(name, "network") == 0 || strcmp(name, "xy") == 0 || strcmp(name, "output") == 0){
+			n = (name[0] != 'o' && x[0] != '/' && strrchr(file, '/') != NULL) ? (int) (strrchr(file, '/') - file) + 1 : 0;
+			eq = (char *) malloc(n + strlen(x) + 1);
+			if(eq == NULL){
+				fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\nNo memory left for reading parameters. Exiting.\n");
+				exit(1);
+			}
+			memcpy(eq, file, n);
+			strcpy(eq + n, x);
+			if(name[0] == 'n'){
+				free(network);
+				network = eq;
+			} else if(name[0] == 'x'){
+				free(xy);
+				xy = eq;
+			} else {
+				free(out->output);
+				out->output = eq;
+			}
+			continue;
+		}
+		if(strcmp(name, "graph") == 0){
+			if(strcmp(x, "delaunay") == 0){
+				graph = 1;
+			} else if(sscanf(x, "distance %lf %lf %c", &d1, &d2, &c) == 2 && d1 >= 0.0 && d2 >= d1){
+				graph = 5;
+			} else if(sscanf(x, "knn %d %c", &graphk, &c) == 1 && graphk > 0){
+				graph = 6;
+			} else {
+				fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\n%s, line %d: graph must be 'delaunay', 'knn k' or 'distance d1 d2' (0 <= d1 <= d2). Exiting.\n", file, nline);
+				exit(1);
+			}
+			continue;
+		}
+		if(strcmp(name, "crn") == 0){
+			if(strcmp(x, "TRUE") == 0 || strcmp(x, "T") == 0 || strcmp(x, "1") == 0){
+				out->crn = TRUE;
+			} else if(strcmp(x, "FALSE") == 0 || strcmp(x, "F") == 0 || strcmp(x, "0") == 0){
+				out->crn = FALSE;
+			} else {
+				fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\n%s, line %d: crn must be TRUE or FALSE. Exiting.\n", file, nline);
+				exit(1);
+			}
+			continue;
+		}
+
+		/* numbers */
+		if((n = read_values(x, &val, &maxval)) < 1){
+			fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\n%s, line %d: wrong values for %s. Exiting.\n", file, nline, name);
+			exit(1);
+		}
+		for(k=0;k<SWEEP_NPAR && strcmp(name, gridnames[k]) != 0;k++);
+		if(k < SWEEP_NPAR){ /* parameters of the scenarios */
+			nval[k] = 0;
+			for(i=0;i<n;i++) add_value(&grid[k], &nval[k], &maxgrid[k], val[i]);
+			continue;
+		}
+		if(strcmp(name, "pop.sizes") == 0 || strcmp(name, "t.sample") == 0){
+			tsamp = (int *) malloc(n * sizeof(int));
+			if(tsamp == NULL){
+				fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\nNo memory left for reading parameters. Exiting.\n");
+				exit(1);
+			}
+			for(i=0;i<n;i++) tsamp[i] = get_int_value(val[i], name, file, nline);
+			if(name[0] == 'p'){
+				free(par->popsizes);
+				par->popsizes = tsamp;
+				par->npop = n;
+			} else {
+				free(par->t_sample);
+				par->t_sample = tsamp;
+				ntsamp = n;
+			}
+			tsamp = NULL;
+			continue;
+		}
+		if(n > 1){
+			fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\n%s, line %d: %s takes a single value. Exiting.\n", file, nline, name);
+			exit(1);
+		}
+		if(strcmp(name, "p.disp") == 0 || strcmp(name, "decay") == 0){
+			if(val[0] < 0.0 || (name[0] == 'p' && val[0] > 1.0)){
+				fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\n%s, line %d: p.disp must be in [0,1], and decay non-negative. Exiting.\n", file, nline);
+				exit(1);
+			}
+			if(name[0] == 'p') pdisp = val[0]; else decay = val[0];
+			continue;
+		}
+		if(strcmp(name, "seed") == 0){
+			if(val[0] < 0.0 || val[0] != floor(val[0])){
+				fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\n%s, line %d: seed must be a positive integer. Exiting.\n", file, nline);
+				exit(1);
+			}
+			out->seed = (unsigned long) val[0];
+			continue;
+		}
+		i = get_int_value(val[0], name, file, nline);
+		if(strcmp(name, "seq.length") == 0){
+			par->L = i;
+		} else if(strcmp(name, "n.ini.inf") == 0){
+			par->nstart = i;
+		} else if(strcmp(name, "n.sample") == 0){
+			par->n_sample = i;
+		} else if(strcmp(name, "duration") == 0){
+			par->duration = i;
+		} else if(strcmp(name, "n.rep") == 0){
+			out->nrep = i > 1 ? i : 1;
+		} else if(strcmp(name, "n.threads") == 0){
+			out->nthreads = i > 0 ? i : 0;
+		} else {
+			fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\n%s, line %d: unknown parameter '%s'. Exiting.\n", file, nline, name);
+			exit(1);
+		}
+	}
+	fclose(f);
+
+	/* REQUIRED PARAMETERS */
+	if(par->popsizes == NULL || par->n_sample < 0 || par->duration < 1){
+		fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\n%s: pop.sizes, n.sample and duration must be given. Exiting.\n", file);
+		exit(1);
+	}
+	if(out->output == NULL){
+		out->output = (char *) malloc(4);
+		if(out->output == NULL){
+			fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\nNo memory left for reading parameters. Exiting.\n");
+			exit(1);
+		}
+		strcpy(out->output, "out");
+	}
+
+	/* sampling times, recycled; all at the end by default */
+	tsamp = (int *) malloc((par->n_sample > 0 ? par->n_sample : 1) * sizeof(int));
+	if(tsamp == NULL){
+		fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\nNo memory left for reading parameters. Exiting.\n");
+		exit(1);
+	}
+	for(i=0;i<par->n_sample;i++) tsamp[i] = ntsamp > 0 ? par->t_sample[i % ntsamp] : 0;
+	free(par->t_sample);
+	par->t_sample = tsamp;
+
+	/* connections: populations are isolated unless a network, or */
+	/* coordinates and a graph, are given; binary network files are read */
+	/* when the network is created */
+	out->network = NULL;
+	n = network != NULL ? (int) strlen(network) : 0;
+	if(xy != NULL || graph > 0 || pdisp >= 0.0){
+		if(xy == NULL || graph == 0 || pdisp < 0.0 || network != NULL){
+			fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\n%s: xy, graph and p.disp must be given together, and without network. Exiting.\n", file);
+			exit(1);
+		}
+		if(graph == 6 && graphk >= par->npop){
+			fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\n%s: knn needs fewer neighbours than populations (%d). Exiting.\n", file, par->npop);
+			exit(1);
+		}
+		read_spatial_file(xy, graph, graphk, d1, d2, pdisp, decay, par);
+		free(xy);
+	} else if(n >= 4 && strcmp(network + n - 4, ".bin") == 0){
+		out->network = network;
+	} else if(network != NULL){
+		read_network_file(network, par);
+		free(network);
+	} else {
+		par->cn_nb_nb = (int *) malloc(par->npop * sizeof(int));
+		par->cn_list_nb = (int *) malloc(par->npop * sizeof(int));
+		par->cn_weights = (double *) malloc(par->npop * sizeof(double));
+		if(par->cn_nb_nb == NULL || par->cn_list_nb == NULL || par->cn_weights == NULL){
+			fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\nNo memory left for reading parameters. Exiting.\n");
+			exit(1);
+		}
+		for(i=0;i<par->npop;i++){
+			par->cn_nb_nb[i] = 1;
+			par->cn_list_nb[i] = i;
+			par->cn_weights[i] = 1.0;
+		}
+	}
+
+	/* SCENARIOS: ALL COMBINATIONS, THE FIRST PARAMETER VARYING FASTEST */
+	out->nscen = 1;
+	for(k=0;k<SWEEP_NPAR;k++) out->nscen *= nval[k];
+	out->theta = (double *) malloc(out->nscen * SWEEP_NPAR * sizeof(double));
+	if(out->theta == NULL){
+		fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\nNo memory left for storing scenarios. Exiting.\n");
+		exit(1);
+	}
+	for(s=out->nscen-1;s>=0;s--){
+		j = s;
+		for(k=0;k<SWEEP_NPAR;k++){
+			out->theta[s*SWEEP_NPAR + k] = grid[k][j % nval[k]];
+			j /= nval[k];
+		}
+
+		/* as in epidemics.sweep, infectious periods last at least a step */
+		for(k=2;k<SWEEP_NPAR;k++){
+			if(out->theta[s*SWEEP_NPAR + k] != floor(out->theta[s*SWEEP_NPAR + k])){
+				fprintf(stderr, "\n[in: paramfile.c->read_paramfile]\n%s: %s must be integers. Exiting.\n", file, gridnames[k]);
+				exit(1);
+			}
+		}
+		if(out->theta[s*SWEEP_NPAR + 3] <= out->theta[s*SWEEP_NPAR + 2]) out->theta[s*SWEEP_NPAR + 3] = out->theta[s*SWEEP_NPAR + 2] + 1.0;
+
+		/* check the scenario; the first one is left in 'par' */
+		par->beta = out->theta[s*SWEEP_NPAR];
+		par->mu = out->theta[s*SWEEP_NPAR + 1];
+		par->muL = par->mu * par->L;
+		par->t1 = (int) out->theta[s*SWEEP_NPAR + 2];
+		par->t2 = (int) out->theta[s*SWEEP_NPAR + 3];
+		check_param(par);
+	}
+
+	free(line);
+	free(val);
+	for(k=0;k<SWEEP_NPAR;k++) free(grid[k]);
+
+	return out;
+}
+
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_paramfile(struct paramfile *in){
+	if(in == NULL) return;
+	free(in->par->popsizes);
+	free(in->par->t_sample);
+	free(in->par->cn_nb_nb);
+	free(in->par->cn_list_nb);
+	free(in->par->cn_weights);
+	free(in->par);
+	free(in->theta);
+	free(in->output);
+	free(in->network);
+	free(in);
+}
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+void print_paramfile(struct paramfile *in){
+	print_param(in->par);
+	printf("\n-- %d scenarios x %d replicates --", in->nscen, in->nrep);
+	printf("\nseed: %lu   threads: %d   common random numbers: %s", in->seed, in->nthreads, in->crn ? "TRUE" : "FALSE");
+	printf("\noutput files: %s-sweep.bin, %s-popsize.bin\n", in->output, in->output);
+}
@@ -0,0 +1,91 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions read simulation parameters from a file.
+  Requires param.h and sweep.h to be included first.
+*/
+
+
+/*
+   ==================
+   === STRUCTURES ===
+   ==================
+*/
+
+/* Parameter files */
+/* Each line is 'name = value', where the value is a number, a list of */
+/* numbers separated by commas or spaces, or a range 'from:to' or */
+/* 'from:to:by' (as seq(from, to, by) in R); text after '#' is ignored. */
+/* Names are those of the arguments of epidemics.sweep: */
+/* - seq.length, n.ini.inf, n.sample, duration: single values */
+/* - beta, mut.rate, t.infectious, t.recover: one or several values; the */
+/* scenarios are all their combinations, beta varying fastest; as in */
+/* epidemics.sweep, t.recover is raised to t.infectious+1 if needed */
+/* - pop.sizes: the size of each population */
+/* - t.sample: the sampling time of each isolate, recycled (default 0) */
+/* - network: a text file of the connections between populations, one */
+/* per line as 'from to weight', where 'weight' is the probability of */
+/* dispersal from population 'from' to population 'to' (from 1); as in */
+/* metaPopInfo objects, a population keeps 1 minus the sum of its weights; */
+/* a relative path starts from the directory of the parameter file; files */
+/* ending with '.bin' are binary network files (see dispersal.h) */
+/* - xy, graph, p.disp, decay: instead of a network, connections built */
+/* from the coordinates of the populations: 'xy' is a text file of one */
+/* 'x y' line per population (paths as for network), 'graph' is */
+/* 'delaunay', 'knn k' or 'distance d1 d2' (see spatial.h); each */
+/* population disperses p.disp to its neighbours, in proportion to */
+/* distance^-decay (decay is 0, equal weights, by default) */
+/* - n.rep, crn (TRUE/FALSE), seed, n.threads: as in epidemics.sweep */
+/* - output: prefix of the output files (default 'out') */
+#define PARAMFILE_MAXNAME 32
+
+
+/* Parameter sweep read from a file */
+/* - 'par' holds the parameters shared by all scenarios, and those of the */
+/* first scenario; it owns its arrays, and has no generator */
+/* - 'theta': parameters of the 'nscen' scenarios, as in struct sweep */
+/* - 'output': prefix of the output files */
+/* - 'network': binary network file, NULL if the connections are in 'par' */
+/* (which then has no cn_nb_nb, cn_list_nb and cn_weights) */
+struct paramfile{
+	struct param *par;
+	double *theta;
+	char *output, *network;
+	int nscen, nrep, nthreads;
+	unsigned long seed;
+	bool crn;
+};
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+/* read and check a parameter file; exits with a message on error */
+struct paramfile * read_paramfile(const char *file);
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_paramfile(struct paramfile *in);
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+void print_paramfile(struct paramfile *in);
@@ -8,6 +8,8 @@
 
 
 #include "common.h"
+#include "philox.h"
+#include "rng.h"
 #include "param.h"
 #include "auxiliary.h"
 #include "pathogens.h"
@@ -164,7 +166,7 @@ struct pathogen * copy_pathogen(struct pathogen *in){
 
 /* generate a mutation (possibly an existing one) */
 int make_mutation(struct param *par){
-	return gsl_rng_uniform_int(par->rng,par->L)+1;
+	return rng_uniform_int(par->rng,par->L)+1;
 }
 
 
@@ -251,6 +253,172 @@ struct pathogen * reconstruct_genome(struct pathogen *in){
 }
 
 
+
+
+/* toggle the parity of a site in a set of mutated sites */
+/* - 'active' lists the sites with odd parity, 'nactive' is its length */
+/* - 'pos' gives the position of each site in 'active' (-1 if absent) */
+static void toggle_site(int site, int *active, int *nactive, int *pos){
+	int last;
+	if(pos[site] > -1){ /* remove site */
+		last = active[--(*nactive)];
+		active[pos[site]] = last;
+		pos[last] = pos[site];
+		pos[site] = -1;
+	} else { /* add site */
+		pos[site] = *nactive;
+		active[(*nactive)++] = site;
+	}
+}
+
+
+
+
+/* RECONSTRUCT GENOMES OF A SET OF ISOLATES */
+/* The union of the lineages of the n isolates is browsed once, and genomes */
+/* are propagated from the roots down to the isolates by toggling the parity */
+/* of mutated sites; the cost is proportional to the size of the induced */
+/* subtree rather than to n x lineage length. */
+/*  (memory allocation for out made outside the function) */
+void reconstruct_sample(struct pathogen **in, struct pathogen **out, int n, struct param *par){
+	int i, j, k, node, nnodes=0, maxnodes=2*n+1, chainsize=0, maxchain=64, anc, nactive=0, top=0;
+	int *parent, *leafnode, *nbChildren, *firstChild, *children, *firstLeaf, *leaves, *stack, *active, *pos, *snps;
+	struct pathogen **nodes, **chain, *cur;
+	struct hash_ptr *map = create_hash_ptr(maxnodes);
+
+	nodes = (struct pathogen **) malloc(maxnodes * sizeof(struct pathogen *));
+	parent = (int *) malloc(maxnodes * sizeof(int));
+	chain = (struct pathogen **) malloc(maxchain * sizeof(struct pathogen *));
+	leafnode = (int *) malloc(n * sizeof(int));
+	if(nodes == NULL || parent == NULL || chain == NULL || (n>0 && leafnode == NULL)){
+		fprintf(stderr, "\n[in: pathogen.c->reconstruct_sample]\nNo memory left to reconstruct sample genomes. Exiting.\n");
+		exit(1);
+	}
+
+	/* LIST NODES OF THE INDUCED SUBTREE, PARENTS FIRST */
+	for(i=0;i<n;i++){
+		/* browse ancestry backward until a known node is found */
+		chainsize = 0;
+		cur = in[i];
+		while(cur != NULL && hash_ptr_get(map, cur) < 0){
+			if(chainsize == maxchain){
+				maxchain *= 2;
+				chain = (struct pathogen **) realloc(chain, maxchain * sizeof(struct pathogen *));
+				if(chain == NULL){
+					fprintf(stderr, "\n[in: pathogen.c->reconstruct_sample]\nNo memory left to reconstruct sample genomes. Exiting.\n");
+					exit(1);
+				}
+			}
+			chain[chainsize++] = cur;
+			cur = get_ances(cur);
+		}
+		anc = (cur == NULL) ? -1 : hash_ptr_get(map, cur);
+
+		/* add new nodes from the oldest to the most recent */
+		if(nnodes + chainsize > maxnodes){
+			while(nnodes + chainsize > maxnodes) maxnodes *= 2;
+			nodes = (struct pathogen **) realloc(nodes, maxnodes * sizeof(struct pathogen *));
+			parent = (int *) realloc(parent, maxnodes * sizeof(int));
+			if(nodes == NULL || parent == NULL){
+				fprintf(stderr, "\n[in: pathogen.c->reconstruct_sample]\nNo memory left to reconstruct sample genomes. Exiting.\n");
+				exit(1);
+			}
+		}
+		for(k=chainsize-1;k>=0;k--){
+			nodes[nnodes] = chain[k];
+			parent[nnodes] = anc;
+			hash_ptr_set(map, chain[k], nnodes);
+			anc = nnodes++;
+		}
+
+		leafnode[i] = hash_ptr_get(map, in[i]);
+	}
+
+	/* BUILD CHILDREN AND ISOLATES LISTS (CSR: first[i]..first[i+1]-1) */
+	nbChildren = (int *) calloc(nnodes+1, sizeof(int));
+	firstChild = (int *) calloc(nnodes+2, sizeof(int));
+	firstLeaf = (int *) calloc(nnodes+2, sizeof(int));
+	children = (int *) malloc((nnodes+1) * sizeof(int));
+	leaves = (int *) malloc((n+1) * sizeof(int));
+	stack = (int *) malloc((2*nnodes+1) * sizeof(int));
+	if(nbChildren == NULL || firstChild == NULL || firstLeaf == NULL || children == NULL || leaves == NULL || stack == NULL){
+		fprintf(stderr, "\n[in: pathogen.c->reconstruct_sample]\nNo memory left to reconstruct sample genomes. Exiting.\n");
+		exit(1);
+	}
+
+	/* roots are stored as children of a virtual node 'nnodes' */
+	for(j=0;j<nnodes;j++) firstChild[(parent[j] < 0 ? nnodes : parent[j]) + 1]++;
+	for(j=0;j<=nnodes;j++) firstChild[j+1] += firstChild[j];
+	for(j=0;j<nnodes;j++){
+		k = parent[j] < 0 ? nnodes : parent[j];
+		children[firstChild[k] + nbChildren[k]++] = j;
+	}
+
+	for(i=0;i<n;i++) firstLeaf[leafnode[i]+1]++;
+	for(j=0;j<=nnodes;j++) firstLeaf[j+1] += firstLeaf[j];
+	for(j=0;j<=nnodes;j++) nbChildren[j] = 0; /* reused as counter */
+	for(i=0;i<n;i++) leaves[firstLeaf[leafnode[i]] + nbChildren[leafnode[i]]++] = i;
+
+	/* PROPAGATE GENOMES TOP-DOWN (ITERATIVE DFS) */
+	active = (int *) malloc((par->L+1) * sizeof(int));
+	pos = (int *) malloc((par->L+1) * sizeof(int));
+	if(active == NULL || pos == NULL){
+		fprintf(stderr, "\n[in: pathogen.c->reconstruct_sample]\nNo memory left to reconstruct sample genomes. Exiting.\n");
+		exit(1);
+	}
+	for(j=0;j<=par->L;j++) pos[j] = -1;
+
+	for(j=firstChild[nnodes];j<firstChild[nnodes+1];j++) stack[top++] = children[j];
+	while(top > 0){
+		node = stack[--top];
+		if(node < 0){ /* leaving a node: undo its mutations */
+			node = -node-1;
+			snps = get_snps(nodes[node]);
+			for(k=0;k<get_nb_snps(nodes[node]);k++) toggle_site(snps[k], active, &nactive, pos);
+			continue;
+		}
+
+		/* entering a node: apply its mutations */
+		snps = get_snps(nodes[node]);
+		for(k=0;k<get_nb_snps(nodes[node]);k++) toggle_site(snps[k], active, &nactive, pos);
+
+		/* output genomes of isolates matching this node */
+		for(j=firstLeaf[node];j<firstLeaf[node+1];j++){
+			i = leaves[j];
+			out[i] = (struct pathogen *) malloc(sizeof(struct pathogen));
+			if(out[i] == NULL){
+				fprintf(stderr, "\n[in: pathogen.c->reconstruct_sample]\nNo memory left to reconstruct sample genomes. Exiting.\n");
+				exit(1);
+			}
+			out[i]->age = in[i]->age;
+			out[i]->ances = in[i]; /* isolates descend from the pathogen sampled */
+			out[i]->snps = create_vec_int(nactive);
+			for(k=0;k<nactive;k++) out[i]->snps->values[k] = active[k];
+		}
+
+		/* visit children, then leave the node */
+		stack[top++] = -node-1;
+		for(j=firstChild[node];j<firstChild[node+1];j++) stack[top++] = children[j];
+	}
+
+	/* free temporary allocation */
+	free_hash_ptr(map);
+	free(nodes);
+	free(parent);
+	free(chain);
+	free(leafnode);
+	free(nbChildren);
+	free(firstChild);
+	free(firstLeaf);
+	free(children);
+	free(leaves);
+	free(stack);
+	free(active);
+	free(pos);
+}
+
+
+
  
 
 
@@ -261,7 +429,7 @@ struct pathogen * reconstruct_genome(struct pathogen *in){
 */
 /* Function replicating a genome */
 struct pathogen * replicate(struct pathogen *in, struct param *par){
-	int i, nbmut=gsl_ran_poisson(par->rng, par->muL);
+	int i, nbmut=rng_poisson(par->rng, par->muL);
 	struct pathogen *out = (struct pathogen *) malloc(sizeof(struct pathogen));
 	if(out == NULL){
 		fprintf(stderr, "\n[in: pathogen.c->reconstruct_genome]\nNo memory left to reconstruct pathogen genome. Exiting.\n");
@@ -288,6 +456,63 @@ struct pathogen * replicate(struct pathogen *in, struct param *par){
 
 
 
+/* Function replicating a cohort of genomes */
+/* The total number of mutations is drawn once, as a Poisson of mean n*muL, */
+/* and each mutation is assigned to a uniformly chosen genome, so that each */
+/* genome has a Poisson number of mutations as in replicate(). Owners and */
+/* positions of all mutations are drawn in two bulk calls. */
+void replicate_cohort(struct pathogen **ances, int n, struct pathogen **out, struct param *par){
+	int i, j, start, nbmut, *first;
+	unsigned int *who, *sites, *sorted;
+	struct pathogen *newpat;
+
+	if(n < 1) return;
+	nbmut = rng_poisson(par->rng, n * par->muL);
+
+	who = (unsigned int *) malloc((nbmut > 0 ? nbmut : 1) * sizeof(unsigned int));
+	sites = (unsigned int *) malloc((nbmut > 0 ? nbmut : 1) * sizeof(unsigned int));
+	sorted = (unsigned int *) malloc((nbmut > 0 ? nbmut : 1) * sizeof(unsigned int));
+	first = (int *) calloc(n+1, sizeof(int));
+	if(who == NULL || sites == NULL || sorted == NULL || first == NULL){
+		fprintf(stderr, "\n[in: pathogen.c->replicate_cohort]\nNo memory left to replicate genomes. Exiting.\n");
+		exit(1);
+	}
+
+	/* DRAW OWNERS AND POSITIONS OF MUTATIONS */
+	rng_fill_uniform_int(par->rng, n, who, nbmut);
+	rng_fill_uniform_int(par->rng, par->L, sites, nbmut);
+
+	/* GROUP MUTATIONS BY GENOME (counting sort) */
+	for(j=0;j<nbmut;j++) first[who[j]+1]++;
+	for(i=0;i<n;i++) first[i+1] += first[i];
+	for(j=0;j<nbmut;j++) sorted[first[who[j]]++] = sites[j] + 1;
+	/* first[i] now indexes the end of the mutations of genome i */
+
+	/* CREATE NEW GENOMES */
+	for(i=0;i<n;i++){
+		newpat = (struct pathogen *) malloc(sizeof(struct pathogen));
+		if(newpat == NULL){
+			fprintf(stderr, "\n[in: pathogen.c->replicate_cohort]\nNo memory left to replicate genomes. Exiting.\n");
+			exit(1);
+		}
+		newpat->age = 0;
+		newpat->ances = ances[i];
+		start = i > 0 ? first[i-1] : 0;
+		newpat->snps = create_vec_int(first[i] - start);
+		for(j=start;j<first[i];j++) newpat->snps->values[j-start] = sorted[j];
+		out[i] = newpat;
+	}
+
+	free(who);
+	free(sites);
+	free(sorted);
+	free(first);
+} /*end replicate_cohort*/
+
+
+
+
+
 /* TEST IF PATHOGEN IS NULL OR INACTIVATED */
 bool is_activated(struct pathogen *in){
 	return in->age > -1;
@@ -316,7 +541,7 @@ bool is_infectious(struct pathogen *in, struct param *par){
 
 /* gcc line:
 
-   gcc -o pathogens param.c auxiliary.c pathogens.c -Wall -O0 -lgsl -lgslcblas
+   gcc -o pathogens param.c auxiliary.c philox.c rng.c pathogens.c -Wall -O0 -lgsl -lgslcblas
   
    valgrind --leak-check=yes pathogens
 
@@ -125,6 +125,10 @@ struct lineage * get_lineage(struct pathogen *in);
 /* Reconstruct genome of an isolate */
 struct pathogen * reconstruct_genome(struct pathogen *in);
 
+/* Reconstruct genomes of several isolates, browsing their ancestries once */
+/* The ancestor of each isolate out[i] is the pathogen it was drawn from, in[i] */
+void reconstruct_sample(struct pathogen **in, struct pathogen **out, int n, struct param *par);
+
 
 
 
@@ -139,6 +143,10 @@ struct pathogen * reconstruct_genome(struct pathogen *in);
 /* Function replicating a genome, with mutations and back-mutations */
 struct pathogen * replicate(struct pathogen *in, struct param *par);
 
+/* REPLICATE A COHORT OF n GENOMES: out[i] descends from ances[i] */
+/* 'out' may be the same array as 'ances' */
+void replicate_cohort(struct pathogen **ances, int n, struct pathogen **out, struct param *par);
+
 
 /* TEST IF PATHOGEN IS ACTIVATED (i.e., not with a negative age) */
 bool is_activated(struct pathogen *in);
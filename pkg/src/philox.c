@@ -0,0 +1,115 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions implement a counter-based random number generator.
+*/
+
+#include "common.h"
+#include "philox.h"
+
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+#define PHILOX_ROUNDS 10
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+/* Compute the random block of a given counter and key */
+void philox4x32(unsigned int *ctr, unsigned int *key, unsigned int *out){
+	int i;
+	unsigned int c0=ctr[0], c1=ctr[1], c2=ctr[2], c3=ctr[3], k0=key[0], k1=key[1];
+	unsigned long long p0, p1;
+
+	for(i=0;i<PHILOX_ROUNDS;i++){
+		p0 = (unsigned long long) PHILOX_M0 * c0;
+		p1 = (unsigned long long) PHILOX_M1 * c2;
+		c0 = ((unsigned int) (p1 >> 32)) ^ c1 ^ k0;
+		c2 = ((unsigned int) (p0 >> 32)) ^ c3 ^ k1;
+		c1 = (unsigned int) p1;
+		c3 = (unsigned int) p0;
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+
+	out[0] = c0;
+	out[1] = c1;
+	out[2] = c2;
+	out[3] = c3;
+}
+
+
+
+
+/* GSL interface */
+static void philox_set(void *vstate, unsigned long int seed){
+	struct philox_state *state = (struct philox_state *) vstate;
+	unsigned long long s = (unsigned long long) seed;
+
+	state->key[0] = (unsigned int) s;
+	state->key[1] = (unsigned int) (s >> 32);
+	state->ctr[0] = state->ctr[1] = state->ctr[2] = state->ctr[3] = 0;
+	state->idx = 4; /* empty buffer */
+}
+
+
+
+static unsigned long int philox_get(void *vstate){
+	struct philox_state *state = (struct philox_state *) vstate;
+
+	if(state->idx == 4){
+		philox4x32(state->ctr, state->key, state->out);
+		state->ctr[0]++;
+		state->idx = 0;
+	}
+
+	return state->out[state->idx++];
+}
+
+
+
+static double philox_get_double(void *vstate){
+	return philox_get(vstate) / 4294967296.0;
+}
+
+
+
+static const gsl_rng_type philox_type = {
+	"philox4x32",
+	0xffffffffUL,
+	0,
+	sizeof(struct philox_state),
+	&philox_set,
+	&philox_get,
+	&philox_get_double
+};
+
+const gsl_rng_type *gsl_rng_philox = &philox_type;
+
+
+
+
+/* gcc line:
+
+   gcc -o philox philox.c -Wall -O0 -lgsl -lgslcblas
+
+*/
+
+
+/* int main(){ */
+/* 	/\* known answer test (Random123): counter 0, key 0 *\/ */
+/* 	unsigned int ctr[4] = {0,0,0,0}, key[2] = {0,0}, out[4]; */
+/* 	philox4x32(ctr, key, out); */
+/* 	printf("\n%08x %08x %08x %08x", out[0], out[1], out[2], out[3]); */
+/* 	printf("\nexpected: 6627e8d5 e169c58d bc57ac4c 9b00dbd8\n"); */
+/* 	return 0; */
+/* } */
@@ -0,0 +1,44 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions implement a counter-based random number generator.
+*/
+
+
+/*
+   ==================
+   === STRUCTURES ===
+   ==================
+*/
+
+/* Philox4x32-10 (Salmon et al. 2011): the n-th random block is a bijective */
+/* function of a 128-bit counter, keyed by the 64-bit seed. Any substream */
+/* can therefore be reached directly, without generating the previous ones. */
+/* The counter is split as follows: */
+/* - ctr[0]: index of the block within a substream */
+/* - ctr[1]: time step */
+/* - ctr[2]: population (24 bits) and purpose of the draws (8 bits) */
+/* - ctr[3]: replicate */
+/* Each block gives four 32-bit numbers, buffered in 'out'. */
+struct philox_state{
+	unsigned int key[2], ctr[4], out[4];
+	int idx;
+};
+
+
+/* GSL generator type, usable with all gsl_ran_* functions */
+extern const gsl_rng_type *gsl_rng_philox;
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+/* compute one Philox4x32-10 block */
+void philox4x32(unsigned int *ctr, unsigned int *key, unsigned int *out);
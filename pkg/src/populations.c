@@ -8,6 +8,8 @@
 */
 
 #include "common.h"
+#include "philox.h"
+#include "rng.h"
 #include "param.h"
 #include "pathogens.h"
 #include "populations.h"
@@ -171,6 +173,7 @@ struct population * create_population(int popsize, int nini, int popid){
 	out->nrec = 0;
 	out->nexpcum = nini;
 	out->popid = popid;
+	out->nshared = 0;
 
 	/* allocate pathogen array */
 	out->pathogens = (struct pathogen **) malloc(popsize * sizeof(struct pathogen *));
@@ -280,7 +283,7 @@ struct ts_groupsizes * create_ts_groupsizes(struct param * par){
 void free_population(struct population *in){
 	int i;
 
-	for(i=0;i<in->nexpcum;i++){
+	for(i=in->nshared;i<in->nexpcum;i++){
 		if(in->pathogens[i] != NULL) free_pathogen((in->pathogens)[i]);
 	}
 
@@ -469,7 +472,31 @@ void fill_ts_groupsizes(struct ts_groupsizes *in, struct metapopulation *metapop
 /* SELECT A RANDOM INFECTIOUS PATHOGEN FROM THE POPULATION */
 struct pathogen * select_random_infectious_pathogen(struct population *in, struct param *par){
 	if(in->ninf==1) return get_pathogens(in)[in->nrec]; /* gsl_rng_unif does not like a range of 0 */
-	return  get_pathogens(in)[in->nrec + gsl_rng_uniform_int(par->rng, in->ninf)];
+	return  get_pathogens(in)[in->nrec + rng_uniform_int(par->rng, in->ninf)];
+}
+
+
+
+
+
+/* SELECT n RANDOM INFECTIOUS PATHOGENS (WITH REPLACEMENT) */
+/* indices are drawn in one bulk call */
+void select_random_infectious_pathogens(struct population *in, int n, struct pathogen **out, int *ids, struct param *par){
+	int i;
+	unsigned int *idx;
+
+	if(n < 1) return;
+	idx = (unsigned int *) malloc(n * sizeof(unsigned int));
+	if(idx == NULL){
+		fprintf(stderr, "\n[in: populations.c->select_random_infectious_pathogens]\nNo memory left for selecting pathogens. Exiting.\n");
+		exit(1);
+	}
+
+	rng_fill_uniform_int(par->rng, in->ninf, idx, n);
+	for(i=0;i<n;i++) out[i] = get_pathogens(in)[in->nrec + idx[i]];
+	if(ids != NULL) for(i=0;i<n;i++) ids[i] = in->nrec + idx[i];
+
+	free(idx);
 }
 
 
@@ -482,7 +509,7 @@ struct pathogen * select_random_pathogen(struct population *in, struct param *pa
 	/* printf("\nfirst pathogen: %d     last pathogen: %d ", in->nrec, in->nrec + nbavail - 1); */
 	if(nbavail < 1) return NULL;
 	if(nbavail == 1) return get_pathogens(in)[in->nrec]; /* gsl_rng_unif does not like a range of 0 */
-	id = in->nrec + gsl_rng_uniform_int(par->rng, nbavail);
+	id = in->nrec + rng_uniform_int(par->rng, nbavail);
 	return get_pathogens(in)[id];
 }
 
@@ -490,7 +517,7 @@ struct pathogen * select_random_pathogen(struct population *in, struct param *pa
 
 /* gcc line:
 
-   gcc -o populations param.c auxiliary.c pathogens.c populations.c -Wall -O0 -lgsl -lgslcblas
+   gcc -o populations param.c auxiliary.c philox.c rng.c pathogens.c populations.c -Wall -O0 -lgsl -lgslcblas
 
    valgrind --leak-check=yes populations
 
@@ -15,8 +15,11 @@
 */
 
 
+/* 'pathogens' lists the nexpcum pathogens infecting the population, */
+/* recovered first; the first 'nshared' ones belong to the simulation this */
+/* one was forked from (see fork_simulation), and are not freed with it */
 struct population{
-	int nsus, nexp, ninf, nrec, nexpcum, popsize, popid, idfirstinfectious, idlastinfectious;
+	int nsus, nexp, ninf, nrec, nexpcum, popsize, popid, idfirstinfectious, idlastinfectious, nshared;
 	struct pathogen **pathogens;
 };
 
@@ -154,5 +157,9 @@ void fill_ts_groupsizes(struct ts_groupsizes *in, struct metapopulation *metapop
 /* SELECT A RANDOM INFECTIOUS PATHOGEN FROM THE POPULATION */
 struct pathogen * select_random_infectious_pathogen(struct population *in, struct param *par);
 
+/* SELECT n RANDOM INFECTIOUS PATHOGENS (WITH REPLACEMENT), STORED IN out */
+/* their indices in the population are stored in ids, unless it is NULL */
+void select_random_infectious_pathogens(struct population *in, int n, struct pathogen **out, int *ids, struct param *par);
+
 /* SELECT A RANDOM PATHOGEN FROM THE POPULATION */
 struct pathogen * select_random_pathogen(struct population *in, struct param *par);
@@ -0,0 +1,317 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions provide the random numbers used by the simulations.
+*/
+
+#include "common.h"
+#include "philox.h"
+#include "rng.h"
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+/* SplitMix64 finaliser, used to derive the state of a substream */
+static unsigned long long mix64(unsigned long long z){
+	z += 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+
+
+/* Hash a key and a substream index into a 64-bit seed */
+static unsigned long long stream_seed(unsigned long long key, int rep, int step, int pop, int purpose){
+	unsigned long long h = mix64(key);
+	h = mix64(h ^ (unsigned int) rep);
+	h = mix64(h ^ (unsigned int) step);
+	h = mix64(h ^ ((((unsigned long long) (unsigned int) pop) << 8) | (((unsigned int) purpose) & 0xffU)));
+	return h;
+}
+
+
+
+static void xoshiro_seed(struct xoshiro_state *state, unsigned long long h){
+	int i;
+	for(i=0;i<4;i++) state->s[i] = mix64(h + i * 0x9E3779B97F4A7C15ULL);
+}
+
+
+
+static void pcg_seed(struct pcg_state *state, unsigned long long h){
+	state->inc = (mix64(h ^ 0xDA3E39CB94B95BDBULL) << 1) | 1ULL;
+	state->state = 0;
+	pcg_next(state);
+	state->state += mix64(h);
+	pcg_next(state);
+}
+
+
+
+/* GSL interface: xoshiro256++ */
+static void xoshiro_set(void *vstate, unsigned long int seed){
+	struct xoshiro_state *state = (struct xoshiro_state *) vstate;
+	state->key = (unsigned long long) seed;
+	state->rep = state->step = state->pop = 0;
+	xoshiro_seed(state, stream_seed(state->key, 0, 0, 0, 0));
+}
+
+
+
+static unsigned long int xoshiro_get(void *vstate){
+	return (unsigned long int) (xoshiro_next((struct xoshiro_state *) vstate) >> 32);
+}
+
+
+
+static double xoshiro_get_double(void *vstate){
+	return (xoshiro_next((struct xoshiro_state *) vstate) >> 11) / 9007199254740992.0;
+}
+
+
+
+static const gsl_rng_type xoshiro_type = {
+	"xoshiro256++",
+	0xffffffffUL,
+	0,
+	sizeof(struct xoshiro_state),
+	&xoshiro_set,
+	&xoshiro_get,
+	&xoshiro_get_double
+};
+
+const gsl_rng_type *gsl_rng_xoshiro = &xoshiro_type;
+
+
+
+/* GSL interface: PCG32 */
+static void pcg_set(void *vstate, unsigned long int seed){
+	struct pcg_state *state = (struct pcg_state *) vstate;
+	state->key = (unsigned long long) seed;
+	state->rep = state->step = state->pop = 0;
+	pcg_seed(state, stream_seed(state->key, 0, 0, 0, 0));
+}
+
+
+
+static unsigned long int pcg_get(void *vstate){
+	return (unsigned long int) pcg_next((struct pcg_state *) vstate);
+}
+
+
+
+static double pcg_get_double(void *vstate){
+	return pcg_next((struct pcg_state *) vstate) / 4294967296.0;
+}
+
+
+
+static const gsl_rng_type pcg_type = {
+	"pcg32",
+	0xffffffffUL,
+	0,
+	sizeof(struct pcg_state),
+	&pcg_set,
+	&pcg_get,
+	&pcg_get_double
+};
+
+const gsl_rng_type *gsl_rng_pcg = &pcg_type;
+
+
+
+const char * get_rng_backend(){
+#if defined(RNG_XOSHIRO)
+#define RNG_NAME "xoshiro256++"
+#elif defined(RNG_PCG)
+#define RNG_NAME "pcg32"
+#else
+#define RNG_NAME "philox4x32"
+#endif
+#ifdef RNG_GSL
+	return RNG_NAME "/gsl";
+#else
+	return RNG_NAME;
+#endif
+}
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+gsl_rng * create_rng(unsigned long seed){
+	gsl_rng *out = gsl_rng_alloc(RNG_TYPE);
+	if(out == NULL){
+		fprintf(stderr, "\n[in: rng.c->create_rng]\nNo memory left for creating random number generator. Exiting.\n");
+		exit(1);
+	}
+	gsl_rng_set(out, seed);
+	return out;
+}
+
+
+
+
+/*
+   ===============================
+   === MAIN EXTERNAL FUNCTIONS ===
+   ===============================
+*/
+
+/* Jump to a substream */
+/* Philox counters are set directly; other generators are reseeded from a */
+/* hash of their key and of the substream index. */
+void rng_set_stream(gsl_rng *r, int rep, int step, int pop, int purpose){
+	struct philox_state *ph;
+	struct xoshiro_state *xo;
+	struct pcg_state *pc;
+
+	if(r->type == gsl_rng_philox){
+		ph = (struct philox_state *) gsl_rng_state(r);
+		ph->ctr[0] = 0;
+		ph->ctr[1] = (unsigned int) step;
+		ph->ctr[2] = (((unsigned int) pop) << 8) | (((unsigned int) purpose) & 0xffU);
+		ph->ctr[3] = (unsigned int) rep;
+		ph->idx = 4;
+	} else if(r->type == gsl_rng_xoshiro){
+		xo = (struct xoshiro_state *) gsl_rng_state(r);
+		xo->rep = rep;
+		xo->step = step;
+		xo->pop = pop;
+		xoshiro_seed(xo, stream_seed(xo->key, rep, step, pop, purpose));
+	} else if(r->type == gsl_rng_pcg){
+		pc = (struct pcg_state *) gsl_rng_state(r);
+		pc->rep = rep;
+		pc->step = step;
+		pc->pop = pop;
+		pcg_seed(pc, stream_seed(pc->key, rep, step, pop, purpose));
+	}
+}
+
+
+
+void rng_set_purpose(gsl_rng *r, int purpose){
+	struct philox_state *ph;
+	struct xoshiro_state *xo;
+	struct pcg_state *pc;
+
+	if(r->type == gsl_rng_philox){
+		ph = (struct philox_state *) gsl_rng_state(r);
+		rng_set_stream(r, (int) ph->ctr[3], (int) ph->ctr[1], (int) (ph->ctr[2] >> 8), purpose);
+	} else if(r->type == gsl_rng_xoshiro){
+		xo = (struct xoshiro_state *) gsl_rng_state(r);
+		rng_set_stream(r, xo->rep, xo->step, xo->pop, purpose);
+	} else if(r->type == gsl_rng_pcg){
+		pc = (struct pcg_state *) gsl_rng_state(r);
+		rng_set_stream(r, pc->rep, pc->step, pc->pop, purpose);
+	}
+}
+
+
+
+/* Bulk draws */
+/* Philox blocks are written directly to the output; the sequence is the same */
+/* as with successive calls to rng_u32. */
+void rng_fill_u32(gsl_rng *r, unsigned int *x, int n){
+	int i = 0;
+	struct philox_state *st;
+
+	if(r->type == gsl_rng_philox){
+		st = (struct philox_state *) gsl_rng_state(r);
+		while(i < n && st->idx < 4) x[i++] = st->out[st->idx++];
+		for(;i+4<=n;i+=4){
+			philox4x32(st->ctr, st->key, x+i);
+			st->ctr[0]++;
+		}
+	}
+	for(;i<n;i++) x[i] = rng_u32(r);
+}
+
+
+
+void rng_fill_uniform(gsl_rng *r, double *x, int n){
+	int i, j, k;
+	unsigned int buf[RNG_BULK];
+
+#ifdef RNG_GSL
+	for(i=0;i<n;i++) x[i] = gsl_rng_uniform(r);
+#else
+	for(i=0;i<n;i+=RNG_BULK){
+		k = n-i < RNG_BULK ? n-i : RNG_BULK;
+		rng_fill_u32(r, buf, k);
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+		for(j=0;j<k;j++) x[i+j] = buf[j] / 4294967296.0;
+	}
+#endif
+}
+
+
+
+/* Bounded integers by Lemire's method, in three passes: raw 32-bit values, */
+/* rejection of the (rare) values whose low product word falls below */
+/* 2^32 mod range, then a branch-free multiply-shift which vectorises. */
+void rng_fill_uniform_int(gsl_rng *r, unsigned int range, unsigned int *x, int n){
+	int i;
+#ifdef RNG_GSL
+	for(i=0;i<n;i++) x[i] = range > 0 ? (unsigned int) gsl_rng_uniform_int(r, range) : 0;
+#else
+	unsigned int t;
+
+	if(range < 2){
+		for(i=0;i<n;i++) x[i] = 0;
+		return;
+	}
+
+	rng_fill_u32(r, x, n);
+
+	t = (-range) % range;
+	for(i=0;i<n;i++){
+		while(x[i] * range < t) x[i] = rng_u32(r);
+	}
+
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+	for(i=0;i<n;i++) x[i] = (unsigned int) (((unsigned long long) x[i] * range) >> 32);
+#endif
+}
+
+
+
+/* gcc line:
+
+   gcc -o rng rng.c philox.c -Wall -O2 -lgsl -lgslcblas -lm
+
+*/
+
+
+/* int main(){ */
+/* 	int i, n = 1000000; */
+/* 	double m = 0.0, m2 = 0.0, x; */
+/* 	gsl_rng *r = create_rng(1); */
+/* 	rng_set_stream(r, 0, 1, 0, RNG_INIT); */
+/* 	for(i=0;i<n;i++){ */
+/* 		x = rng_poisson(r, 0.1); */
+/* 		m += x; */
+/* 		m2 += x*x; */
+/* 	} */
+/* 	printf("\n%s: Poisson(0.1) mean %f, variance %f\n", get_rng_backend(), m/n, m2/n - (m/n)*(m/n)); */
+/* 	gsl_rng_free(r); */
+/* 	return 0; */
+/* } */
@@ -0,0 +1,332 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions provide the random numbers used by the simulations.
+  Requires philox.h to be included first.
+*/
+
+
+/*
+  The generator is chosen at compile time:
+  - default: Philox4x32-10 (philox.c)
+  - RNG_XOSHIRO: xoshiro256++
+  - RNG_PCG: PCG32 (XSH-RR)
+  All three are gsl_rng types whose substreams are addressed by rng_set_stream.
+
+  The draws used in the simulations (rng_uniform_int, rng_poisson, ...) are
+  inlined, reading the state of the generator directly instead of going through
+  GSL's function pointers. Compiling with RNG_GSL forwards all draws to the
+  corresponding gsl_rng_* / gsl_ran_* functions, which serves as reference.
+*/
+
+
+/*
+   ==================
+   === STRUCTURES ===
+   ==================
+*/
+
+/* purposes of random draws, used to address substreams; each decision of */
+/* a time step reads its own substream, so that a change in one decision */
+/* (e.g. more infections when beta is larger) does not shift the numbers */
+/* used by the next ones (common random numbers) */
+#define RNG_INIT 0
+#define RNG_INFECTION 1
+#define RNG_SAMPLING 2
+#define RNG_DYNAMICS 3
+#define RNG_PRIOR 4
+#define RNG_ANCESTRY 5
+#define RNG_MUTATION 6
+#define RNG_SPLITTING 7
+
+
+/* below these means, Poisson and binomial variates are drawn by inversion; */
+/* above, GSL's algorithms are used */
+#define RNG_INV_MAX 10.0
+
+
+/* size of the blocks of raw numbers used by bulk draws */
+#define RNG_BULK 256
+
+
+/* 'key' is the seed, kept to derive substreams; 'rep', 'step' and 'pop' */
+/* are the address of the current substream */
+struct xoshiro_state{
+	unsigned long long s[4], key;
+	int rep, step, pop;
+};
+
+struct pcg_state{
+	unsigned long long state, inc, key;
+	int rep, step, pop;
+};
+
+
+extern const gsl_rng_type *gsl_rng_xoshiro;
+extern const gsl_rng_type *gsl_rng_pcg;
+
+
+#if defined(RNG_XOSHIRO)
+#define RNG_TYPE gsl_rng_xoshiro
+#elif defined(RNG_PCG)
+#define RNG_TYPE gsl_rng_pcg
+#else
+#define RNG_TYPE gsl_rng_philox
+#endif
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+/* allocate a generator of the compiled type keyed by 'seed', positioned on substream (0,0,0,0) */
+gsl_rng * create_rng(unsigned long seed);
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+/* name of the compiled generator and draws ("philox4x32", "xoshiro256++", "pcg32", with "/gsl" for the reference draws) */
+const char * get_rng_backend();
+
+
+
+/*
+   ==========================
+   === EXTERNAL FUNCTIONS ===
+   ==========================
+*/
+
+/* jump to the substream (rep, step, pop, purpose) */
+/* Does nothing if 'r' was not created by create_rng. */
+void rng_set_stream(gsl_rng *r, int rep, int step, int pop, int purpose);
+
+/* jump to the substream of another purpose, at the same (rep, step, pop) */
+void rng_set_purpose(gsl_rng *r, int purpose);
+
+/* bulk draws: fill 'x' with 'n' values; rng_fill_uniform_int draws in 0..range-1 */
+void rng_fill_u32(gsl_rng *r, unsigned int *x, int n);
+void rng_fill_uniform(gsl_rng *r, double *x, int n);
+void rng_fill_uniform_int(gsl_rng *r, unsigned int range, unsigned int *x, int n);
+
+
+
+
+/*
+   ====================
+   === INLINE DRAWS ===
+   ====================
+*/
+
+static inline unsigned long long rng_rotl64(unsigned long long x, int k){
+	return (x << k) | (x >> (64 - k));
+}
+
+
+static inline unsigned long long xoshiro_next(struct xoshiro_state *st){
+	unsigned long long *s = st->s, res = rng_rotl64(s[0] + s[3], 23) + s[0], t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rng_rotl64(s[3], 45);
+	return res;
+}
+
+
+static inline unsigned int pcg_next(struct pcg_state *st){
+	unsigned long long old = st->state;
+	unsigned int xsh, rot;
+	st->state = old * 6364136223846793005ULL + st->inc;
+	xsh = (unsigned int) (((old >> 18) ^ old) >> 27);
+	rot = (unsigned int) (old >> 59);
+	return (xsh >> rot) | (xsh << ((-rot) & 31));
+}
+
+
+static inline unsigned int philox_next(struct philox_state *st){
+	if(st->idx == 4){
+		philox4x32(st->ctr, st->key, st->out);
+		st->ctr[0]++;
+		st->idx = 0;
+	}
+	return st->out[st->idx++];
+}
+
+
+
+/* 32 random bits */
+static inline unsigned int rng_u32(gsl_rng *r){
+#if defined(RNG_XOSHIRO)
+	if(r->type == gsl_rng_xoshiro) return (unsigned int) (xoshiro_next((struct xoshiro_state *) r->state) >> 32);
+#elif defined(RNG_PCG)
+	if(r->type == gsl_rng_pcg) return pcg_next((struct pcg_state *) r->state);
+#else
+	if(r->type == gsl_rng_philox) return philox_next((struct philox_state *) r->state);
+#endif
+	return (unsigned int) gsl_rng_get(r);
+}
+
+
+
+/* uniform on [0,1) */
+static inline double rng_uniform(gsl_rng *r){
+#ifdef RNG_GSL
+	return gsl_rng_uniform(r);
+#else
+	return rng_u32(r) / 4294967296.0;
+#endif
+}
+
+
+
+/* uniform on (0,1) */
+static inline double rng_uniform_pos(gsl_rng *r){
+	double x;
+	do{
+		x = rng_uniform(r);
+	} while(x == 0.0);
+	return x;
+}
+
+
+
+/* uniform integer in 0..n-1, unbiased (Lemire's multiply-and-reject) */
+static inline unsigned int rng_uniform_int(gsl_rng *r, unsigned int n){
+#ifdef RNG_GSL
+	return (unsigned int) gsl_rng_uniform_int(r, n);
+#else
+	unsigned long long m;
+	unsigned int l, t;
+
+	if(n == 0) return 0;
+	m = (unsigned long long) rng_u32(r) * n;
+	l = (unsigned int) m;
+	if(l < n){
+		t = (-n) % n;
+		while(l < t){
+			m = (unsigned long long) rng_u32(r) * n;
+			l = (unsigned int) m;
+		}
+	}
+	return (unsigned int) (m >> 32);
+#endif
+}
+
+
+
+static inline double rng_exponential(gsl_rng *r, double mu){
+#ifdef RNG_GSL
+	return gsl_ran_exponential(r, mu);
+#else
+	return -mu * log1p(-rng_uniform(r));
+#endif
+}
+
+
+
+/* number of trials up to the first success */
+static inline unsigned int rng_geometric(gsl_rng *r, double p){
+#ifdef RNG_GSL
+	return gsl_ran_geometric(r, p);
+#else
+	if(p >= 1.0) return 1;
+	return (unsigned int) (log(rng_uniform_pos(r)) / log1p(-p)) + 1;
+#endif
+}
+
+
+
+/* Poisson: inversion for small means, which is the case of mutations */
+static inline unsigned int rng_poisson(gsl_rng *r, double mu){
+#ifdef RNG_GSL
+	return gsl_ran_poisson(r, mu);
+#else
+	unsigned int k = 0;
+	double p, F, u;
+
+	if(mu <= 0.0) return 0;
+	if(mu > RNG_INV_MAX) return gsl_ran_poisson(r, mu);
+
+	p = F = exp(-mu);
+	u = rng_uniform(r);
+	while(u > F && p > 0.0){
+		k++;
+		p *= mu / k;
+		F += p;
+	}
+	return k;
+#endif
+}
+
+
+
+/* binomial: inversion (BINV) when n*min(p,1-p) is small */
+static inline unsigned int rng_binomial(gsl_rng *r, double p, unsigned int n){
+#ifdef RNG_GSL
+	return gsl_ran_binomial(r, p, n);
+#else
+	unsigned int k;
+	int flip = 0;
+	double q, s, a, f, u;
+
+	if(n == 0 || p <= 0.0) return 0;
+	if(p >= 1.0) return n;
+	if(p > 0.5){
+		p = 1.0 - p;
+		flip = 1;
+	}
+	if(n * p > RNG_INV_MAX) return flip ? n - gsl_ran_binomial(r, p, n) : gsl_ran_binomial(r, p, n);
+
+	q = 1.0 - p;
+	s = p / q;
+	a = (n + 1) * s;
+	do{
+		f = pow(q, (double) n);
+		u = rng_uniform(r);
+		k = 0;
+		while(u > f && k <= n){
+			u -= f;
+			k++;
+			f *= a / k - s;
+		}
+	} while(k > n); /* rounding errors: draw again */
+	return flip ? n - k : k;
+#endif
+}
+
+
+
+/* multinomial by conditional binomials, as in GSL */
+static inline void rng_multinomial(gsl_rng *r, size_t K, unsigned int N, double *p, unsigned int *n){
+#ifdef RNG_GSL
+	gsl_ran_multinomial(r, K, N, p, n);
+#else
+	size_t k;
+	double norm = 0.0, sum_p = 0.0, pk;
+	unsigned int sum_n = 0;
+
+	for(k=0;k<K;k++) norm += p[k];
+	for(k=0;k<K;k++){
+		if(p[k] > 0.0 && sum_n < N){
+			pk = p[k] / (norm - sum_p);
+			n[k] = rng_binomial(r, pk > 1.0 ? 1.0 : pk, N - sum_n);
+		} else {
+			n[k] = 0;
+		}
+		sum_p += p[k];
+		sum_n += n[k];
+	}
+#endif
+}
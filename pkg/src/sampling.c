@@ -7,11 +7,14 @@
 */
 
 #include "common.h"
+#include "philox.h"
+#include "rng.h"
 #include "auxiliary.h"
 #include "param.h"
 #include "pathogens.h"
 #include "populations.h"
 #include "dispersal.h"
+#include "eventlog.h"
 #include "infection.h"
 #include "sampling.h"
 
@@ -56,6 +59,19 @@ int get_npop_samp(struct sample *in){
 
 
 
+int get_n_view(struct sample_view *in){
+	return in->n;
+}
+
+
+
+/* get the i-th isolate of a view, as stored in the genome store */
+struct pathogen * get_view_pathogen(struct sample_view *in, int i){
+	return in->store->pathogens[in->idx[i]];
+}
+
+
+
 
 
 
@@ -93,6 +109,43 @@ struct sample * create_sample(int n){
 
 
 
+/* create a view of n isolates on a sample; indices are filled by the caller */
+struct sample_view * create_sample_view(struct sample *store, int n){
+	struct sample_view *out = (struct sample_view *) malloc(sizeof(struct sample_view));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: sampling.c->create_sample_view]\nNo memory left to create sample view. Exiting.\n");
+		exit(1);
+	}
+
+	out->idx = (int *) malloc(n * sizeof(int));
+	out->popid = (int *) malloc(n * sizeof(int));
+	if(n>0 && (out->idx == NULL || out->popid == NULL)){
+		fprintf(stderr, "\n[in: sampling.c->create_sample_view]\nNo memory left to create sample view. Exiting.\n");
+		exit(1);
+	}
+
+	out->store = store;
+	out->n = n;
+	return out;
+}
+
+
+
+/* create a view of all isolates of a sample */
+struct sample_view * view_sample(struct sample *in){
+	int i, n=get_n(in);
+	struct sample_view *out = create_sample_view(in, n);
+
+	for(i=0;i<n;i++){
+		out->idx[i] = i;
+		out->popid[i] = in->popid[i];
+	}
+
+	return out;
+}
+
+
+
 /*
    ===================
    === DESTRUCTORS ===
@@ -114,6 +167,31 @@ void free_sample(struct sample *in){
 
 
 
+/* Free sample view - the genome store is left untouched */
+void free_sample_view(struct sample_view *in){
+	if(in != NULL){
+		free(in->idx);
+		free(in->popid);
+		free(in);
+	}
+}
+
+
+
+/* Free genotypes */
+void free_genotypes(struct genotypes *in){
+	if(in != NULL){
+		free(in->popid);
+		free(in->date);
+		free(in->rowptr);
+		free(in->colidx);
+		free(in->sites);
+		free(in);
+	}
+}
+
+
+
 
 
 
@@ -124,6 +202,14 @@ void free_sample(struct sample *in){
    ===========================
 */
 
+/* Order integers increasingly (for qsort) */
+static int compare_int(const void *a, const void *b){
+	int x = *((const int *) a), y = *((const int *) b);
+	return (x > y) - (x < y);
+}
+
+
+
 /* Print sample content */
 void print_sample(struct sample *in, bool showGen){
 	int i;
@@ -154,7 +240,7 @@ void print_sample(struct sample *in, bool showGen){
 struct sample * draw_sample(struct metapopulation *in, int n, struct param *par){
 	int i, j, *nIsolatesPerPop, count;
 	double *nAvailPerPop;
-	struct pathogen *ppat;
+	struct pathogen **isolates;
 
 	/* create pointer to pathogens */
 	struct sample *out=create_sample(n);
@@ -163,6 +249,8 @@ struct sample * draw_sample(struct metapopulation *in, int n, struct param *par)
 	if(get_total_ninf(in) + get_total_nexp(in) < 1){
 		printf("\nMetapopulation without infections - sample will be empty.\n");
 		out->n = 0;
+		free(out->pathogens);
+		free(out->popid);
 		out->pathogens = NULL;
 		out->popid = NULL;
 		return out;
@@ -186,22 +274,30 @@ struct sample * draw_sample(struct metapopulation *in, int n, struct param *par)
 		exit(1);
 	}
 
-	gsl_ran_multinomial(par->rng, get_npop(in), n, nAvailPerPop, (unsigned int *) nIsolatesPerPop);
+	rng_multinomial(par->rng, get_npop(in), n, nAvailPerPop, (unsigned int *) nIsolatesPerPop);
+
+	/* select the isolates */
+	isolates = (struct pathogen **) malloc(n * sizeof(struct pathogen *));
+	if(isolates == NULL){
+		fprintf(stderr, "\n[in: population.c->draw_sample]\nNo memory left to isolate available pathogens. Exiting.\n");
+		exit(1);
+	}
 
-	/* fill in the sample pathogens */
 	count = 0;
 	for(j=0;j<get_npop(in);j++){ /* for each population */
 		for(i=0;i<nIsolatesPerPop[j];i++){
-			ppat = select_random_pathogen(get_populations(in)[j], par);
-			/* free_pathogen(out->pathogens[count]); */
-			out->pathogens[count] = reconstruct_genome(ppat);
+			isolates[count] = select_random_pathogen(get_populations(in)[j], par);
 			out->popid[count++] = j;
 		}
 	}
 
+	/* fill in the sample pathogens - shared ancestries are browsed once */
+	reconstruct_sample(isolates, out->pathogens, n, par);
+
 	/* free local pointers */
 	free(nAvailPerPop);
 	free(nIsolatesPerPop);
+	free(isolates);
 
 	return out;
 } /* end draw_sample */
@@ -212,6 +308,8 @@ struct sample * draw_sample(struct metapopulation *in, int n, struct param *par)
 
 
 /* merge several samples together */
+/* Genomes are MOVED to the output: input samples lose ownership of their */
+/* pathogens (set to NULL), and can still be freed safely afterwards. */
 struct sample * merge_samples(struct sample **in, int nsamp, struct param *par){
 	int i, j, newsize=0, counter=0;
 
@@ -223,7 +321,8 @@ struct sample * merge_samples(struct sample **in, int nsamp, struct param *par){
 	/* fill in output */
 	for(i=0;i<nsamp;i++){
 		for(j=0;j<get_n(in[i]);j++){
-			out->pathogens[counter] = copy_pathogen(in[i]->pathogens[j]);
+			out->pathogens[counter] = in[i]->pathogens[j];
+			in[i]->pathogens[j] = NULL;
 			out->popid[counter++] = in[i]->popid[j];
 		}
 	}
@@ -245,43 +344,132 @@ void translate_dates(struct param *par){
 
 
 
+/* Genotypes of a sample (CSR isolate x site matrix) */
+/* Sites are sorted and made unique once; each isolate then finds its sites */
+/* by binary search, so that the cost is O(nnz log nsites). Genomes of */
+/* samples are reconstructed, and list each site at most once. */
+struct genotypes * get_genotypes(struct sample *in, int *dates){
+	int i, j, k, nsnps, *snps, lo, hi;
+	struct genotypes *out = (struct genotypes *) calloc(1, sizeof(struct genotypes));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: sampling.c->get_genotypes]\nNo memory left for creating genotypes. Exiting.\n");
+		exit(1);
+	}
+
+	out->n = get_n(in);
+	out->nnz = 0;
+	for(i=0;i<out->n;i++) out->nnz += get_nb_snps(in->pathogens[i]);
+	out->popid = (int *) malloc((out->n > 0 ? out->n : 1) * sizeof(int));
+	out->date = (int *) calloc(out->n > 0 ? out->n : 1, sizeof(int));
+	out->rowptr = (int *) malloc((out->n + 1) * sizeof(int));
+	out->colidx = (int *) malloc((out->nnz > 0 ? out->nnz : 1) * sizeof(int));
+	out->sites = (int *) malloc((out->nnz > 0 ? out->nnz : 1) * sizeof(int));
+	if(out->popid == NULL || out->date == NULL || out->rowptr == NULL || out->colidx == NULL || out->sites == NULL){
+		fprintf(stderr, "\n[in: sampling.c->get_genotypes]\nNo memory left for creating genotypes. Exiting.\n");
+		exit(1);
+	}
+
+	/* segregating sites */
+	k = 0;
+	for(i=0;i<out->n;i++){
+		out->popid[i] = in->popid[i];
+		if(dates != NULL) out->date[i] = dates[i];
+		for(j=0;j<get_nb_snps(in->pathogens[i]);j++) out->sites[k++] = get_snps(in->pathogens[i])[j];
+	}
+	qsort(out->sites, out->nnz, sizeof(int), compare_int);
+	out->nsites = 0;
+	for(k=0;k<out->nnz;k++){
+		if(out->nsites == 0 || out->sites[k] != out->sites[out->nsites-1]) out->sites[out->nsites++] = out->sites[k];
+	}
+
+	/* rows */
+	out->rowptr[0] = 0;
+	for(i=0;i<out->n;i++){
+		nsnps = get_nb_snps(in->pathogens[i]);
+		snps = get_snps(in->pathogens[i]);
+		for(j=0;j<nsnps;j++){
+			for(lo=0, hi=out->nsites;lo<hi;){
+				if(out->sites[(lo+hi)/2] < snps[j]) lo = (lo+hi)/2 + 1; else hi = (lo+hi)/2;
+			}
+			out->colidx[out->rowptr[i] + j] = lo;
+		}
+		qsort(out->colidx + out->rowptr[i], nsnps, sizeof(int), compare_int);
+		out->rowptr[i+1] = out->rowptr[i] + nsnps;
+	}
+
+	return out;
+}
+
+
+
+
+
+/* time step of sampling of each isolate of a merged sample */
+/* The samples of a simulation are drawn at increasing time steps, so that */
+/* in[i] was drawn at the i-th smallest date. */
+int * get_sample_dates(struct sample **in, int nsamp, int *dates, int ndates){
+	int i, j, k, n=0, *sorted, *out;
+
+	if(nsamp > ndates){
+		fprintf(stderr, "\n[in: sampling.c->get_sample_dates]\nMore samples (%d) than sampling dates (%d). Exiting.\n", nsamp, ndates);
+		exit(1);
+	}
+	for(i=0;i<nsamp;i++) n += get_n(in[i]);
+	sorted = (int *) malloc((ndates > 0 ? ndates : 1) * sizeof(int));
+	out = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+	if(sorted == NULL || out == NULL){
+		fprintf(stderr, "\n[in: sampling.c->get_sample_dates]\nNo memory left for listing sampling dates. Exiting.\n");
+		exit(1);
+	}
+	for(i=0;i<ndates;i++) sorted[i] = dates[i];
+	qsort(sorted, ndates, sizeof(int), compare_int);
+
+	k = 0;
+	for(i=0;i<nsamp;i++){
+		for(j=0;j<get_n(in[i]);j++) out[k++] = sorted[i];
+	}
+
+	free(sorted);
+	return out;
+}
+
+
+
+
+
 /* SPLIT DATA OF A SAMPLE BY POPULATION */
-struct sample ** seppop(struct sample *in, struct param *par){
-	int i, j, counter, n=get_n(in), npop;
+/* Returns one view per population; isolates are not copied, so the views */
+/* are only valid as long as 'in' is. */
+struct sample_view ** seppop(struct sample *in, struct param *par){
+	int i, j, n=get_n(in), npop, *counter;
 	struct table_int * tabpop;
-	struct sample ** out;
+	struct sample_view ** out;
 
 	/* get table of population sizes */
 	tabpop = get_table_int(in->popid, n);
 	npop = tabpop->n;
 
 	/* allocate memory */
-	out = (struct sample **) calloc(npop, sizeof(struct sample *));
-	if(out==NULL){
+	out = (struct sample_view **) calloc(npop, sizeof(struct sample_view *));
+	counter = (int *) calloc(npop, sizeof(int));
+	if(out==NULL || counter==NULL){
 		fprintf(stderr, "\n[in: sampling.c->seppop]\nNo memory left to separate isolates per population. Exiting.\n");
 		exit(1);
 	}
 
 	for(i=0;i<npop;i++){
-		out[i] = create_sample(tabpop->times[i]);
-		if(out[i]==NULL){
-			fprintf(stderr, "\n[in: sampling.c->seppop]\nNo memory left to separate isolates per population. Exiting.\n");
-			exit(1);
-		}
+		out[i] = create_sample_view(in, tabpop->times[i]);
 	}
 
-	/* copy pathogens */
-	for(i=0;i<npop;i++){
-		counter=0;
-		for(j=0;j<n;j++){
-			if(in->popid[j]==tabpop->items[i]) {
-				out[i]->pathogens[counter] = copy_pathogen(in->pathogens[j]);
-				out[i]->popid[counter++] = in->popid[j];
-			}
-		}
+	/* fill in indices - single pass over the sample */
+	for(j=0;j<n;j++){
+		i = int_in_vec(in->popid[j], tabpop->items, npop);
+		out[i]->idx[counter[i]] = j;
+		out[i]->popid[counter[i]++] = in->popid[j];
 	}
 
 	/* free memory and return */
+	free(counter);
 	free_table_int(tabpop);
 	return out;
 }
@@ -298,7 +486,7 @@ struct sample ** seppop(struct sample *in, struct param *par){
 
 /* gcc line:
 
-   gcc -o sampling param.c auxiliary.c pathogens.c populations.c dispersal.c sampling.c -Wall -O0 -lgsl -lgslcblas
+   gcc -o sampling param.c auxiliary.c philox.c rng.c pathogens.c populations.c dispersal.c sampling.c -Wall -O0 -lgsl -lgslcblas
 
    valgrind --leak-check=yes sampling
 
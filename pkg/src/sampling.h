@@ -15,6 +15,31 @@ struct sample{
 
 
 
+/* A sample_view references isolates of a sample (the genome store) */
+/* through their indices; it never owns nor frees the pathogens. */
+/* - 'store' is the sample owning the genomes */
+/* - 'idx' gives the indices of the isolates in store->pathogens */
+/* - 'popid' gives the population of each isolate */
+struct sample_view{
+	struct sample *store;
+	int *idx, *popid, n;
+};
+
+
+
+/* Genotypes of a sample, as a sparse isolate x site matrix of 0/1 in */
+/* compressed sparse row (CSR) format */
+/* - 'sites' lists the 'nsites' segregating sites, in increasing order */
+/* - isolate i carries the sites sites[colidx[k]] for k in */
+/* rowptr[i]..rowptr[i+1]-1, in increasing order; 'nnz' is rowptr[n] */
+/* - 'popid' and 'date' give the population and the time step of sampling */
+/* of each isolate (date is 0 if unknown) */
+struct genotypes{
+	int *popid, *date, *rowptr, *colidx, *sites, n, nsites, nnz;
+};
+
+
+
 /*
    =================
    === ACCESSORS ===
@@ -25,6 +50,10 @@ int get_n(struct sample *in);
 
 int get_npop_samp(struct sample *in);
 
+int get_n_view(struct sample_view *in);
+
+struct pathogen * get_view_pathogen(struct sample_view *in, int i);
+
 
 /*
    ===================
@@ -34,6 +63,10 @@ int get_npop_samp(struct sample *in);
 
 struct sample * create_sample(int n);
 
+struct sample_view * create_sample_view(struct sample *store, int n);
+
+struct sample_view * view_sample(struct sample *in);
+
 
 
 /*
@@ -44,6 +77,10 @@ struct sample * create_sample(int n);
 
 void free_sample(struct sample *in);
 
+void free_sample_view(struct sample_view *in);
+
+void free_genotypes(struct genotypes *in);
+
 
 
 
@@ -67,7 +104,7 @@ void print_sample(struct sample *in, bool showGen);
 struct sample * draw_sample(struct metapopulation *in, int n, struct param *par);
 
 
-/* merge several samples together */
+/* merge several samples together - genomes are moved, not copied */
 struct sample *merge_samples(struct sample **in, int n, struct param *par);
 
 
@@ -75,5 +112,12 @@ struct sample *merge_samples(struct sample **in, int n, struct param *par);
 /* translate sampling dates into simulation timestep */
 void translate_dates(struct param *par);
 
-/* slit data of a sample by population */
-struct sample ** seppop(struct sample *in, struct param *par);
+/* genotypes of a sample as a CSR matrix; 'dates' may be NULL */
+struct genotypes * get_genotypes(struct sample *in, int *dates);
+
+/* time step of sampling of each isolate of merge_samples(in, nsamp); */
+/* 'dates' lists the 'ndates' sampling time steps, in any order */
+int * get_sample_dates(struct sample **in, int nsamp, int *dates, int ndates);
+
+/* split data of a sample by population - returns views on the sample */
+struct sample_view ** seppop(struct sample *in, struct param *par);
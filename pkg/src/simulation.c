@@ -0,0 +1,382 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions handle single simulation runs (replicates).
+*/
+
+#include "common.h"
+#include "auxiliary.h"
+#include "param.h"
+#include "pathogens.h"
+#include "populations.h"
+#include "sampling.h"
+#include "dispersal.h"
+#include "eventlog.h"
+#include "infection.h"
+#include "sumstat.h"
+#include "inout.h"
+#include "outstream.h"
+#include "philox.h"
+#include "rng.h"
+#include "simulation.h"
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+/* Create a new replicate */
+/* Parameters are copied, so that the template is left untouched. */
+/* Replicates created with the same seed share the generator key but use */
+/* disjoint substreams, so that results do not depend on the order in which */
+/* replicates are run. */
+struct simulation * create_simulation(struct param *par, struct network *cn, unsigned long seed, int rep){
+	int i;
+	struct simulation *out = (struct simulation *) malloc(sizeof(struct simulation));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: simulation.c->create_simulation]\nNo memory left for creating simulation. Exiting.\n");
+		exit(1);
+	}
+
+	/* private copy of parameters */
+	out->par = (struct param *) malloc(sizeof(struct param));
+	if(out->par == NULL){
+		fprintf(stderr, "\n[in: simulation.c->create_simulation]\nNo memory left for copying parameters. Exiting.\n");
+		exit(1);
+	}
+	*(out->par) = *par;
+	out->par->t_sample = (int *) malloc((par->n_sample > 0 ? par->n_sample : 1) * sizeof(int));
+	if(out->par->t_sample == NULL){
+		fprintf(stderr, "\n[in: simulation.c->create_simulation]\nNo memory left for copying parameters. Exiting.\n");
+		exit(1);
+	}
+	for(i=0;i<par->n_sample;i++) out->par->t_sample[i] = par->t_sample[i];
+	out->par->rng = create_rng(seed);
+
+	/* content */
+	out->cn = cn;
+	out->metapop = create_metapopulation(out->par);
+	out->grpsizes = create_ts_groupsizes(out->par);
+	translate_dates(out->par);
+	out->tabdates = get_table_int(out->par->t_sample, out->par->n_sample);
+	out->samplist = (struct sample **) malloc((out->tabdates->n > 0 ? out->tabdates->n : 1) * sizeof(struct sample *));
+	if(out->samplist == NULL){
+		fprintf(stderr, "\n[in: simulation.c->create_simulation]\nNo memory left for storing samples. Exiting.\n");
+		exit(1);
+	}
+	out->rep = rep;
+	out->nstep = 0;
+	out->nsamp = 0;
+	out->base = NULL;
+	out->nforks = 0;
+	out->popdyn = NULL;
+	out->events = NULL;
+
+	return out;
+}
+
+
+
+/* Copy a pathogen of 'in' into a fork */
+/* Ancestors which are live pathogens of 'in' are replaced by their copy, */
+/* found through 'map' in 'copies'. */
+static struct pathogen * fork_pathogen(struct pathogen *in, struct hash_ptr *map, struct pathogen **copies){
+	int idx;
+	struct pathogen *out = copy_pathogen(in);
+	if(get_ances(out) != NULL && (idx = hash_ptr_get(map, get_ances(out))) > -1) out->ances = copies[idx];
+	return out;
+}
+
+
+
+/* Fork a replicate */
+/* Recovered pathogens (the first nrec of each population) are never */
+/* modified again, so that they are shared; live pathogens, whose age */
+/* changes, are copied. Since pathogens recover in the order of infection, */
+/* the ancestors of shared pathogens are shared as well. */
+struct simulation * fork_simulation(struct simulation *in, struct param *par, struct network *cn, int rep){
+	int i, j, k, nlive=0;
+	struct population *pop, *inpop;
+	struct pathogen **copies;
+	struct hash_ptr *map;
+	struct sample *samp;
+	struct simulation *out;
+
+	if(par == NULL) par = in->par;
+	if(cn == NULL) cn = in->cn;
+	if(par->npop != in->par->npop || par->duration != in->par->duration || par->L != in->par->L || par->t1 != in->par->t1 || par->t2 != in->par->t2){
+		fprintf(stderr, "\n[in: simulation.c->fork_simulation]\nParameters of the fork do not match the simulation (npop, duration, L, t1 or t2). Exiting.\n");
+		exit(1);
+	}
+	for(i=0;i<par->npop;i++){
+		if(par->popsizes[i] != in->par->popsizes[i]){
+			fprintf(stderr, "\n[in: simulation.c->fork_simulation]\nPopulation sizes of the fork do not match the simulation. Exiting.\n");
+			exit(1);
+		}
+	}
+
+	out = (struct simulation *) malloc(sizeof(struct simulation));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: simulation.c->fork_simulation]\nNo memory left for creating simulation. Exiting.\n");
+		exit(1);
+	}
+
+	/* private copy of parameters, with the sampling dates and generator of 'in' */
+	out->par = (struct param *) malloc(sizeof(struct param));
+	if(out->par == NULL){
+		fprintf(stderr, "\n[in: simulation.c->fork_simulation]\nNo memory left for copying parameters. Exiting.\n");
+		exit(1);
+	}
+	*(out->par) = *par;
+	out->par->n_sample = in->par->n_sample;
+	out->par->t_sample = (int *) malloc((in->par->n_sample > 0 ? in->par->n_sample : 1) * sizeof(int));
+	if(out->par->t_sample == NULL){
+		fprintf(stderr, "\n[in: simulation.c->fork_simulation]\nNo memory left for copying parameters. Exiting.\n");
+		exit(1);
+	}
+	for(i=0;i<in->par->n_sample;i++) out->par->t_sample[i] = in->par->t_sample[i];
+	out->par->rng = gsl_rng_clone(in->par->rng);
+
+	/* metapopulation: share recovered pathogens, copy live ones */
+	for(i=0;i<get_npop(in->metapop);i++){
+		inpop = get_populations(in->metapop)[i];
+		nlive += get_nexpcum(inpop) - get_nrec(inpop);
+	}
+	copies = (struct pathogen **) malloc((nlive > 0 ? nlive : 1) * sizeof(struct pathogen *));
+	out->metapop = (struct metapopulation *) malloc(sizeof(struct metapopulation));
+	if(copies == NULL || out->metapop == NULL){
+		fprintf(stderr, "\n[in: simulation.c->fork_simulation]\nNo memory left for creating metapopulation. Exiting.\n");
+		exit(1);
+	}
+	out->metapop->npop = get_npop(in->metapop);
+	out->metapop->popsizes = out->par->popsizes;
+	out->metapop->populations = (struct population **) malloc(out->metapop->npop * sizeof(struct population *));
+	if(out->metapop->populations == NULL){
+		fprintf(stderr, "\n[in: simulation.c->fork_simulation]\nNo memory left for creating populations array in the metapopulation. Exiting.\n");
+		exit(1);
+	}
+	map = create_hash_ptr(nlive);
+	k = 0;
+	for(i=0;i<out->metapop->npop;i++){
+		inpop = get_populations(in->metapop)[i];
+		pop = out->metapop->populations[i] = create_population(inpop->popsize, 0, get_popid(inpop));
+		pop->nsus = get_nsus(inpop);
+		pop->nexp = get_nexp(inpop);
+		pop->ninf = get_ninf(inpop);
+		pop->nrec = get_nrec(inpop);
+		pop->nexpcum = get_nexpcum(inpop);
+		pop->nshared = get_nrec(inpop);
+		for(j=0;j<pop->nshared;j++) pop->pathogens[j] = inpop->pathogens[j];
+		for(j=pop->nshared;j<pop->nexpcum;j++){
+			hash_ptr_set(map, inpop->pathogens[j], k);
+			pop->pathogens[j] = copies[k++] = copy_pathogen(inpop->pathogens[j]);
+		}
+	}
+	for(k=0;k<nlive;k++){
+		if(get_ances(copies[k]) != NULL && (j = hash_ptr_get(map, get_ances(copies[k]))) > -1) copies[k]->ances = copies[j];
+	}
+
+	/* group sizes */
+	out->grpsizes = create_ts_groupsizes(out->par);
+	for(i=0;i<in->nstep;i++){
+		out->grpsizes->nsus[i] = in->grpsizes->nsus[i];
+		out->grpsizes->nexp[i] = in->grpsizes->nexp[i];
+		out->grpsizes->ninf[i] = in->grpsizes->ninf[i];
+		out->grpsizes->nrec[i] = in->grpsizes->nrec[i];
+		out->grpsizes->nexpcum[i] = in->grpsizes->nexpcum[i];
+	}
+
+	/* samples drawn so far */
+	out->tabdates = get_table_int(out->par->t_sample, out->par->n_sample);
+	out->samplist = (struct sample **) malloc((out->tabdates->n > 0 ? out->tabdates->n : 1) * sizeof(struct sample *));
+	if(out->samplist == NULL){
+		fprintf(stderr, "\n[in: simulation.c->fork_simulation]\nNo memory left for storing samples. Exiting.\n");
+		exit(1);
+	}
+	for(i=0;i<in->nsamp;i++){
+		samp = in->samplist[i];
+		out->samplist[i] = create_sample(get_n(samp) > 0 ? get_n(samp) : 1);
+		if(get_n(samp) == 0){ /* empty sample, as in draw_sample */
+			out->samplist[i]->n = 0;
+			free(out->samplist[i]->pathogens);
+			free(out->samplist[i]->popid);
+			out->samplist[i]->pathogens = NULL;
+			out->samplist[i]->popid = NULL;
+		}
+		for(j=0;j<get_n(samp);j++){
+			out->samplist[i]->popid[j] = samp->popid[j];
+			if(samp->pathogens[j] != NULL) out->samplist[i]->pathogens[j] = fork_pathogen(samp->pathogens[j], map, copies);
+		}
+	}
+
+	out->cn = cn;
+	out->rep = rep < 0 ? in->rep : rep;
+	out->nstep = in->nstep;
+	out->nsamp = in->nsamp;
+	out->base = in;
+	out->nforks = 0;
+	out->popdyn = NULL;
+	out->events = NULL;
+#ifdef _OPENMP
+	#pragma omp atomic
+#endif
+	in->nforks++;
+
+	free_hash_ptr(map);
+	free(copies);
+	return out;
+}
+
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_simulation(struct simulation *in){
+	int i;
+	if(in != NULL){
+		if(in->nforks > 0){
+			fprintf(stderr, "\n[in: simulation.c->free_simulation]\nSimulation freed before its %d forks. Exiting.\n", in->nforks);
+			exit(1);
+		}
+		if(in->base != NULL){
+#ifdef _OPENMP
+			#pragma omp atomic
+#endif
+			in->base->nforks--;
+		}
+		for(i=0;i<in->nsamp;i++) free_sample(in->samplist[i]);
+		free(in->samplist);
+		free_table_int(in->tabdates);
+		free_ts_groupsizes(in->grpsizes);
+		free_metapopulation(in->metapop);
+		free(in->par->t_sample);
+		free_param(in->par);
+		free(in);
+	}
+}
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+bool is_finished(struct simulation *in){
+	return get_total_nsus(in->metapop) < 1 || (get_total_ninf(in->metapop)+get_total_nexp(in->metapop)) < 1 || in->nstep >= in->par->duration;
+}
+
+
+
+/* Push the group sizes of each population to 'in->popdyn' */
+static void push_popdyn(struct simulation *in){
+	int j, npop = get_npop(in->metapop), *rec;
+	struct population *pop;
+
+	rec = (int *) malloc(npop * 7 * sizeof(int));
+	if(rec == NULL){
+		fprintf(stderr, "\n[in: simulation.c->push_popdyn]\nNo memory left for group sizes. Exiting.\n");
+		exit(1);
+	}
+	for(j=0;j<npop;j++){
+		pop = get_populations(in->metapop)[j];
+		rec[7*j] = in->nstep;
+		rec[7*j+1] = get_popid(pop);
+		rec[7*j+2] = get_nsus(pop);
+		rec[7*j+3] = get_nexp(pop);
+		rec[7*j+4] = get_ninf(pop);
+		rec[7*j+5] = get_nrec(pop);
+		rec[7*j+6] = get_nexpcum(pop);
+	}
+	push_outstream(in->popdyn, rec, npop);
+	free(rec);
+}
+
+
+
+/* Record the hosts infected at the start, which have no infector */
+static void add_index_cases(struct simulation *in){
+	int i, j;
+	struct population *pop;
+
+	in->events->step = 0;
+	for(j=0;j<get_npop(in->metapop);j++){
+		pop = get_populations(in->metapop)[j];
+		for(i=0;i<get_nexpcum(pop);i++) add_infection_event(in->events, -1, -1, get_popid(pop), i);
+	}
+}
+
+
+
+
+/*
+   ===============================
+   === MAIN EXTERNAL FUNCTIONS ===
+   ===============================
+*/
+
+/* Perform one time step of the discrete-time model */
+bool step_simulation(struct simulation *in){
+	int j, tabidx;
+
+	if(is_finished(in)) return FALSE;
+
+	if(in->events != NULL && in->nstep == 0) add_index_cases(in);
+	in->nstep++;
+	if(in->events != NULL) in->events->step = in->nstep;
+
+	/* age metapopulation */
+	age_metapopulation(in->metapop, in->par);
+
+	/* process infections - one substream per population */
+	for(j=0;j<get_npop(in->metapop);j++){
+		rng_set_stream(in->par->rng, in->rep, in->nstep, j, RNG_INFECTION);
+		process_infections(get_populations(in->metapop)[j], in->metapop, in->cn, in->par, in->events);
+	}
+
+	/* draw samples */
+	if((tabidx = int_in_vec(in->nstep, in->tabdates->items, in->tabdates->n)) > -1){
+		rng_set_stream(in->par->rng, in->rep, in->nstep, 0, RNG_SAMPLING);
+		in->samplist[in->nsamp++] = draw_sample(in->metapop, in->tabdates->times[tabidx], in->par);
+	}
+
+	fill_ts_groupsizes(in->grpsizes, in->metapop, in->nstep);
+	if(in->popdyn != NULL) push_popdyn(in);
+
+	return TRUE;
+}
+
+
+
+void run_simulation(struct simulation *in){
+	while(step_simulation(in));
+}
+
+
+
+/* Merge samples drawn so far */
+/* Genomes are moved out of the simulation, which keeps empty samples. */
+struct sample * get_simulation_sample(struct simulation *in){
+	if(in->nstep < in->par->duration) return NULL;
+	return merge_samples(in->samplist, in->nsamp, in->par);
+}
+
+
+
+/* Time step of sampling of each isolate of get_simulation_sample */
+int * get_simulation_dates(struct simulation *in){
+	return get_sample_dates(in->samplist, in->nsamp, in->tabdates->items, in->tabdates->n);
+}
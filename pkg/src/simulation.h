@@ -0,0 +1,109 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions handle single simulation runs (replicates).
+*/
+
+
+/*
+   ==================
+   === STRUCTURES ===
+   ==================
+*/
+
+/* A simulation holds everything needed to run one replicate of the */
+/* discrete-time model, so that several replicates can run concurrently. */
+/* - 'par' is a private copy of the parameters, with its own rng and t_sample */
+/* - 'rep' is the index of the replicate, used to address random substreams */
+/* - 'cn' is the dispersal network, shared between replicates (read-only) */
+/* - 'samplist' stores the samples drawn so far, 'nsamp' their number */
+/* - 'nstep' is the number of time steps performed */
+/* - 'base' is the simulation this one was forked from (NULL if none), */
+/* 'nforks' the number of forks of this one which have not been freed */
+/* - 'popdyn' receives the group sizes of each population at each step */
+/* (COLFILE_POPDYN records, see outstream.h), if not NULL; it is opened and */
+/* closed by the caller, and is not inherited by forks */
+/* - 'events' records the transmissions (see eventlog.h), if not NULL; as */
+/* 'popdyn', it is handled by the caller and not inherited by forks */
+struct simulation{
+	struct param *par;
+	struct network *cn;
+	struct metapopulation *metapop;
+	struct ts_groupsizes *grpsizes;
+	struct table_int *tabdates;
+	struct sample **samplist;
+	struct simulation *base;
+	struct outstream *popdyn;
+	struct eventbuf *events;
+	int rep, nstep, nsamp, nforks;
+};
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+/* create replicate 'rep' from template parameters; random numbers are drawn */
+/* from the substreams (rep, step, population, purpose) of a generator keyed by 'seed' */
+struct simulation * create_simulation(struct param *par, struct network *cn, unsigned long seed, int rep);
+
+/* branch 'in' at its current step */
+/* - 'par' and 'cn' give the parameters and network of the fork (NULL to */
+/* keep those of 'in'); populations, their sizes, L, duration and the */
+/* infectious period (t1, t2, which the ages of live pathogens depend on) */
+/* must be the same, and sampling dates are those of 'in' */
+/* - the fork draws from the substreams of replicate 'rep' (-1 to keep that */
+/* of 'in', so that forks differing by their parameters use common random */
+/* numbers) */
+/* Recovered pathogens, and thus the ancestry up to the current step, are */
+/* shared with 'in', which must be freed after its forks; 'in' and its */
+/* forks can then be run in parallel. Forks are created sequentially. */
+struct simulation * fork_simulation(struct simulation *in, struct param *par, struct network *cn, int rep);
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+/* note: does not free the network; a simulation cannot be freed before its forks */
+void free_simulation(struct simulation *in);
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+/* TRUE if the epidemic cannot go on */
+bool is_finished(struct simulation *in);
+
+
+
+/*
+   ==========================
+   === EXTERNAL FUNCTIONS ===
+   ==========================
+*/
+
+/* perform one time step; returns FALSE if the epidemic was already over */
+bool step_simulation(struct simulation *in);
+
+/* run until the end of the epidemic */
+void run_simulation(struct simulation *in);
+
+/* merge the samples drawn so far; NULL if the epidemic ended before 'duration' */
+struct sample * get_simulation_sample(struct simulation *in);
+
+/* time step of sampling of each isolate of get_simulation_sample */
+int * get_simulation_dates(struct simulation *in);
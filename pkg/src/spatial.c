@@ -0,0 +1,755 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions build connection networks from the coordinates of
+  populations.
+*/
+
+#include "common.h"
+#include "spatial.h"
+
+/* average number of points per cell of the grid index */
+#define SPATIAL_CELL_POINTS 2.0
+
+/* points are inserted in the triangulation along a Hilbert curve of */
+/* 2^SPATIAL_HILBERT_ORDER x 2^SPATIAL_HILBERT_ORDER cells */
+#define SPATIAL_HILBERT_ORDER 16
+
+/* distance of the vertices of the enclosing triangle from the centre of */
+/* the points, in extents of the points */
+#define SPATIAL_SUPER_SCALE 1e7
+
+
+
+
+/*
+   ==================
+   === STRUCTURES ===
+   ==================
+*/
+
+/* Grid index: square cells of side 'size' from (x0, y0) */
+/* The points of cell (i,j) are pts[first[c]] ... pts[first[c+1]-1], */
+/* with c = j*nx + i. */
+struct grid{
+	int nx, ny, *first, *pts;
+	double x0, y0, size;
+};
+
+
+/* point and its position on the Hilbert curve */
+struct hilbert_point{
+	unsigned long long key;
+	int i;
+};
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+static void check_points(double *x, double *y, int n, const char *fn){
+	int i;
+	for(i=0;i<n;i++){
+		if(!isfinite(x[i]) || !isfinite(y[i])){
+			fprintf(stderr, "\n[in: spatial.c->%s]\nCoordinates of point %d are not finite. Exiting.\n", fn, i+1);
+			exit(1);
+		}
+	}
+}
+
+
+
+static int get_cell_x(struct grid *g, double x){
+	int i = (int) ((x - g->x0) / g->size);
+	return i < 0 ? 0 : (i >= g->nx ? g->nx-1 : i);
+}
+
+
+
+static int get_cell_y(struct grid *g, double y){
+	int j = (int) ((y - g->y0) / g->size);
+	return j < 0 ? 0 : (j >= g->ny ? g->ny-1 : j);
+}
+
+
+
+/* Grid of about SPATIAL_CELL_POINTS points per cell, with cells of at */
+/* least 'minsize'; points are sorted by cell by counting sort. */
+static struct grid * create_grid(double *x, double *y, int n, double minsize){
+	int i, c, *cell;
+	double xmax, ymax, w, h, side;
+	struct grid *out = (struct grid *) malloc(sizeof(struct grid));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: spatial.c->create_grid]\nNo memory left for creating grid. Exiting.\n");
+		exit(1);
+	}
+
+	/* extent and size of cells */
+	out->x0 = xmax = x[0];
+	out->y0 = ymax = y[0];
+	for(i=1;i<n;i++){
+		if(x[i] < out->x0) out->x0 = x[i];
+		if(x[i] > xmax) xmax = x[i];
+		if(y[i] < out->y0) out->y0 = y[i];
+		if(y[i] > ymax) ymax = y[i];
+	}
+	w = xmax - out->x0;
+	h = ymax - out->y0;
+	side = w > h ? w : h;
+	out->size = sqrt(w * h * SPATIAL_CELL_POINTS / n);
+	if(out->size < side * SPATIAL_CELL_POINTS / n) out->size = side * SPATIAL_CELL_POINTS / n;
+	if(out->size < minsize) out->size = minsize;
+	if(out->size <= 0.0) out->size = 1.0;
+	out->nx = (int) (w / out->size) + 1;
+	out->ny = (int) (h / out->size) + 1;
+
+	/* points of each cell */
+	out->first = (int *) calloc(out->nx * out->ny + 1, sizeof(int));
+	out->pts = (int *) malloc(n * sizeof(int));
+	cell = (int *) malloc(n * sizeof(int));
+	if(out->first == NULL || out->pts == NULL || cell == NULL){
+		fprintf(stderr, "\n[in: spatial.c->create_grid]\nNo memory left for creating grid. Exiting.\n");
+		exit(1);
+	}
+	for(i=0;i<n;i++){
+		cell[i] = get_cell_y(out, y[i]) * out->nx + get_cell_x(out, x[i]);
+		out->first[cell[i]+1]++;
+	}
+	for(c=0;c<out->nx*out->ny;c++) out->first[c+1] += out->first[c];
+	for(i=0;i<n;i++) out->pts[out->first[cell[i]]++] = i;
+	for(c=out->nx*out->ny;c>0;c--) out->first[c] = out->first[c-1];
+	out->first[0] = 0;
+
+	free(cell);
+	return out;
+}
+
+
+
+static void free_grid(struct grid *in){
+	free(in->first);
+	free(in->pts);
+	free(in);
+}
+
+
+
+/* Graph from the edges from[e] -> to[e], also stored as to[e] -> from[e] */
+/* if 'both' is TRUE. Rows are sorted by two counting sorts (by neighbour, */
+/* then stably by point), and self or duplicated edges removed. */
+static struct spatialgraph * create_spatialgraph(int n, int *from, int *to, double *dist, int nedges, bool both){
+	int e, i, j, a, b, p, start, m, *cursor, *tmpfrom, *tmpnb;
+	double *tmpdist;
+	struct spatialgraph *out;
+
+	if(both && nedges > 1073741823){
+		fprintf(stderr, "\n[in: spatial.c->create_spatialgraph]\nToo many connections (%d). Exiting.\n", nedges);
+		exit(1);
+	}
+	m = both ? 2*nedges : nedges;
+
+	out = (struct spatialgraph *) malloc(sizeof(struct spatialgraph));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: spatial.c->create_spatialgraph]\nNo memory left for creating graph. Exiting.\n");
+		exit(1);
+	}
+	out->n = n;
+	out->offsets = (int *) calloc(n+1, sizeof(int));
+	out->nb = (int *) malloc((m > 0 ? m : 1) * sizeof(int));
+	out->dist = (double *) malloc((m > 0 ? m : 1) * sizeof(double));
+	cursor = (int *) calloc(n+1, sizeof(int));
+	tmpfrom = (int *) malloc((m > 0 ? m : 1) * sizeof(int));
+	tmpnb = (int *) malloc((m > 0 ? m : 1) * sizeof(int));
+	tmpdist = (double *) malloc((m > 0 ? m : 1) * sizeof(double));
+	if(out->offsets == NULL || out->nb == NULL || out->dist == NULL || cursor == NULL || tmpfrom == NULL || tmpnb == NULL || tmpdist == NULL){
+		fprintf(stderr, "\n[in: spatial.c->create_spatialgraph]\nNo memory left for creating graph. Exiting.\n");
+		exit(1);
+	}
+
+	/* FIRST PASS: BY NEIGHBOUR */
+	/* edge e >= nedges is the reverse of edge e-nedges */
+	for(e=0;e<m;e++){
+		b = e < nedges ? to[e] : from[e-nedges];
+		cursor[b+1]++;
+	}
+	for(i=0;i<n;i++) cursor[i+1] += cursor[i];
+	for(e=0;e<m;e++){
+		a = e < nedges ? from[e] : to[e-nedges];
+		b = e < nedges ? to[e] : from[e-nedges];
+		p = cursor[b]++;
+		tmpfrom[p] = a;
+		tmpnb[p] = b;
+		tmpdist[p] = dist[e < nedges ? e : e-nedges];
+	}
+
+	/* SECOND PASS: BY POINT, KEEPING THE ORDER OF NEIGHBOURS */
+	for(e=0;e<m;e++) out->offsets[tmpfrom[e]+1]++;
+	for(i=0;i<n;i++){
+		out->offsets[i+1] += out->offsets[i];
+		cursor[i] = out->offsets[i];
+	}
+	for(e=0;e<m;e++){
+		p = cursor[tmpfrom[e]]++;
+		out->nb[p] = tmpnb[e];
+		out->dist[p] = tmpdist[e];
+	}
+
+	/* REMOVE SELF AND DUPLICATED EDGES */
+	p = 0;
+	for(i=0;i<n;i++){
+		start = out->offsets[i];
+		out->offsets[i] = p;
+		for(j=start;j<out->offsets[i+1];j++){
+			if(out->nb[j] == i || (p > out->offsets[i] && out->nb[p-1] == out->nb[j])) continue;
+			out->nb[p] = out->nb[j];
+			out->dist[p++] = out->dist[j];
+		}
+	}
+	out->offsets[n] = out->nedges = p;
+
+	free(cursor);
+	free(tmpfrom);
+	free(tmpnb);
+	free(tmpdist);
+
+	return out;
+}
+
+
+
+/* Store an edge in growing arrays of 'max' edges */
+static void add_edge(int **from, int **to, double **dist, int *nedges, int *max, int a, int b, double d){
+	if(*nedges == *max){
+		if(*max > 1073741823){
+			fprintf(stderr, "\n[in: spatial.c->add_edge]\nToo many connections. Exiting.\n");
+			exit(1);
+		}
+		*max *= 2;
+		*from = (int *) realloc(*from, *max * sizeof(int));
+		*to = (int *) realloc(*to, *max * sizeof(int));
+		*dist = (double *) realloc(*dist, *max * sizeof(double));
+		if(*from == NULL || *to == NULL || *dist == NULL){
+			fprintf(stderr, "\n[in: spatial.c->add_edge]\nNo memory left for storing connections. Exiting.\n");
+			exit(1);
+		}
+	}
+	(*from)[*nedges] = a;
+	(*to)[*nedges] = b;
+	(*dist)[(*nedges)++] = d;
+}
+
+
+
+/* TRUE if neighbour (da, a) is further than (db, b), ties broken by index */
+static bool is_further(double da, int a, double db, int b){
+	return da > db || (da == db && a > b);
+}
+
+
+
+/* Nearest neighbours of point i in a grid */
+/* The k best candidates are kept in a max-heap (nb, d2 of squared */
+/* distances); cells are visited by rings of growing size around the */
+/* cell of i, until the k-th neighbour is closer than any cell not */
+/* visited. Neighbours are returned in no particular order. */
+static void find_knn(struct grid *g, double *x, double *y, int i, int k, int *nb, double *d2){
+	int r, cx, cy, ix, iy, step, c, l, j, m = 0, pos, child;
+	double d, border, t;
+
+	cx = get_cell_x(g, x[i]);
+	cy = get_cell_y(g, y[i]);
+	for(r=0;;r++){
+		for(iy=cy-r;iy<=cy+r;iy++){
+			if(iy < 0 || iy >= g->ny) continue;
+			step = (iy == cy-r || iy == cy+r) ? 1 : 2*r;
+			for(ix=cx-r;ix<=cx+r;ix+=step){
+				if(ix < 0 || ix >= g->nx) continue;
+				c = iy * g->nx + ix;
+				for(l=g->first[c];l<g->first[c+1];l++){
+					j = g->pts[l];
+					if(j == i) continue;
+					d = (x[j]-x[i])*(x[j]-x[i]) + (y[j]-y[i])*(y[j]-y[i]);
+					if(m < k){ /* add and sift up */
+						pos = m++;
+						while(pos > 0 && is_further(d, j, d2[(pos-1)/2], nb[(pos-1)/2])){
+							nb[pos] = nb[(pos-1)/2];
+							d2[pos] = d2[(pos-1)/2];
+							pos = (pos-1)/2;
+						}
+					} else if(is_further(d2[0], nb[0], d, j)){ /* replace top and sift down */
+						pos = 0;
+						while((child = 2*pos+1) < k){
+							if(child+1 < k && is_further(d2[child+1], nb[child+1], d2[child], nb[child])) child++;
+							if(!is_further(d2[child], nb[child], d, j)) break;
+							nb[pos] = nb[child];
+							d2[pos] = d2[child];
+							pos = child;
+						}
+					} else continue;
+					nb[pos] = j;
+					d2[pos] = d;
+				}
+			}
+		}
+
+		/* whole grid visited */
+		if(cx-r <= 0 && cy-r <= 0 && cx+r >= g->nx-1 && cy+r >= g->ny-1) break;
+
+		/* distance to the cells not visited */
+		if(m == k){
+			border = x[i] - (g->x0 + (cx-r) * g->size);
+			if((t = g->x0 + (cx+r+1) * g->size - x[i]) < border) border = t;
+			if((t = y[i] - (g->y0 + (cy-r) * g->size)) < border) border = t;
+			if((t = g->y0 + (cy+r+1) * g->size - y[i]) < border) border = t;
+			if(d2[0] < border * border) break;
+		}
+	}
+}
+
+
+
+/* Orientation of c relative to a->b: > 0 if a, b, c turn counterclockwise */
+static double orient(double *x, double *y, int a, int b, int c){
+	return (x[b]-x[a]) * (y[c]-y[a]) - (y[b]-y[a]) * (x[c]-x[a]);
+}
+
+
+
+/* > 0 if d is inside the circumcircle of the counterclockwise triangle a, b, c */
+static double incircle(double *x, double *y, int a, int b, int c, int d){
+	double adx = x[a]-x[d], ady = y[a]-y[d], bdx = x[b]-x[d], bdy = y[b]-y[d], cdx = x[c]-x[d], cdy = y[c]-y[d];
+	return (adx*adx + ady*ady) * (bdx*cdy - cdx*bdy)
+		+ (bdx*bdx + bdy*bdy) * (cdx*ady - adx*cdy)
+		+ (cdx*cdx + cdy*cdy) * (adx*bdy - bdx*ady);
+}
+
+
+
+/* Position of cell (hx, hy) on the Hilbert curve */
+static unsigned long long get_hilbert_key(unsigned int hx, unsigned int hy){
+	unsigned int s, rx, ry, t, side = 1u << SPATIAL_HILBERT_ORDER;
+	unsigned long long out = 0;
+
+	for(s=side/2;s>0;s/=2){
+		rx = (hx & s) > 0;
+		ry = (hy & s) > 0;
+		out += (unsigned long long) s * s * ((3 * rx) ^ ry);
+		if(ry == 0){ /* rotate quadrant */
+			if(rx == 1){
+				hx = side-1 - hx;
+				hy = side-1 - hy;
+			}
+			t = hx;
+			hx = hy;
+			hy = t;
+		}
+	}
+	return out;
+}
+
+
+
+static int compare_hilbert_point(const void *a, const void *b){
+	const struct hilbert_point *pa = (const struct hilbert_point *) a, *pb = (const struct hilbert_point *) b;
+	if(pa->key != pb->key) return pa->key < pb->key ? -1 : 1;
+	return pa->i - pb->i;
+}
+
+
+
+/* Grow the arrays of the cavity (cav) or of its boundary (the others) */
+static void grow_cavity(int **cav, int *maxcav, int **bnda, int **bndb, int **bndu, int **bndj, int *maxbound){
+	if(cav != NULL){
+		*maxcav *= 2;
+		*cav = (int *) realloc(*cav, *maxcav * sizeof(int));
+		if(*cav == NULL){
+			fprintf(stderr, "\n[in: spatial.c->grow_cavity]\nNo memory left for triangulation. Exiting.\n");
+			exit(1);
+		}
+		return;
+	}
+	*maxbound *= 2;
+	*bnda = (int *) realloc(*bnda, *maxbound * sizeof(int));
+	*bndb = (int *) realloc(*bndb, *maxbound * sizeof(int));
+	*bndu = (int *) realloc(*bndu, *maxbound * sizeof(int));
+	*bndj = (int *) realloc(*bndj, *maxbound * sizeof(int));
+	if(*bnda == NULL || *bndb == NULL || *bndu == NULL || *bndj == NULL){
+		fprintf(stderr, "\n[in: spatial.c->grow_cavity]\nNo memory left for triangulation. Exiting.\n");
+		exit(1);
+	}
+}
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+/* k nearest neighbours */
+/* Each query only visits the cells around its point, so that the graph */
+/* is built in O(n k) for points spread evenly. */
+struct spatialgraph * get_knn_graph(double *x, double *y, int n, int k, bool sym){
+	int i, j, *from, *to;
+	double *dist;
+	struct grid *g;
+	struct spatialgraph *out;
+
+	check_points(x, y, n, "get_knn_graph");
+	if(k < 1 || k >= n){
+		fprintf(stderr, "\n[in: spatial.c->get_knn_graph]\nThe number of neighbours (%d) must be between 1 and the number of points minus 1 (%d). Exiting.\n", k, n-1);
+		exit(1);
+	}
+	if((double) n * k > 1073741823.0){
+		fprintf(stderr, "\n[in: spatial.c->get_knn_graph]\nToo many connections (%d points x %d neighbours). Exiting.\n", n, k);
+		exit(1);
+	}
+
+	from = (int *) malloc(n * k * sizeof(int));
+	to = (int *) malloc(n * k * sizeof(int));
+	dist = (double *) malloc(n * k * sizeof(double));
+	if(from == NULL || to == NULL || dist == NULL){
+		fprintf(stderr, "\n[in: spatial.c->get_knn_graph]\nNo memory left for creating graph. Exiting.\n");
+		exit(1);
+	}
+
+	g = create_grid(x, y, n, 0.0);
+	for(i=0;i<n;i++){
+		find_knn(g, x, y, i, k, to + i*k, dist + i*k);
+		for(j=0;j<k;j++){
+			from[i*k+j] = i;
+			dist[i*k+j] = sqrt(dist[i*k+j]);
+		}
+	}
+
+	out = create_spatialgraph(n, from, to, dist, n*k, sym);
+
+	free_grid(g);
+	free(from);
+	free(to);
+	free(dist);
+
+	return out;
+}
+
+
+
+
+/* Neighbours by distance */
+/* Cells are at least d2 wide, so that neighbours are in the 3x3 cells */
+/* around each point; each pair is tested once. */
+struct spatialgraph * get_dist_graph(double *x, double *y, int n, double d1, double d2){
+	int i, j, l, c, ix, iy, cx, cy, nedges = 0, max = 1024, *from, *to;
+	double d, *dist;
+	struct grid *g;
+	struct spatialgraph *out;
+
+	check_points(x, y, n, "get_dist_graph");
+	if(!(d1 >= 0.0) || !(d2 >= d1) || !isfinite(d2)){
+		fprintf(stderr, "\n[in: spatial.c->get_dist_graph]\nDistances must satisfy 0 <= d1 <= d2 (d1=%f, d2=%f). Exiting.\n", d1, d2);
+		exit(1);
+	}
+
+	from = (int *) malloc(max * sizeof(int));
+	to = (int *) malloc(max * sizeof(int));
+	dist = (double *) malloc(max * sizeof(double));
+	if(from == NULL || to == NULL || dist == NULL){
+		fprintf(stderr, "\n[in: spatial.c->get_dist_graph]\nNo memory left for creating graph. Exiting.\n");
+		exit(1);
+	}
+
+	g = create_grid(x, y, n, d2);
+	for(i=0;i<n;i++){
+		cx = get_cell_x(g, x[i]);
+		cy = get_cell_y(g, y[i]);
+		for(iy=cy-1;iy<=cy+1;iy++){
+			if(iy < 0 || iy >= g->ny) continue;
+			for(ix=cx-1;ix<=cx+1;ix++){
+				if(ix < 0 || ix >= g->nx) continue;
+				c = iy * g->nx + ix;
+				for(l=g->first[c];l<g->first[c+1];l++){
+					j = g->pts[l];
+					if(j <= i) continue;
+					d = (x[j]-x[i])*(x[j]-x[i]) + (y[j]-y[i])*(y[j]-y[i]);
+					if(d >= d1*d1 && d <= d2*d2) add_edge(&from, &to, &dist, &nedges, &max, i, j, sqrt(d));
+				}
+			}
+		}
+	}
+
+	out = create_spatialgraph(n, from, to, dist, nedges, TRUE);
+
+	free_grid(g);
+	free(from);
+	free(to);
+	free(dist);
+
+	return out;
+}
+
+
+
+
+/* Delaunay triangulation */
+/* Bowyer-Watson algorithm: points are added one at a time to a */
+/* triangulation started from a triangle enclosing all points; the */
+/* triangles whose circumcircle contains the new point are removed, and */
+/* the hole is filled with triangles joining its edges to the point. */
+/* Points are inserted along a Hilbert curve, so that the triangle */
+/* containing a point is found by a short walk from the last triangles */
+/* created, and the whole triangulation takes O(n log n). */
+/* Triangle t has vertices v[3t], v[3t+1], v[3t+2] (counterclockwise), and */
+/* the triangle across the edge opposite v[3t+i] is adj[3t+i] (-1 if none). */
+/* Edges which only have circumcircles beyond SPATIAL_SUPER_SCALE extents */
+/* of the points (along an almost straight convex hull) may be missing. */
+struct spatialgraph * get_delaunay_graph(double *x, double *y, int n){
+	int i, l, s, p, t, u, a, b, T, ntri, maxtri, ncav, nbound, steps, start = 0, nedges, last;
+	int maxcav = 64, maxbound = 64, *v, *adj, *mark, *cav, *bnda, *bndb, *bndu, *bndj, *byfirst, *bysecond, *from, *to;
+	double xmin, xmax, ymin, ymax, cx, cy, side, *px, *py, *dist;
+	struct hilbert_point *order;
+	struct spatialgraph *out;
+
+	check_points(x, y, n, "get_delaunay_graph");
+	if(n < 2) return create_spatialgraph(n, NULL, NULL, NULL, 0, TRUE);
+
+	/* centred coordinates, and the enclosing triangle as points n..n+2 */
+	xmin = xmax = x[0];
+	ymin = ymax = y[0];
+	for(i=1;i<n;i++){
+		if(x[i] < xmin) xmin = x[i];
+		if(x[i] > xmax) xmax = x[i];
+		if(y[i] < ymin) ymin = y[i];
+		if(y[i] > ymax) ymax = y[i];
+	}
+	cx = (xmin + xmax) / 2.0;
+	cy = (ymin + ymax) / 2.0;
+	side = xmax - xmin > ymax - ymin ? xmax - xmin : ymax - ymin;
+	if(side <= 0.0) side = 1.0;
+
+	px = (double *) malloc((n+3) * sizeof(double));
+	py = (double *) malloc((n+3) * sizeof(double));
+	order = (struct hilbert_point *) malloc(n * sizeof(struct hilbert_point));
+	maxtri = 2*(n+3);
+	v = (int *) malloc(3 * maxtri * sizeof(int));
+	adj = (int *) malloc(3 * maxtri * sizeof(int));
+	mark = (int *) calloc(maxtri, sizeof(int));
+	byfirst = (int *) malloc((n+3) * sizeof(int));
+	bysecond = (int *) malloc((n+3) * sizeof(int));
+	cav = (int *) malloc(maxcav * sizeof(int));
+	bnda = (int *) malloc(maxbound * sizeof(int));
+	bndb = (int *) malloc(maxbound * sizeof(int));
+	bndu = (int *) malloc(maxbound * sizeof(int));
+	bndj = (int *) malloc(maxbound * sizeof(int));
+	if(px == NULL || py == NULL || order == NULL || v == NULL || adj == NULL || mark == NULL || byfirst == NULL || bysecond == NULL
+	   || cav == NULL || bnda == NULL || bndb == NULL || bndu == NULL || bndj == NULL){
+		fprintf(stderr, "\n[in: spatial.c->get_delaunay_graph]\nNo memory left for triangulation. Exiting.\n");
+		exit(1);
+	}
+
+	for(i=0;i<n;i++){
+		px[i] = x[i] - cx;
+		py[i] = y[i] - cy;
+		order[i].i = i;
+		order[i].key = get_hilbert_key((unsigned int) ((x[i] - xmin) / side * ((1u << SPATIAL_HILBERT_ORDER) - 1)),
+					       (unsigned int) ((y[i] - ymin) / side * ((1u << SPATIAL_HILBERT_ORDER) - 1)));
+	}
+	qsort(order, n, sizeof(struct hilbert_point), compare_hilbert_point);
+	px[n] = -SPATIAL_SUPER_SCALE * side;
+	py[n] = -SPATIAL_SUPER_SCALE * side;
+	px[n+1] = SPATIAL_SUPER_SCALE * side;
+	py[n+1] = -SPATIAL_SUPER_SCALE * side;
+	px[n+2] = 0.0;
+	py[n+2] = SPATIAL_SUPER_SCALE * side;
+	v[0] = n;
+	v[1] = n+1;
+	v[2] = n+2;
+	adj[0] = adj[1] = adj[2] = -1;
+	ntri = 1;
+	last = 0;
+
+	for(s=0;s<n;s++){
+		p = order[s].i;
+
+		/* FIND THE TRIANGLE CONTAINING P */
+		/* walk towards p across the first edge which separates it from */
+		/* the current triangle; the first edge tried changes at each step */
+		t = last;
+		for(steps=0;;steps++){
+			for(l=0;l<3;l++){
+				i = (l + start) % 3;
+				if(orient(px, py, v[3*t+(i+1)%3], v[3*t+(i+2)%3], p) < 0.0) break;
+			}
+			if(l == 3) break;
+			t = adj[3*t+i];
+			start = (start+1) % 3;
+			if(steps > ntri || t < 0){
+				fprintf(stderr, "\n[in: spatial.c->get_delaunay_graph]\nUnable to locate point %d (numerical precision). Exiting.\n", p+1);
+				exit(1);
+			}
+		}
+		for(l=0;l<3;l++){
+			if(v[3*t+l] < n && x[v[3*t+l]] == x[p] && y[v[3*t+l]] == y[p]){
+				fprintf(stderr, "\n[in: spatial.c->get_delaunay_graph]\nPoints %d and %d have the same coordinates. Exiting.\n", v[3*t+l]+1, p+1);
+				exit(1);
+			}
+		}
+
+		/* REMOVE TRIANGLES WHOSE CIRCUMCIRCLE CONTAINS P */
+		/* the cavity grows across its edges from the triangle containing */
+		/* p; a triangle is also removed if p does not see the edge it */
+		/* shares with the cavity, so that the cavity stays star-shaped */
+		ncav = nbound = 0;
+		cav[ncav++] = t;
+		mark[t] = s+1;
+		for(l=0;l<ncav;l++){
+			t = cav[l];
+			for(i=0;i<3;i++){
+				u = adj[3*t+i];
+				if(u >= 0 && mark[u] == s+1) continue;
+				a = v[3*t+(i+1)%3];
+				b = v[3*t+(i+2)%3];
+				if(u >= 0 && (incircle(px, py, v[3*u], v[3*u+1], v[3*u+2], p) > 0.0 || orient(px, py, a, b, p) <= 0.0)){
+					if(ncav == maxcav) grow_cavity(&cav, &maxcav, NULL, NULL, NULL, NULL, NULL);
+					cav[ncav++] = u;
+					mark[u] = s+1;
+					continue;
+				}
+
+				/* boundary edge a->b, facing u across adj[3u+j] */
+				if(nbound == maxbound) grow_cavity(NULL, NULL, &bnda, &bndb, &bndu, &bndj, &maxbound);
+				bnda[nbound] = a;
+				bndb[nbound] = b;
+				bndu[nbound] = u;
+				bndj[nbound] = -1;
+				if(u >= 0) for(bndj[nbound]=0;adj[3*u+bndj[nbound]]!=t;bndj[nbound]++);
+				nbound++;
+			}
+		}
+		if(nbound != ncav+2 || ntri + 2 > maxtri){
+			fprintf(stderr, "\n[in: spatial.c->get_delaunay_graph]\nInvalid triangulation when adding point %d (numerical precision). Exiting.\n", p+1);
+			exit(1);
+		}
+
+		/* JOIN THE EDGES OF THE CAVITY TO P */
+		/* new triangles take the places of removed ones, then two new places */
+		for(l=0;l<nbound;l++){
+			T = l < ncav ? cav[l] : ntri++;
+			v[3*T] = bnda[l];
+			v[3*T+1] = bndb[l];
+			v[3*T+2] = p;
+			adj[3*T+2] = bndu[l];
+			if(bndu[l] >= 0) adj[3*bndu[l]+bndj[l]] = T;
+			byfirst[bnda[l]] = T;
+			bysecond[bndb[l]] = T;
+			bndu[l] = T;
+		}
+		for(l=0;l<nbound;l++){
+			T = bndu[l];
+			adj[3*T] = byfirst[v[3*T+1]];
+			adj[3*T+1] = bysecond[v[3*T]];
+		}
+		last = bndu[0];
+	}
+
+	/* EDGES BETWEEN POINTS */
+	/* each edge a->b with a < b is found in one of its two triangles */
+	from = (int *) malloc(3 * ntri * sizeof(int));
+	to = (int *) malloc(3 * ntri * sizeof(int));
+	dist = (double *) malloc(3 * ntri * sizeof(double));
+	if(from == NULL || to == NULL || dist == NULL){
+		fprintf(stderr, "\n[in: spatial.c->get_delaunay_graph]\nNo memory left for triangulation. Exiting.\n");
+		exit(1);
+	}
+	nedges = 0;
+	for(t=0;t<ntri;t++){
+		for(i=0;i<3;i++){
+			a = v[3*t+i];
+			b = v[3*t+(i+1)%3];
+			if(a < b && b < n){
+				from[nedges] = a;
+				to[nedges] = b;
+				dist[nedges++] = sqrt((x[b]-x[a])*(x[b]-x[a]) + (y[b]-y[a])*(y[b]-y[a]));
+			}
+		}
+	}
+	out = create_spatialgraph(n, from, to, dist, nedges, TRUE);
+
+	/* free temporary allocation */
+	free(px);
+	free(py);
+	free(order);
+	free(v);
+	free(adj);
+	free(mark);
+	free(byfirst);
+	free(bysecond);
+	free(cav);
+	free(bnda);
+	free(bndb);
+	free(bndu);
+	free(bndj);
+	free(from);
+	free(to);
+	free(dist);
+
+	return out;
+}
+
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_spatialgraph(struct spatialgraph *in){
+	if(in == NULL) return;
+	free(in->offsets);
+	free(in->nb);
+	free(in->dist);
+	free(in);
+}
+
+
+
+
+/*
+   ===============================
+   === MAIN EXTERNAL FUNCTIONS ===
+   ===============================
+*/
+
+/* Arrays of connections expected by create_network */
+void get_spatial_cninfo(struct spatialgraph *in, double pdisp, double decay, int *nbnb, int *listnb, double *weights){
+	int i, j, nnb, c = 0;
+	double w, sum;
+
+	for(i=0;i<in->n;i++){
+		nnb = in->offsets[i+1] - in->offsets[i];
+		nbnb[i] = nnb + 1;
+		listnb[c] = i;
+		weights[c] = nnb > 0 ? 1.0 - pdisp : 1.0;
+
+		sum = 0.0;
+		for(j=0;j<nnb;j++){
+			w = in->dist[in->offsets[i]+j];
+			w = decay == 0.0 ? 1.0 : pow(w > NEARZERO ? w : NEARZERO, -decay);
+			listnb[c+1+j] = in->nb[in->offsets[i]+j];
+			weights[c+1+j] = w;
+			sum += w;
+		}
+		for(j=0;j<nnb;j++) weights[c+1+j] = pdisp * weights[c+1+j] / sum;
+		c += nnb + 1;
+	}
+}
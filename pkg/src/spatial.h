@@ -0,0 +1,76 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions build connection networks from the coordinates of
+  populations.
+*/
+
+
+
+/*
+   ==================
+   === STRUCTURES ===
+   ==================
+*/
+
+/* Graph between 'n' points, in compressed sparse row (CSR) format */
+/* - the neighbours of point i are nb[offsets[i]] ... nb[offsets[i+1]-1], */
+/* in increasing order, indexed from 0; a point is never its own neighbour */
+/* - 'dist' gives the distance to each neighbour */
+/* - 'nedges' is the number of (directed) edges stored; undirected graphs */
+/* store each edge in both directions */
+struct spatialgraph{
+	int n, nedges, *offsets, *nb;
+	double *dist;
+};
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+/* Points are given by their coordinates 'x' and 'y'. */
+
+/* k nearest neighbours of each point (ties broken by index); if 'sym' is */
+/* TRUE, i and j are neighbours if either is among the k nearest of the */
+/* other, as in knn2nb(..., sym=TRUE) of spdep */
+struct spatialgraph * get_knn_graph(double *x, double *y, int n, int k, bool sym);
+
+/* neighbours at a distance between 'd1' and 'd2' (both included), as */
+/* dnearneigh of spdep */
+struct spatialgraph * get_dist_graph(double *x, double *y, int n, double d1, double d2);
+
+/* Delaunay triangulation, as tri2nb of spdep; exits with a message if */
+/* two points have the same coordinates */
+struct spatialgraph * get_delaunay_graph(double *x, double *y, int n);
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_spatialgraph(struct spatialgraph *in);
+
+
+
+/*
+   ==========================
+   === EXTERNAL FUNCTIONS ===
+   ==========================
+*/
+
+/* Arrays of connections expected by create_network (see param.h) */
+/* Each point keeps 1-pdisp, and disperses 'pdisp' to its neighbours in */
+/* proportion to dist^-decay (equally if decay is 0); distances below */
+/* NEARZERO count as NEARZERO. 'nbnb' has n values, 'listnb' and */
+/* 'weights' n + nedges. Points without neighbours keep 1. */
+void get_spatial_cninfo(struct spatialgraph *in, double pdisp, double decay, int *nbnb, int *listnb, double *weights);
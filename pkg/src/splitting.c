@@ -0,0 +1,275 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions simulate epidemics conditioned on large outbreaks by
+  multilevel splitting.
+*/
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "common.h"
+#include "auxiliary.h"
+#include "param.h"
+#include "pathogens.h"
+#include "populations.h"
+#include "sampling.h"
+#include "dispersal.h"
+#include "sumstat.h"
+#include "philox.h"
+#include "rng.h"
+#include "simulation.h"
+#include "sweep.h"
+#include "splitting.h"
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+struct splitting * create_splitting(int *levels, int nlevels, int ntraj, int duration){
+	int i;
+	struct splitting *out = (struct splitting *) malloc(sizeof(struct splitting));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: splitting.c->create_splitting]\nNo memory left for creating splitting. Exiting.\n");
+		exit(1);
+	}
+
+	if(nlevels < 1){
+		fprintf(stderr, "\n[in: splitting.c->create_splitting]\nAt least one level is needed. Exiting.\n");
+		exit(1);
+	}
+	out->nlevels = nlevels;
+	out->ntraj = ntraj > 0 ? ntraj : 1;
+	out->duration = duration > 0 ? duration : 1;
+
+	out->levels = (int *) malloc(nlevels * sizeof(int));
+	out->nreached = (int *) calloc(nlevels, sizeof(int));
+	out->prob = (double *) calloc(nlevels, sizeof(double));
+	out->grpsizes = (int *) calloc(out->ntraj * out->duration * SWEEP_NGRP, sizeof(int));
+	out->nstep = (int *) calloc(out->ntraj, sizeof(int));
+	out->stats = (double *) malloc(out->ntraj * SUMSTAT_NSTAT * sizeof(double));
+	if(out->levels == NULL || out->nreached == NULL || out->prob == NULL || out->grpsizes == NULL || out->nstep == NULL || out->stats == NULL){
+		fprintf(stderr, "\n[in: splitting.c->create_splitting]\nNo memory left for storing trajectories. Exiting.\n");
+		exit(1);
+	}
+	for(i=0;i<nlevels;i++){
+		out->levels[i] = levels[i];
+		if(i > 0 && levels[i] <= levels[i-1]){
+			fprintf(stderr, "\n[in: splitting.c->create_splitting]\nLevels must be increasing. Exiting.\n");
+			exit(1);
+		}
+	}
+	for(i=0;i<out->ntraj*SUMSTAT_NSTAT;i++) out->stats[i] = NAN;
+	out->proba = 0.0;
+	out->nstepsim = 0.0;
+
+	return out;
+}
+
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_splitting(struct splitting *in){
+	if(in != NULL){
+		free(in->levels);
+		free(in->nreached);
+		free(in->prob);
+		free(in->grpsizes);
+		free(in->nstep);
+		free(in->stats);
+		free(in);
+	}
+}
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+void print_splitting(struct splitting *in){
+	int k;
+	printf("\n-- multilevel splitting: %d trajectories per stage --", in->ntraj);
+	for(k=0;k<in->nlevels;k++) printf("\nlevel %d (%d cases): reached by %d trajectories (p=%g)", k+1, in->levels[k], in->nreached[k], in->prob[k]);
+	printf("\nprobability of reaching %d cases: %g", in->levels[in->nlevels-1], in->proba);
+	printf("\ntime steps simulated: %.0f\n", in->nstepsim);
+}
+
+
+
+/* Record the outcome of trajectory 'i' */
+static void store_splitting_trajectory(struct splitting *in, struct simulation *sim, int i){
+	int t, k, *grp = in->grpsizes + i * in->duration * SWEEP_NGRP;
+	struct sample *samp;
+	struct ts_groupsizes *ts = sim->grpsizes;
+
+	in->nstep[i] = sim->nstep;
+	for(t=0;t<sim->nstep;t++){
+		grp[t*SWEEP_NGRP] = ts->nsus[t];
+		grp[t*SWEEP_NGRP + 1] = ts->nexp[t];
+		grp[t*SWEEP_NGRP + 2] = ts->ninf[t];
+		grp[t*SWEEP_NGRP + 3] = ts->nrec[t];
+		grp[t*SWEEP_NGRP + 4] = ts->nexpcum[t];
+	}
+	for(t=sim->nstep;t<in->duration;t++){
+		for(k=0;k<SWEEP_NGRP;k++) grp[t*SWEEP_NGRP + k] = t > 0 ? grp[(t-1)*SWEEP_NGRP + k] : 0;
+	}
+
+	samp = get_simulation_sample(sim);
+	if(samp == NULL) return;
+	get_sumstat_vector(samp, sim->par, in->stats + i*SUMSTAT_NSTAT);
+	free_sample(samp);
+}
+
+
+
+
+/*
+   ===============================
+   === MAIN EXTERNAL FUNCTIONS ===
+   ===============================
+*/
+
+/* Multilevel splitting */
+/* At stage k, ntraj trajectories are run until they reach levels[k] */
+/* cumulative cases, or until the epidemic is over. The R survivors are */
+/* then split into ntraj trajectories: each goes on as floor(ntraj/R) */
+/* trajectories, and the remaining ones are given to survivors drawn */
+/* without replacement. A survivor goes on itself, its other copies being */
+/* forks (see fork_simulation), and each trajectory of the next stage */
+/* reads its own substreams. The product of the fractions of survivors is */
+/* an unbiased estimate of the probability of reaching the last level. */
+void run_splitting(struct splitting *in, struct param *tpl, struct network *cn, unsigned long seed, int nthreads){
+	int i, j, k, c, R, ncreated=0, nextra, *surv, *ncopies, *id, *nextid;
+	double nstepsim=0.0;
+	struct simulation **sims, **next, **created;
+	gsl_rng *rng = create_rng(seed);
+
+	sims = (struct simulation **) malloc(in->ntraj * sizeof(struct simulation *));
+	next = (struct simulation **) malloc(in->ntraj * sizeof(struct simulation *));
+	created = (struct simulation **) malloc(in->ntraj * (in->nlevels + 1) * sizeof(struct simulation *));
+	surv = (int *) malloc(in->ntraj * sizeof(int));
+	ncopies = (int *) malloc(in->ntraj * sizeof(int));
+	id = (int *) malloc(in->ntraj * sizeof(int));
+	nextid = (int *) malloc(in->ntraj * sizeof(int));
+	if(sims == NULL || next == NULL || created == NULL || surv == NULL || ncopies == NULL || id == NULL || nextid == NULL){
+		fprintf(stderr, "\n[in: splitting.c->run_splitting]\nNo memory left for storing trajectories. Exiting.\n");
+		exit(1);
+	}
+
+#ifdef _OPENMP
+	if(nthreads < 1) nthreads = omp_get_num_procs();
+#endif
+
+	/* 'created' lists all trajectories, 'id' gives their index in it */
+	for(i=0;i<in->ntraj;i++){
+		id[i] = ncreated;
+		sims[i] = created[ncreated++] = create_simulation(tpl, cn, seed, i);
+	}
+
+	in->proba = 1.0;
+	for(k=0;k<in->nlevels;k++){
+		/* run until the level is reached */
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic) num_threads(nthreads) reduction(+:nstepsim)
+#endif
+		for(i=0;i<in->ntraj;i++){
+			int start = sims[i]->nstep;
+			while(get_total_nexpcum(sims[i]->metapop) < in->levels[k] && step_simulation(sims[i]));
+			nstepsim += sims[i]->nstep - start;
+		}
+
+		R = 0;
+		for(i=0;i<in->ntraj;i++){
+			if(get_total_nexpcum(sims[i]->metapop) >= in->levels[k]) surv[R++] = i;
+		}
+		in->nreached[k] = R;
+		in->prob[k] = (double) R / in->ntraj;
+		in->proba *= in->prob[k];
+		if(R == 0) break;
+
+		/* number of copies of each survivor; extra copies go to survivors */
+		/* drawn without replacement (partial shuffle) */
+		rng_set_stream(rng, 0, k, 0, RNG_SPLITTING);
+		nextra = in->ntraj % R;
+		for(j=0;j<nextra;j++){
+			c = j + rng_uniform_int(rng, R - j);
+			i = surv[j];
+			surv[j] = surv[c];
+			surv[c] = i;
+		}
+		for(i=0;i<in->ntraj;i++) ncopies[i] = 0;
+		for(j=0;j<R;j++) ncopies[surv[j]] = in->ntraj / R + (j < nextra ? 1 : 0);
+
+		/* split survivors; trajectories of stage k+1 use substreams */
+		/* (k+1)*ntraj.. */
+		j = 0;
+		for(i=0;i<in->ntraj;i++){
+			if(ncopies[i] == 0) continue;
+			next[j] = sims[i];
+			nextid[j] = id[i];
+			next[j]->rep = (k+1) * in->ntraj + j;
+			j++;
+			for(c=1;c<ncopies[i];c++){
+				nextid[j] = ncreated;
+				next[j] = created[ncreated++] = fork_simulation(sims[i], NULL, NULL, (k+1) * in->ntraj + j);
+				j++;
+			}
+		}
+
+		/* trajectories which went extinct are freed, unless they are the */
+		/* base of forks */
+		for(i=0;i<in->ntraj;i++){
+			if(ncopies[i] > 0 || sims[i]->nforks > 0) continue;
+			free_simulation(sims[i]);
+			created[id[i]] = NULL;
+		}
+		for(i=0;i<in->ntraj;i++){
+			sims[i] = next[i];
+			id[i] = nextid[i];
+		}
+	}
+
+	/* run trajectories conditioned on the last level to their end */
+	if(in->proba > 0.0){
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic) num_threads(nthreads) reduction(+:nstepsim)
+#endif
+		for(i=0;i<in->ntraj;i++){
+			int start = sims[i]->nstep;
+			run_simulation(sims[i]);
+			nstepsim += sims[i]->nstep - start;
+			store_splitting_trajectory(in, sims[i], i);
+		}
+	}
+	in->nstepsim = nstepsim;
+
+	/* forks are created after their base: free in reverse order */
+	for(c=ncreated-1;c>=0;c--) free_simulation(created[c]);
+
+	gsl_rng_free(rng);
+	free(sims);
+	free(next);
+	free(created);
+	free(surv);
+	free(ncopies);
+	free(id);
+	free(nextid);
+}
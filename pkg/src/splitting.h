@@ -0,0 +1,77 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions simulate epidemics conditioned on large outbreaks by
+  multilevel splitting.
+  Requires populations.h, sumstat.h and sweep.h to be included first.
+*/
+
+
+/*
+   ==================
+   === STRUCTURES ===
+   ==================
+*/
+
+/* Multilevel splitting (fixed effort) */
+/* - 'levels': 'nlevels' increasing numbers of cumulative cases, the last */
+/* one being the outbreak size conditioned on */
+/* - 'nreached': number of the 'ntraj' trajectories of each stage reaching */
+/* the corresponding level; 'prob' = nreached / ntraj */
+/* - 'proba': estimated probability of reaching the last level, i.e. the */
+/* product of 'prob' (0 if a level was never reached) */
+/* - 'grpsizes', 'stats', 'nstep': as in struct sweep, for the 'ntraj' */
+/* trajectories conditioned on reaching the last level, which all have */
+/* the weight proba / ntraj */
+/* - 'nstepsim': number of time steps simulated */
+struct splitting{
+	int *levels, *nreached, *grpsizes, *nstep;
+	double *prob, *stats, proba, nstepsim;
+	int nlevels, ntraj, duration;
+};
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+/* 'levels' is copied */
+struct splitting * create_splitting(int *levels, int nlevels, int ntraj, int duration);
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_splitting(struct splitting *in);
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+void print_splitting(struct splitting *in);
+
+
+
+/*
+   ==========================
+   === EXTERNAL FUNCTIONS ===
+   ==========================
+*/
+
+/* run multilevel splitting over 'nthreads' threads, with the parameters */
+/* 'tpl' and network 'cn' */
+void run_splitting(struct splitting *in, struct param *tpl, struct network *cn, unsigned long seed, int nthreads);
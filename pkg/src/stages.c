@@ -0,0 +1,182 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions handle staged compartments used by continuous-time engines.
+*/
+
+#include "common.h"
+#include "philox.h"
+#include "rng.h"
+#include "param.h"
+#include "pathogens.h"
+#include "populations.h"
+#include "stages.h"
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+/* Create stages for a newly created metapopulation */
+/* Initial pathogens are all in the first exposed stage. */
+struct stages * create_stages(struct metapopulation *metapop, struct param *par){
+	int i, b, npop=get_npop(metapop);
+	struct stages *out = (struct stages *) malloc(sizeof(struct stages));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: stages.c->create_stages]\nNo memory left for creating stages. Exiting.\n");
+		exit(1);
+	}
+
+	out->npop = npop;
+	out->ke = par->ke;
+	out->ki = par->ki;
+	out->nblocks = par->ke + par->ki + 1;
+
+	/* exit rates: mean durations are t1 (latent) and t2-t1 (infectious) */
+	out->rates = (double *) calloc(out->nblocks, sizeof(double));
+	out->bounds = (int **) malloc(npop * sizeof(int *));
+	if(out->rates == NULL || out->bounds == NULL){
+		fprintf(stderr, "\n[in: stages.c->create_stages]\nNo memory left for creating stages. Exiting.\n");
+		exit(1);
+	}
+	for(b=1;b<=out->ki;b++) out->rates[b] = ((double) out->ki) / (par->t2 - par->t1);
+	for(b=out->ki+1;b<out->nblocks;b++) out->rates[b] = ((double) out->ke) / par->t1;
+
+	/* boundaries: everything in the last block (first exposed stage) */
+	for(i=0;i<npop;i++){
+		out->bounds[i] = (int *) calloc(out->nblocks+1, sizeof(int));
+		if(out->bounds[i] == NULL){
+			fprintf(stderr, "\n[in: stages.c->create_stages]\nNo memory left for creating stages. Exiting.\n");
+			exit(1);
+		}
+		out->bounds[i][out->nblocks] = get_nexpcum(get_populations(metapop)[i]);
+	}
+
+	return out;
+}
+
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_stages(struct stages *in){
+	int i;
+	if(in != NULL){
+		for(i=0;i<in->npop;i++) free(in->bounds[i]);
+		free(in->bounds);
+		free(in->rates);
+		free(in);
+	}
+}
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+int get_block_size(struct stages *in, int popid, int block){
+	return in->bounds[popid][block+1] - in->bounds[popid][block];
+}
+
+
+/* block of the first infectious stage */
+int first_infectious_block(struct stages *in){
+	return in->ki;
+}
+
+
+/* block of the first exposed stage */
+int first_exposed_block(struct stages *in){
+	return in->nblocks - 1;
+}
+
+
+void print_stages(struct stages *in){
+	int i, b;
+	printf("\nstages: %d latent, %d infectious", in->ke, in->ki);
+	for(i=0;i<in->npop;i++){
+		printf("\npopulation %d - block sizes: ", i);
+		for(b=0;b<in->nblocks;b++) printf("%d ", get_block_size(in, i, b));
+	}
+	printf("\n");
+}
+
+
+
+
+/*
+   ==========================
+   === EXTERNAL FUNCTIONS ===
+   ==========================
+*/
+
+/* MOVE M RANDOM PATHOGENS OF A BLOCK TO THE NEXT STAGE */
+/* Chosen pathogens are swapped to the front of their block (partial */
+/* Fisher-Yates shuffle), then the block boundary is shifted by m. */
+void progress_block(struct population *pop, struct stages *st, int block, int m, struct param *par){
+	int k, j, first, size, popid=get_popid(pop);
+	struct pathogen *temp;
+
+	if(block < 1 || m < 1) return;
+	first = st->bounds[popid][block];
+	size = get_block_size(st, popid, block);
+	if(m > size) m = size;
+
+	for(k=0;k<m;k++){
+		j = first + k + (size-k > 1 ? rng_uniform_int(par->rng, size-k) : 0);
+		temp = pop->pathogens[first+k];
+		pop->pathogens[first+k] = pop->pathogens[j];
+		pop->pathogens[j] = temp;
+
+		/* keep ages consistent with is_activated/is_infectious */
+		if(block == 1) {
+			pop->pathogens[first+k]->age = -1;
+		} else if(block == first_infectious_block(st)+1){
+			pop->pathogens[first+k]->age = par->t1;
+		}
+	}
+
+	st->bounds[popid][block] += m;
+} /* end progress_block */
+
+
+
+
+/* APPEND NEW INFECTIONS AT THE END OF A POPULATION */
+void add_infections(struct population *pop, struct stages *st, struct pathogen **newpat, int m){
+	int k, popid=get_popid(pop);
+
+	for(k=0;k<m;k++){
+		pop->pathogens[pop->nexpcum + k] = newpat[k];
+	}
+
+	pop->nsus = pop->nsus - m;
+	pop->nexpcum = pop->nexpcum + m;
+	st->bounds[popid][st->nblocks] = pop->nexpcum;
+}
+
+
+
+
+/* UPDATE NEXP, NINF, NREC FROM BLOCK BOUNDARIES */
+void update_stage_counts(struct population *pop, struct stages *st){
+	int *bounds = st->bounds[get_popid(pop)];
+	pop->nrec = bounds[1];
+	pop->ninf = bounds[st->ki+1] - bounds[1];
+	pop->nexp = bounds[st->nblocks] - bounds[st->ki+1];
+}
@@ -0,0 +1,86 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions handle staged compartments used by continuous-time engines.
+*/
+
+
+/*
+   ==================
+   === STRUCTURES ===
+   ==================
+*/
+
+/* In continuous time, latent and infectious durations are Erlang-distributed: */
+/* the latent period has 'ke' exponential stages, the infectious period 'ki'. */
+/* Pathogens of a population are stored by blocks, from left to right: */
+/* recovered (block 0), infectious stages from last to first (blocks 1..ki), */
+/* exposed stages from last to first (blocks ki+1..ki+ke). Any progression */
+/* moves a pathogen to the block on its left, and new infections are appended */
+/* at the end of the pathogen array, i.e. in the first exposed stage. */
+/* This keeps the layout expected by populations.c: recovered pathogens in */
+/* [0,nrec), infectious in [nrec,nrec+ninf), exposed afterwards. */
+/* - 'nblocks' = ke + ki + 1 */
+/* - 'bounds[p][b]' is the index of the first pathogen of block b in population p */
+/*    with bounds[p][nblocks] = nexpcum */
+/* - 'rates[b]' is the rate at which a pathogen leaves block b */
+struct stages{
+	int npop, ke, ki, nblocks, **bounds;
+	double *rates;
+};
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+struct stages * create_stages(struct metapopulation *metapop, struct param *par);
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_stages(struct stages *in);
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+int get_block_size(struct stages *in, int popid, int block);
+
+int first_infectious_block(struct stages *in);
+
+int first_exposed_block(struct stages *in);
+
+void print_stages(struct stages *in);
+
+
+
+/*
+   ==========================
+   === EXTERNAL FUNCTIONS ===
+   ==========================
+*/
+
+/* move m random pathogens of a block to the next stage */
+void progress_block(struct population *pop, struct stages *st, int block, int m, struct param *par);
+
+/* append new infections at the end of a population */
+void add_infections(struct population *pop, struct stages *st, struct pathogen **newpat, int m);
+
+/* update nexp, ninf, nrec from block boundaries */
+void update_stage_counts(struct population *pop, struct stages *st);
@@ -13,6 +13,7 @@
 #include "populations.h"
 #include "sampling.h"
 #include "dispersal.h"
+#include "eventlog.h"
 #include "infection.h"
 #include "sumstat.h"
 
@@ -159,25 +160,27 @@ int dist_a_b(int *a, int *b, int na, int nb){
 
 
 
-/* count and list number of snps in a sample */
-struct snplist * list_snps(struct sample *in, struct param *par){
-	int i=0, j=0, N=get_n(in), *pool, poolsize, curNbSnps;
+/* count and list number of snps in a sample view */
+struct snplist * list_snps_view(struct sample_view *in, struct param *par){
+	int i=0, j=0, N=get_n_view(in), *pool, poolsize, curNbSnps;
+	struct pathogen *ppat;
 	struct snplist *out;
 
 	/* create pool of snps */
 	pool = malloc(par->L * sizeof(int));
 	if(pool == NULL){
-		fprintf(stderr, "\n[in: sumstat.c->list_snps]\nNo memory left for creating pool of SNPs. Exiting.\n");
+		fprintf(stderr, "\n[in: sumstat.c->list_snps_view]\nNo memory left for creating pool of SNPs. Exiting.\n");
 		exit(1);
 	}
 
 	/* list and count all SNPs */
 	poolsize = 0;
 	for(i=0;i<N;i++){
-		curNbSnps = get_nb_snps(in->pathogens[i]);
+		ppat = get_view_pathogen(in, i);
+		curNbSnps = get_nb_snps(ppat);
 		for(j=0;j<curNbSnps;j++){
-			if(int_in_vec(get_snps(in->pathogens[i])[j], pool, poolsize) < 0){
-				pool[poolsize++] = get_snps(in->pathogens[i])[j];
+			if(int_in_vec(get_snps(ppat)[j], pool, poolsize) < 0){
+				pool[poolsize++] = get_snps(ppat)[j];
 			}
 		}
 	}
@@ -195,6 +198,17 @@ struct snplist * list_snps(struct sample *in, struct param *par){
 
 
 
+/* count and list number of snps in a sample */
+struct snplist * list_snps(struct sample *in, struct param *par){
+	struct sample_view *view = view_sample(in);
+	struct snplist *out = list_snps_view(view, par);
+	free_sample_view(view);
+	return out;
+}
+
+
+
+
 
 
 
@@ -226,13 +240,14 @@ void print_allfreq(struct allfreq *in){
 
 
 
-struct allfreq * get_frequencies(struct sample *in, struct param *par){
-	int i, j, N=get_n(in);
+struct allfreq * get_frequencies_view(struct sample_view *in, struct param *par){
+	int i, j, N=get_n_view(in);
 	struct snplist *alleles;
 	struct allfreq *out;
+	struct pathogen *ppat;
 
 	/* list and count alleles */
-	alleles = list_snps(in, par);
+	alleles = list_snps_view(in, par);
 
 	/* allocate output */
 	out = create_allfreq(alleles->length);
@@ -240,8 +255,9 @@ struct allfreq * get_frequencies(struct sample *in, struct param *par){
 
 	/* compute frequencies */
 	for(i=0;i<N;i++){
+		ppat = get_view_pathogen(in, i);
 		for(j=0;j<alleles->length;j++){
-			if(int_in_vec(alleles->snps[j], get_snps(in->pathogens[i]), get_nb_snps(in->pathogens[i])) > -1) 
+			if(int_in_vec(alleles->snps[j], get_snps(ppat), get_nb_snps(ppat)) > -1) 
 				out->freq[j] = out->freq[j] + 1.0;
 		}
 	}
@@ -256,14 +272,24 @@ struct allfreq * get_frequencies(struct sample *in, struct param *par){
 
 
 
+struct allfreq * get_frequencies(struct sample *in, struct param *par){
+	struct sample_view *view = view_sample(in);
+	struct allfreq *out = get_frequencies_view(view, par);
+	free_sample_view(view);
+	return out;
+}
+
 
-double hs(struct sample *in, struct param *par){
+
+
+
+double hs_view(struct sample_view *in, struct param *par){
 	int i;
 	double out;
 	struct allfreq *freq;
 
 	/* get allele frequencies */
-	freq = get_frequencies(in, par);
+	freq = get_frequencies_view(in, par);
 
 	/* compute Hs */
 	out = 0.0;
@@ -281,6 +307,16 @@ double hs(struct sample *in, struct param *par){
 
 
 
+double hs(struct sample *in, struct param *par){
+	struct sample_view *view = view_sample(in);
+	double out = hs_view(view, par);
+	free_sample_view(view);
+	return out;
+}
+
+
+
+
 
 double hs_full_genome(struct sample *in, struct param *par){
 	int i;
@@ -433,7 +469,7 @@ double fst(struct sample *in, struct param *par){
 
 	int i, npop=get_npop_samp(in), sumweights=0;
 	double Ht, Hsbar=0, out;
-	struct sample ** listsamp;
+	struct sample_view ** listsamp;
 
 	/* global exp heteroz */
 	Ht = hs(in, par);
@@ -441,8 +477,8 @@ double fst(struct sample *in, struct param *par){
 	/* get Hs per population*/
 	listsamp = seppop(in, par);
 	for(i=0;i<npop;i++){
-		Hsbar += hs(listsamp[i], par)*get_n(listsamp[i]);
-		sumweights += get_n(listsamp[i]);
+		Hsbar += hs_view(listsamp[i], par)*get_n_view(listsamp[i]);
+		sumweights += get_n_view(listsamp[i]);
 	}
 
 	Hsbar = Hsbar/(double) sumweights;
@@ -451,7 +487,7 @@ double fst(struct sample *in, struct param *par){
 	out = 1.0 - (Hsbar/Ht);
 
 	/* free local pointers and return */
-	for(i=0;i<npop;i++) free_sample(listsamp[i]);
+	for(i=0;i<npop;i++) free_sample_view(listsamp[i]);
 	free(listsamp);
 	return out;
 }
@@ -486,6 +522,23 @@ void fill_ts_sumstat(struct ts_sumstat *in, struct sample *samp, int step, struc
 
 
 
+/* Compute the SUMSTAT_NSTAT statistics of a sample, in the order of ts_sumstat */
+void get_sumstat_vector(struct sample *samp, struct param *par, double *out){
+	out[0] = nb_snps(samp, par);
+	out[1] = hs(samp, par);
+	out[2] = mean_nb_snps(samp);
+	out[3] = var_nb_snps(samp);
+	out[4] = mean_pairwise_dist(samp, par);
+	out[5] = var_pairwise_dist(samp, par);
+	out[6] = mean_pairwise_dist_std(samp, par);
+	out[7] = var_pairwise_dist_std(samp, par);
+	out[8] = fst(samp, par);
+}
+
+
+
+
+
 
 
 /*
@@ -498,7 +551,7 @@ void fill_ts_sumstat(struct ts_sumstat *in, struct sample *samp, int step, struc
 
 /* gcc line:
 
-   gcc -o sumstat param.c auxiliary.c pathogens.c populations.c dispersal.c infection.c sampling.c sumstat.c -Wall -O0 -lgsl -lgslcblas
+   gcc -o sumstat param.c auxiliary.c philox.c rng.c pathogens.c populations.c dispersal.c infection.c sampling.c sumstat.c -Wall -O0 -lgsl -lgslcblas
 
    valgrind --leak-check=yes sumstat
 */
@@ -24,6 +24,12 @@ struct allfreq{
 };
 
 
+/* number of statistics computed on a sample, in the order of ts_sumstat: */
+/* nbSnps, Hs, meanNbSnps, varNbSnps, meanPairwiseDist, varPairwiseDist, */
+/* meanPairwiseDistStd, varPairwiseDistStd, Fst */
+#define SUMSTAT_NSTAT 9
+
+
 struct ts_sumstat{
 	double *Hs, *meanNbSnps, *varNbSnps, *meanPairwiseDist, *varPairwiseDist, *meanPairwiseDistStd, *varPairwiseDistStd, *Fst;
 	int *steps, *nbSnps, length, maxlength;
@@ -69,6 +75,8 @@ void free_ts_sumstat(struct ts_sumstat *in);
 
 int dist_a_b(int *a, int *b, int na, int nb);
 
+struct snplist * list_snps_view(struct sample_view *in, struct param *par);
+
 struct snplist * list_snps(struct sample *in, struct param *par);
 
 
@@ -82,8 +90,12 @@ void print_snplist(struct snplist *in);
 
 void print_allfreq(struct allfreq *in);
 
+struct allfreq * get_frequencies_view(struct sample_view *in, struct param *par);
+
 struct allfreq * get_frequencies(struct sample *in, struct param *par);
 
+double hs_view(struct sample_view *in, struct param *par);
+
 double hs(struct sample *in, struct param *par);
 
 double hs_full_genome(struct sample *in, struct param *par);
@@ -109,4 +121,6 @@ double fst(struct sample *in, struct param *par);
 
 void fill_ts_sumstat(struct ts_sumstat *in, struct sample *samp, int step, struct param *par);
 
+void get_sumstat_vector(struct sample *samp, struct param *par, double *out);
+
 void write_ts_sumstat(struct ts_sumstat *in);
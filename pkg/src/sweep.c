@@ -0,0 +1,286 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions run parameter sweeps under common random numbers.
+*/
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "common.h"
+#include "auxiliary.h"
+#include "param.h"
+#include "pathogens.h"
+#include "populations.h"
+#include "sampling.h"
+#include "dispersal.h"
+#include "sumstat.h"
+#include "philox.h"
+#include "rng.h"
+#include "simulation.h"
+#include "inout.h"
+#include "sweep.h"
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+struct sweep * create_sweep(double *theta, double *weights, int nweights, int nscen, int nrep, int duration, bool crn){
+	int i, nrun;
+	struct sweep *out = (struct sweep *) malloc(sizeof(struct sweep));
+	if(out == NULL){
+		fprintf(stderr, "\n[in: sweep.c->create_sweep]\nNo memory left for creating sweep. Exiting.\n");
+		exit(1);
+	}
+
+	out->nscen = nscen > 0 ? nscen : 1;
+	out->nrep = nrep > 0 ? nrep : 1;
+	out->duration = duration > 0 ? duration : 1;
+	out->crn = crn;
+	nrun = out->nscen * out->nrep;
+
+	out->theta = (double *) malloc(out->nscen * SWEEP_NPAR * sizeof(double));
+	out->stats = (double *) malloc(nrun * SUMSTAT_NSTAT * sizeof(double));
+	out->grpsizes = (int *) malloc(nrun * out->duration * SWEEP_NGRP * sizeof(int));
+	out->nstep = (int *) malloc(nrun * sizeof(int));
+	if(out->theta == NULL || out->stats == NULL || out->grpsizes == NULL || out->nstep == NULL){
+		fprintf(stderr, "\n[in: sweep.c->create_sweep]\nNo memory left for storing runs. Exiting.\n");
+		exit(1);
+	}
+	for(i=0;i<out->nscen*SWEEP_NPAR;i++) out->theta[i] = theta[i];
+
+	out->weights = NULL;
+	out->nweights = 0;
+	if(weights != NULL && nweights > 0){
+		out->nweights = nweights;
+		out->weights = (double *) malloc(out->nscen * nweights * sizeof(double));
+		if(out->weights == NULL){
+			fprintf(stderr, "\n[in: sweep.c->create_sweep]\nNo memory left for storing dispersal weights. Exiting.\n");
+			exit(1);
+		}
+		for(i=0;i<out->nscen*nweights;i++) out->weights[i] = weights[i];
+	}
+
+	return out;
+}
+
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_sweep(struct sweep *in){
+	if(in != NULL){
+		free(in->theta);
+		free(in->weights);
+		free(in->stats);
+		free(in->grpsizes);
+		free(in->nstep);
+		free(in);
+	}
+}
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+int get_sweep_stream(struct sweep *in, int scen, int rep){
+	return in->crn ? rep : scen * in->nrep + rep;
+}
+
+
+
+void print_sweep(struct sweep *in){
+	int s, k;
+	printf("\n-- parameter sweep: %d scenarios x %d replicates, %s --", in->nscen, in->nrep, in->crn ? "common random numbers" : "independent runs");
+	for(s=0;s<in->nscen;s++){
+		printf("\nscenario %d (beta, mu, t1, t2):", s+1);
+		for(k=0;k<SWEEP_NPAR;k++) printf(" %g", in->theta[s*SWEEP_NPAR + k]);
+		if(in->weights != NULL) printf(" - own dispersal weights");
+	}
+	printf("\n");
+}
+
+
+
+/* Run replicate 'rep' of scenario 'scen' and store its results */
+static void run_sweep_replicate(struct sweep *in, struct param *tpl, struct network *cn, unsigned long seed, int scen, int rep){
+	int t, k, run = scen * in->nrep + rep, *grp = in->grpsizes + run * in->duration * SWEEP_NGRP;
+	double *theta = in->theta + scen * SWEEP_NPAR;
+	struct param par = *tpl;
+	struct simulation *sim;
+	struct sample *samp;
+	struct ts_groupsizes *ts;
+
+	par.beta = theta[0];
+	par.mu = theta[1];
+	par.muL = par.mu * par.L;
+	par.t1 = (int) theta[2];
+	par.t2 = (int) theta[3];
+
+	sim = create_simulation(&par, cn, seed, get_sweep_stream(in, scen, rep));
+	run_simulation(sim);
+	in->nstep[run] = sim->nstep;
+
+	/* group sizes; the last state holds once the epidemic is over */
+	ts = sim->grpsizes;
+	for(t=0;t<sim->nstep;t++){
+		grp[t*SWEEP_NGRP] = ts->nsus[t];
+		grp[t*SWEEP_NGRP + 1] = ts->nexp[t];
+		grp[t*SWEEP_NGRP + 2] = ts->ninf[t];
+		grp[t*SWEEP_NGRP + 3] = ts->nrec[t];
+		grp[t*SWEEP_NGRP + 4] = ts->nexpcum[t];
+	}
+	for(t=sim->nstep;t<in->duration;t++){
+		for(k=0;k<SWEEP_NGRP;k++) grp[t*SWEEP_NGRP + k] = t > 0 ? grp[(t-1)*SWEEP_NGRP + k] : 0;
+	}
+
+	/* statistics of the final sample */
+	samp = get_simulation_sample(sim);
+	free_simulation(sim);
+	if(samp == NULL){
+		for(k=0;k<SUMSTAT_NSTAT;k++) in->stats[run*SUMSTAT_NSTAT + k] = NAN;
+		return;
+	}
+	get_sumstat_vector(samp, &par, in->stats + run*SUMSTAT_NSTAT);
+	free_sample(samp);
+}
+
+
+
+
+/*
+   ===============================
+   === MAIN EXTERNAL FUNCTIONS ===
+   ===============================
+*/
+
+/* Parameter sweep */
+/* Under common random numbers, the replicates of all scenarios read the */
+/* same substreams, which are indexed by replicate, step, population and */
+/* decision (see rng.h): differences between scenarios are then due to the */
+/* parameters rather than to the random numbers. Results do not depend on */
+/* the number of threads. */
+void run_sweep(struct sweep *in, struct param *tpl, struct network *cn, unsigned long seed, int nthreads){
+	int i, s;
+	struct param par;
+	struct network **nets;
+
+	/* one network per scenario if weights vary */
+	nets = (struct network **) malloc(in->nscen * sizeof(struct network *));
+	if(nets == NULL){
+		fprintf(stderr, "\n[in: sweep.c->run_sweep]\nNo memory left for creating networks. Exiting.\n");
+		exit(1);
+	}
+	for(s=0;s<in->nscen;s++){
+		if(in->weights == NULL){
+			nets[s] = cn;
+		} else {
+			par = *tpl;
+			par.cn_weights = in->weights + s * in->nweights;
+			nets[s] = create_network(&par);
+		}
+	}
+
+#ifdef _OPENMP
+	if(nthreads < 1) nthreads = omp_get_num_procs();
+	#pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+	for(i=0;i<in->nscen*in->nrep;i++){
+		run_sweep_replicate(in, tpl, nets[i / in->nrep], seed, i / in->nrep, i % in->nrep);
+	}
+
+	if(in->weights != NULL){
+		for(s=0;s<in->nscen;s++) free_network(nets[s]);
+	}
+	free(nets);
+}
+
+
+
+/* Write the results of a sweep to columnar files */
+/* '[prefix]-sweep.bin' holds a row per run (COLFILE_SWEEP), scenarios and */
+/* replicates being numbered from 1; '[prefix]-popsize.bin' holds the */
+/* group sizes of run s*nrep + r as partition s*nrep + r. */
+void write_sweep_files(struct sweep *in, const char *prefix){
+	int i, t, k, nrun = in->nscen * in->nrep, *scen, *rep, *t1, *t2, *rec;
+	double *beta, *mu, *stats;
+	void *cols[7 + SUMSTAT_NSTAT];
+	char *file = (char *) malloc(strlen(prefix) + 16);
+	struct colfile *out;
+
+	scen = (int *) malloc(nrun * sizeof(int));
+	rep = (int *) malloc(nrun * sizeof(int));
+	t1 = (int *) malloc(nrun * sizeof(int));
+	t2 = (int *) malloc(nrun * sizeof(int));
+	beta = (double *) malloc(nrun * sizeof(double));
+	mu = (double *) malloc(nrun * sizeof(double));
+	stats = (double *) malloc(nrun * SUMSTAT_NSTAT * sizeof(double));
+	rec = (int *) malloc(in->duration * (SWEEP_NGRP+1) * sizeof(int));
+	if(file == NULL || scen == NULL || rep == NULL || t1 == NULL || t2 == NULL || beta == NULL || mu == NULL || stats == NULL || rec == NULL){
+		fprintf(stderr, "\n[in: sweep.c->write_sweep_files]\nNo memory left for writing results. Exiting.\n");
+		exit(1);
+	}
+
+	/* RUNS: PARAMETERS AND STATISTICS, ONE COLUMN EACH */
+	for(i=0;i<nrun;i++){
+		scen[i] = i / in->nrep + 1;
+		rep[i] = i % in->nrep + 1;
+		beta[i] = in->theta[(scen[i]-1) * SWEEP_NPAR];
+		mu[i] = in->theta[(scen[i]-1) * SWEEP_NPAR + 1];
+		t1[i] = (int) in->theta[(scen[i]-1) * SWEEP_NPAR + 2];
+		t2[i] = (int) in->theta[(scen[i]-1) * SWEEP_NPAR + 3];
+		for(k=0;k<SUMSTAT_NSTAT;k++) stats[k*nrun + i] = in->stats[i*SUMSTAT_NSTAT + k];
+	}
+	cols[0] = scen;
+	cols[1] = rep;
+	cols[2] = in->nstep;
+	cols[3] = beta;
+	cols[4] = mu;
+	cols[5] = t1;
+	cols[6] = t2;
+	for(k=0;k<SUMSTAT_NSTAT;k++) cols[7+k] = stats + k*nrun;
+	sprintf(file, "%s-sweep.bin", prefix);
+	out = create_colfile(file, COLFILE_SWEEP);
+	write_columns_bin(cols, nrun, 0, out);
+	close_colfile(out);
+
+	/* GROUP SIZES, ONE PARTITION PER RUN */
+	sprintf(file, "%s-popsize.bin", prefix);
+	out = create_colfile(file, COLFILE_GROUPSIZES);
+	for(i=0;i<nrun;i++){
+		for(t=0;t<in->duration;t++){
+			rec[t*(SWEEP_NGRP+1)] = t+1;
+			for(k=0;k<SWEEP_NGRP;k++) rec[t*(SWEEP_NGRP+1) + k+1] = in->grpsizes[(i*in->duration + t)*SWEEP_NGRP + k];
+		}
+		write_records_bin(rec, in->duration, i, out);
+	}
+	close_colfile(out);
+
+	free(file);
+	free(scen);
+	free(rep);
+	free(t1);
+	free(t2);
+	free(beta);
+	free(mu);
+	free(stats);
+	free(rec);
+}
@@ -0,0 +1,94 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions run parameter sweeps under common random numbers.
+  Requires populations.h and sumstat.h to be included first.
+*/
+
+
+/*
+   ==================
+   === STRUCTURES ===
+   ==================
+*/
+
+/* parameters varying between scenarios: beta, mu, t1, t2 */
+#define SWEEP_NPAR 4
+
+/* group sizes recorded at each step, in the order of out-popsize.txt: */
+/* nsus, nexp, ninf, nrec, nexpcum */
+#define SWEEP_NGRP 5
+
+
+/* Parameter sweep */
+/* - 'theta': parameters of the 'nscen' scenarios (SWEEP_NPAR per row) */
+/* - 'weights': dispersal weights of each scenario ('nweights' per row, in */
+/* the layout of param->cn_weights), or NULL to use those of the template */
+/* - 'crn': if TRUE, replicate r of every scenario reads the substreams of */
+/* replicate r (common random numbers); otherwise all runs are independent */
+/* - 'grpsizes': group sizes of each run (duration x SWEEP_NGRP), the state */
+/* at the end of an epidemic being carried over to the remaining steps */
+/* - 'stats': statistics of the final sample of each run (SUMSTAT_NSTAT), */
+/* NaN if the epidemic ended before 'duration'; 'nstep': steps performed */
+/* Runs are stored scenario by scenario, replicate r of scenario s being */
+/* run s*nrep + r. */
+struct sweep{
+	double *theta, *weights, *stats;
+	int *grpsizes, *nstep;
+	int nscen, nrep, nweights, duration;
+	bool crn;
+};
+
+
+
+
+/*
+   ====================
+   === CONSTRUCTORS ===
+   ====================
+*/
+
+/* 'theta' and 'weights' are copied; 'weights' may be NULL */
+struct sweep * create_sweep(double *theta, double *weights, int nweights, int nscen, int nrep, int duration, bool crn);
+
+
+
+/*
+   ===================
+   === DESTRUCTORS ===
+   ===================
+*/
+
+void free_sweep(struct sweep *in);
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+/* index of the substreams used by replicate 'rep' of scenario 'scen' */
+int get_sweep_stream(struct sweep *in, int scen, int rep);
+
+void print_sweep(struct sweep *in);
+
+
+
+/*
+   ==========================
+   === EXTERNAL FUNCTIONS ===
+   ==========================
+*/
+
+/* run all replicates of all scenarios over 'nthreads' threads; 'tpl' gives */
+/* the parameters which do not vary, and 'cn' the network used when */
+/* in->weights is NULL */
+void run_sweep(struct sweep *in, struct param *tpl, struct network *cn, unsigned long seed, int nthreads);
+
+/* write the results to '[prefix]-sweep.bin' and '[prefix]-popsize.bin' */
+/* (columnar files, see inout.h) */
+void write_sweep_files(struct sweep *in, const char *prefix);
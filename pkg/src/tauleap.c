@@ -0,0 +1,203 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions implement a continuous-time, tau-leaping simulation engine.
+  Reactions of population p are:
+  - infection: S_p -> E_p (stage 1), with propensity S_p * lambda_p
+  - progression: stage b -> stage b-1, with propensity rate_b * n_b
+  Leap sizes follow Cao, Gillespie & Petzold (2006, J Chem Phys 124:044109).
+*/
+
+#include "common.h"
+#include "philox.h"
+#include "rng.h"
+#include "auxiliary.h"
+#include "param.h"
+#include "pathogens.h"
+#include "populations.h"
+#include "dispersal.h"
+#include "eventlog.h"
+#include "infection.h"
+#include "stages.h"
+#include "tauleap.h"
+
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+/* bound on the leap imposed by one species of size x, with highest order g */
+static double tau_bound(double x, double g, double mu, double sigma2, double eps){
+	double out = -1.0, bound = eps * x / g;
+	if(bound < 1.0) bound = 1.0;
+
+	if(fabs(mu) > NEARZERO) out = bound / fabs(mu);
+	if(sigma2 > NEARZERO && (out < 0 || bound*bound/sigma2 < out)) out = bound*bound/sigma2;
+	return out;
+}
+
+
+
+
+/* CHOOSE THE LEAP SIZE */
+/* ainf[p] is the infection propensity of population p. */
+/* Susceptibles and infectious take part in second-order reactions (g=2). */
+/* Returns -1 if all propensities are null. */
+double select_tau(struct metapopulation *metapop, struct stages *st, double *ainf, struct param *par){
+	int p, b, n, nnext, npop=get_npop(metapop), lastblock=st->nblocks-1;
+	double out=-1.0, temp, in, outrate, g;
+	struct population *pop;
+
+	for(p=0;p<npop;p++){
+		pop = get_populations(metapop)[p];
+
+		/* susceptibles */
+		temp = tau_bound((double) get_nsus(pop), 2.0, -ainf[p], ainf[p], par->tau_tol);
+		if(temp > 0 && (out < 0 || temp < out)) out = temp;
+
+		/* exposed and infectious stages */
+		for(b=1;b<=lastblock;b++){
+			n = get_block_size(st, p, b);
+			outrate = st->rates[b] * n;
+			if(b == lastblock){
+				in = ainf[p];
+			} else {
+				nnext = get_block_size(st, p, b+1);
+				in = st->rates[b+1] * nnext;
+			}
+			g = (b <= first_infectious_block(st)) ? 2.0 : 1.0;
+			temp = tau_bound((double) n, g, in - outrate, in + outrate, par->tau_tol);
+			if(temp > 0 && (out < 0 || temp < out)) out = temp;
+		}
+	}
+
+	return out;
+}
+
+
+
+
+/*
+   ==========================
+   === EXTERNAL FUNCTIONS ===
+   ==========================
+*/
+
+/* PERFORM ONE LEAP */
+/* All event counts are drawn from the state at the beginning of the leap: */
+/* new pathogens are replicated from the current infectious pathogens, then */
+/* stage progressions are applied, and new infections are appended last. */
+double tauleap_step(struct metapopulation *metapop, struct stages *st, struct network *cn, double tmax, struct param *par){
+	int p, b, k, count, npop=get_npop(metapop), maxnb=0, *nbnew, *nbnewvec;
+	double tau, *ainf, *lambdavec;
+	struct population *pop, *curpop;
+	struct pathogen ***newpat;
+
+	for(p=0;p<npop;p++) if(cn->nbNb[p] > maxnb) maxnb = cn->nbNb[p];
+
+	ainf = (double *) malloc(npop * sizeof(double));
+	lambdavec = (double *) malloc(maxnb * sizeof(double));
+	if(ainf == NULL || lambdavec == NULL){
+		fprintf(stderr, "\n[in: tauleap.c->tauleap_step]\nNo memory left for performing leap. Exiting.\n");
+		exit(1);
+	}
+
+	/* INFECTION PROPENSITIES AND LEAP SIZE */
+	for(p=0;p<npop;p++){
+		pop = get_populations(metapop)[p];
+		ainf[p] = get_nsus(pop) * get_lambda(pop, metapop, cn, par, lambdavec);
+	}
+
+	tau = select_tau(metapop, st, ainf, par);
+	if(tau < 0){ /* nothing can happen anymore */
+		free(ainf);
+		free(lambdavec);
+		return -1.0;
+	}
+	if(tau > tmax) tau = tmax;
+
+	nbnew = (int *) calloc(npop, sizeof(int));
+	newpat = (struct pathogen ***) calloc(npop, sizeof(struct pathogen **));
+	nbnewvec = (int *) malloc(maxnb * sizeof(int));
+	if(nbnew == NULL || newpat == NULL || nbnewvec == NULL){
+		fprintf(stderr, "\n[in: tauleap.c->tauleap_step]\nNo memory left for performing leap. Exiting.\n");
+		exit(1);
+	}
+
+	/* NEW INFECTIONS, FROM THE STATE AT THE START OF THE LEAP */
+	for(p=0;p<npop;p++){
+		if(ainf[p] < NEARZERO) continue;
+		pop = get_populations(metapop)[p];
+		nbnew[p] = rng_poisson(par->rng, ainf[p]*tau);
+		if(nbnew[p] > get_nsus(pop)) nbnew[p] = get_nsus(pop);
+		if(nbnew[p] < 1) continue;
+
+		newpat[p] = (struct pathogen **) malloc(nbnew[p] * sizeof(struct pathogen *));
+		if(newpat[p] == NULL){
+			fprintf(stderr, "\n[in: tauleap.c->tauleap_step]\nNo memory left for new infections. Exiting.\n");
+			exit(1);
+		}
+
+		/* ancestors are drawn among neighbours according to their contribution */
+		get_lambda(pop, metapop, cn, par, lambdavec);
+		rng_multinomial(par->rng, cn->nbNb[p], nbnew[p], lambdavec, (unsigned int *) nbnewvec);
+		count = 0;
+		for(k=0;k<cn->nbNb[p];k++){
+			curpop = get_populations(metapop)[cn->listNb[p][k]];
+			select_random_infectious_pathogens(curpop, nbnewvec[k], newpat[p] + count, NULL, par);
+			count += nbnewvec[k];
+		}
+		replicate_cohort(newpat[p], nbnew[p], newpat[p], par);
+	}
+
+	/* STAGE PROGRESSIONS - from left to right, so that a pathogen moves once */
+	for(p=0;p<npop;p++){
+		pop = get_populations(metapop)[p];
+		for(b=1;b<st->nblocks;b++){
+			k = get_block_size(st, p, b);
+			if(k < 1) continue;
+			progress_block(pop, st, b, rng_poisson(par->rng, st->rates[b]*k*tau), par);
+		}
+	}
+
+	/* APPEND NEW INFECTIONS AND UPDATE COUNTS */
+	for(p=0;p<npop;p++){
+		pop = get_populations(metapop)[p];
+		if(nbnew[p] > 0) add_infections(pop, st, newpat[p], nbnew[p]);
+		update_stage_counts(pop, st);
+	}
+
+	/* FREE MEMORY AND RETURN */
+	for(p=0;p<npop;p++) if(newpat[p] != NULL) free(newpat[p]);
+	free(newpat);
+	free(nbnew);
+	free(ainf);
+	free(lambdavec);
+	free(nbnewvec);
+	return tau;
+} /* end tauleap_step */
+
+
+
+
+/* LEAP UNTIL A GIVEN TIME */
+int tauleap_until(struct metapopulation *metapop, struct stages *st, struct network *cn, double *t, double tend, struct param *par){
+	int out=0;
+	double tau;
+
+	while(*t < tend - NEARZERO){
+		tau = tauleap_step(metapop, st, cn, tend - *t, par);
+		if(tau < 0) break; /* nothing can happen anymore */
+		*t = *t + tau;
+		out++;
+	}
+
+	*t = tend;
+	return out;
+}
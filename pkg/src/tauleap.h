@@ -0,0 +1,33 @@
+/*
+  Coded by Thibaut Jombart (t.jombart@imperial.ac.uk), September 2011.
+  Distributed with the epidemics package for the R software.
+  Licence: GPL >=2.
+
+  These functions implement a continuous-time, tau-leaping simulation engine.
+*/
+
+
+
+/*
+   ===========================
+   === AUXILIARY FUNCTIONS ===
+   ===========================
+*/
+
+/* choose the leap size from a tolerance on relative propensity changes */
+double select_tau(struct metapopulation *metapop, struct stages *st, double *ainf, struct param *par);
+
+
+
+/*
+   ==========================
+   === EXTERNAL FUNCTIONS ===
+   ==========================
+*/
+
+/* perform one leap of at most 'tmax' time units; returns the leap size, */
+/* or -1 if no event can occur anymore */
+double tauleap_step(struct metapopulation *metapop, struct stages *st, struct network *cn, double tmax, struct param *par);
+
+/* leap from time *t to time 'tend'; returns the number of leaps */
+int tauleap_until(struct metapopulation *metapop, struct stages *st, struct network *cn, double *t, double tend, struct param *par);